@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+//! @file BlockMap.hh
+//! @author Paul Hermann Lensing
+//! @brief Flat hash table keyed by file id and block number.
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#ifndef KINETICIO_BLOCKMAP_HH
+#define KINETICIO_BLOCKMAP_HH
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace kio {
+
+//------------------------------------------------------------------------------
+//! Open addressing hash table (linear probing, backward shift deletion)
+//! mapping a (file id, block number) pair to a value. All slots are stored
+//! in a single vector, so lookups neither allocate nor chase pointers. Not
+//! threadsafe.
+//------------------------------------------------------------------------------
+template<typename Value>
+class BlockMap {
+public:
+  //--------------------------------------------------------------------------
+  //! Look up the value stored for the supplied block.
+  //!
+  //! @param file the file id
+  //! @param block the block number
+  //! @return pointer to the value if it exists, NULL otherwise. Invalidated
+  //!         by any following insert or erase.
+  //--------------------------------------------------------------------------
+  Value* find(uint64_t file, int block)
+  {
+    for (size_t i = home(file, block); slots[i].used; i = (i + 1) & mask) {
+      if (slots[i].file == file && slots[i].block == block) {
+        return &slots[i].value;
+      }
+    }
+    return NULL;
+  }
+
+  //--------------------------------------------------------------------------
+  //! Store the value for the supplied block, replacing an existing value.
+  //!
+  //! @param file the file id
+  //! @param block the block number
+  //! @param value the value
+  //--------------------------------------------------------------------------
+  void insert(uint64_t file, int block, const Value& value)
+  {
+    if (auto existing = find(file, block)) {
+      *existing = value;
+      return;
+    }
+    if (2 * (count + 1) > slots.size()) {
+      grow();
+    }
+    size_t i = home(file, block);
+    while (slots[i].used) {
+      i = (i + 1) & mask;
+    }
+    slots[i].file = file;
+    slots[i].block = block;
+    slots[i].value = value;
+    slots[i].used = true;
+    count++;
+  }
+
+  //--------------------------------------------------------------------------
+  //! Remove the value stored for the supplied block.
+  //!
+  //! @param file the file id
+  //! @param block the block number
+  //! @return true if a value was removed, false if none existed
+  //--------------------------------------------------------------------------
+  bool erase(uint64_t file, int block)
+  {
+    size_t i = home(file, block);
+    while (slots[i].used && !(slots[i].file == file && slots[i].block == block)) {
+      i = (i + 1) & mask;
+    }
+    if (!slots[i].used) {
+      return false;
+    }
+
+    /* Shift following entries of the probe sequence back, so that lookups never have to skip deleted slots. */
+    size_t j = i;
+    while (true) {
+      slots[i].used = false;
+      slots[i].value = Value();
+      do {
+        j = (j + 1) & mask;
+        if (!slots[j].used) {
+          count--;
+          return true;
+        }
+      } while (((j - home(slots[j].file, slots[j].block)) & mask) < ((j - i) & mask));
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  //! @return the number of stored values
+  //--------------------------------------------------------------------------
+  size_t size() const
+  {
+    return count;
+  }
+
+  //--------------------------------------------------------------------------
+  //! Constructor.
+  //!
+  //! @param capacity initial number of slots, rounded up to a power of 2
+  //--------------------------------------------------------------------------
+  explicit BlockMap(size_t capacity = 64) : slots(), count(0), mask(0)
+  {
+    size_t size = 8;
+    while (size < capacity) {
+      size *= 2;
+    }
+    slots.resize(size);
+    mask = size - 1;
+  }
+
+private:
+  //! a single slot of the table
+  struct Slot {
+    uint64_t file;
+    int block;
+    bool used;
+    Value value;
+
+    Slot() : file(0), block(0), used(false), value() { }
+  };
+
+  //--------------------------------------------------------------------------
+  //! Compute the preferred slot for a block.
+  //--------------------------------------------------------------------------
+  size_t home(uint64_t file, int block) const
+  {
+    uint64_t h = file * 0x9e3779b97f4a7c15ULL ^ static_cast<uint32_t>(block);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h) & mask;
+  }
+
+  //--------------------------------------------------------------------------
+  //! Double the number of slots and re-insert all values.
+  //--------------------------------------------------------------------------
+  void grow()
+  {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    mask = slots.size() - 1;
+    count = 0;
+    for (auto it = old.cbegin(); it != old.cend(); it++) {
+      if (it->used) {
+        insert(it->file, it->block, it->value);
+      }
+    }
+  }
+
+private:
+  //! the slots
+  std::vector<Slot> slots;
+  //! number of used slots
+  size_t count;
+  //! slots.size() - 1, slots.size() is always a power of 2
+  size_t mask;
+};
+
+}
+
+#endif  // KINETICIO_BLOCKMAP_HH
@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------
+//! @file BufferPool.hh
+//! @author Paul Hermann Lensing
+//! @brief Recycling pool for chunk sized string buffers.
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#ifndef KINETICIO_BUFFERPOOL_HH
+#define KINETICIO_BUFFERPOOL_HH
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <set>
+#include <mutex>
+
+namespace kio {
+
+//------------------------------------------------------------------------------
+//! Value and parity chunks are multi-megabyte buffers that are allocated and
+//! released with every put and get. The buffer pool keeps released buffers
+//! around and hands them out again, so that the same memory is re-used
+//! instead of being returned to the operating system and page-faulted in
+//! again. Buffers are std::strings, as required by the kinetic client.
+//! Buffers are returned to the pool automatically when the last shared_ptr
+//! referencing them is released. Only buffers of the configured sizes (the
+//! chunk sizes of the configured clusters) are kept, so that buffers of
+//! other sizes can not crowd them out. Threadsafe.
+//------------------------------------------------------------------------------
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+public:
+  //--------------------------------------------------------------------------
+  //! Obtain a buffer of the requested size. The buffer content is
+  //! unspecified, callers have to initialize it.
+  //!
+  //! @param size the buffer size in bytes
+  //! @return the buffer
+  //--------------------------------------------------------------------------
+  std::shared_ptr<std::string> get(std::size_t size);
+
+  //--------------------------------------------------------------------------
+  //! @return the number of buffers handed out by the pool and not yet
+  //!         released
+  //--------------------------------------------------------------------------
+  std::size_t inUse() const;
+
+  //--------------------------------------------------------------------------
+  //! @return the number of bytes currently kept for re-use by the pool
+  //--------------------------------------------------------------------------
+  std::size_t cached() const;
+
+  //--------------------------------------------------------------------------
+  //! Change the pool configuration. Cached buffers exceeding the new
+  //! capacity or no longer being of a pooled size are released immediately.
+  //!
+  //! @param capacity the maximum number of bytes kept for re-use
+  //! @param sizes the buffer sizes kept for re-use
+  //--------------------------------------------------------------------------
+  void changeConfiguration(std::size_t capacity, const std::set<std::size_t>& sizes);
+
+  //--------------------------------------------------------------------------
+  //! Constructor. Buffers can only be obtained from pools that are managed
+  //! by a shared_ptr. As buffers reference the pool they have been obtained
+  //! from, it stays valid as long as any buffer is alive.
+  //!
+  //! @param max_cached the maximum number of bytes kept for re-use
+  //! @param sizes the buffer sizes kept for re-use
+  //--------------------------------------------------------------------------
+  explicit BufferPool(std::size_t max_cached, const std::set<std::size_t>& sizes);
+
+  //--------------------------------------------------------------------------
+  //! Destructor.
+  //--------------------------------------------------------------------------
+  ~BufferPool();
+
+private:
+  //--------------------------------------------------------------------------
+  //! Deleter of buffers handed out by the pool.
+  //--------------------------------------------------------------------------
+  struct Recycler {
+    std::shared_ptr<BufferPool> pool;
+    void operator()(std::string* buffer) const;
+  };
+
+  //--------------------------------------------------------------------------
+  //! Return a buffer to the pool, or free it if the pool is at capacity.
+  //!
+  //! @param buffer the buffer
+  //--------------------------------------------------------------------------
+  void recycle(std::string* buffer);
+
+private:
+  //! maximum number of bytes kept for re-use
+  std::size_t capacity;
+  //! buffer sizes kept for re-use
+  std::set<std::size_t> pooled_sizes;
+  //! number of bytes kept for re-use
+  std::size_t cached_bytes;
+  //! number of buffers handed out and not yet released
+  std::size_t in_use;
+  //! released buffers by buffer size
+  std::unordered_map<std::size_t, std::vector<std::string*>> free_buffers;
+  //! concurrency control
+  mutable std::mutex mutex;
+};
+
+}
+
+#endif  // KINETICIO_BUFFERPOOL_HH
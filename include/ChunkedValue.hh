@@ -0,0 +1,223 @@
+//------------------------------------------------------------------------------
+//! @file ChunkedValue.hh
+//! @author Paul Hermann Lensing
+//! @brief A value stored as a list of shared, fixed capacity chunks.
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#ifndef KINETICIO_CHUNKEDVALUE_HH
+#define KINETICIO_CHUNKEDVALUE_HH
+
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace kio {
+
+//------------------------------------------------------------------------------
+//! A value split into chunks of a fixed capacity. Chunk i stores the value
+//! region [i * capacity, (i+1) * capacity). Chunks are shared with anyone
+//! requesting them (e.g. as the data chunks of a stripe), so that a value can
+//! be assembled from and split into stripes without copying data. Modifying a
+//! chunk that is shared with another owner will copy that chunk first, so
+//! copying a value is cheap and only modified chunks will be duplicated.
+//!
+//! A chunk may be shorter than the chunk capacity and trailing chunks may
+//! not exist at all, missing data reads as 0s. Not threadsafe, with the
+//! exception of the encoding and of copying or obtaining the chunks of a
+//! const value, which may be done concurrently.
+//!
+//! Sharing is tracked explicitly: Once chunks have been handed out, they are
+//! never modified in place again, regardless of whether the recipient still
+//! holds them.
+//------------------------------------------------------------------------------
+class ChunkedValue {
+public:
+  //--------------------------------------------------------------------------
+  //! Copy value data into the supplied buffer. Any part of the requested
+  //! region that lies outside of the value size will be filled with 0s.
+  //!
+  //! @param buffer output buffer
+  //! @param offset offset in the value to start reading
+  //! @param length number of bytes to read
+  //--------------------------------------------------------------------------
+  void read(char* buffer, std::size_t offset, std::size_t length) const;
+
+  //--------------------------------------------------------------------------
+  //! Copy the supplied data into the value, increasing the value size if
+  //! necessary. If the write starts after the current value size, the gap
+  //! will read as 0s.
+  //!
+  //! @param buffer input buffer
+  //! @param offset offset in the value to start writing
+  //! @param length number of bytes to write
+  //--------------------------------------------------------------------------
+  void write(const char* buffer, std::size_t offset, std::size_t length);
+
+  //--------------------------------------------------------------------------
+  //! Copy a region of another value into this value, at the same offset.
+  //!
+  //! @param source the value to copy from
+  //! @param offset offset of the region in both values
+  //! @param length length of the region
+  //--------------------------------------------------------------------------
+  void write(const ChunkedValue& source, std::size_t offset, std::size_t length);
+
+  //--------------------------------------------------------------------------
+  //! Set the value size. Chunks no longer required are released, growing
+  //! the value will fill the new region with 0s.
+  //!
+  //! @param size the new value size
+  //--------------------------------------------------------------------------
+  void resize(std::size_t size);
+
+  //--------------------------------------------------------------------------
+  //! @return the value size in bytes
+  //--------------------------------------------------------------------------
+  std::size_t size() const;
+
+  //--------------------------------------------------------------------------
+  //! @return the capacity of a single chunk in bytes
+  //--------------------------------------------------------------------------
+  std::size_t chunkCapacity() const;
+
+  //--------------------------------------------------------------------------
+  //! Direct access to the chunks of the value, see class description. The
+  //! returned chunks are considered shared from now on.
+  //!
+  //! @return the chunks of the value
+  //--------------------------------------------------------------------------
+  const std::vector<std::shared_ptr<const std::string>>& chunks() const;
+
+  //--------------------------------------------------------------------------
+  //! Parity chunks computed when the value was last written as a stripe,
+  //! together with the data chunks they were computed from. As chunks are
+  //! copied before being modified, comparing the data chunks to the current
+  //! chunks of the value identifies the chunks that changed since, which
+  //! allows updating the parities instead of encoding the complete stripe.
+  //--------------------------------------------------------------------------
+  struct Encoding {
+    //! the data chunks of the stripe, including chunks used as zero padding
+    std::vector<std::shared_ptr<const std::string>> data;
+    //! the parity chunks of the stripe
+    std::vector<std::shared_ptr<const std::string>> parity;
+  };
+
+  //--------------------------------------------------------------------------
+  //! @return the encoding of the value when it was last written, may be
+  //!         empty
+  //--------------------------------------------------------------------------
+  std::shared_ptr<const Encoding> encoding() const;
+
+  //--------------------------------------------------------------------------
+  //! Remember the encoding the value has been written with. The encoding is
+  //! not part of the value content, so it can be set on a const value. As a
+  //! const value may be shared between threads, the encoding is accessed
+  //! atomically.
+  //!
+  //! @param encoding the encoding, may be empty to release a previous one
+  //--------------------------------------------------------------------------
+  void setEncoding(std::shared_ptr<const Encoding> encoding) const;
+
+  //--------------------------------------------------------------------------
+  //! Copy the value into a single contiguous string.
+  //!
+  //! @return the value as string
+  //--------------------------------------------------------------------------
+  std::shared_ptr<const std::string> toString() const;
+
+  //--------------------------------------------------------------------------
+  //! Constructor, creates an empty value.
+  //!
+  //! @param chunk_capacity the capacity of a single chunk in bytes
+  //--------------------------------------------------------------------------
+  explicit ChunkedValue(std::size_t chunk_capacity);
+
+  //--------------------------------------------------------------------------
+  //! Constructor, copies the supplied string into chunks.
+  //!
+  //! @param chunk_capacity the capacity of a single chunk in bytes
+  //! @param value the value
+  //--------------------------------------------------------------------------
+  explicit ChunkedValue(std::size_t chunk_capacity, const std::string& value);
+
+  //--------------------------------------------------------------------------
+  //! Constructor, shares ownership of the supplied chunks without copying.
+  //!
+  //! @param chunk_capacity the capacity of a single chunk in bytes
+  //! @param chunks the chunks, none may be longer than chunk_capacity
+  //! @param size the value size
+  //--------------------------------------------------------------------------
+  explicit ChunkedValue(std::size_t chunk_capacity,
+                        std::vector<std::shared_ptr<const std::string>> chunks,
+                        std::size_t size);
+
+  //--------------------------------------------------------------------------
+  //! Copy constructor, shares all chunks and the encoding with the source.
+  //!
+  //! @param other the value to copy
+  //--------------------------------------------------------------------------
+  ChunkedValue(const ChunkedValue& other);
+
+  //--------------------------------------------------------------------------
+  //! Copy assignment, shares all chunks and the encoding with the source.
+  //!
+  //! @param other the value to copy
+  //! @return this value
+  //--------------------------------------------------------------------------
+  ChunkedValue& operator=(const ChunkedValue& other);
+
+private:
+  //--------------------------------------------------------------------------
+  //! Obtain a pointer to the data of the chunk at the supplied index that can
+  //! safely be modified. Creates or copies the chunk if necessary, the
+  //! returned chunk will always be sized to chunk capacity.
+  //!
+  //! @param index the chunk index
+  //! @return pointer to the chunk data
+  //--------------------------------------------------------------------------
+  char* writableChunk(std::size_t index);
+
+  //--------------------------------------------------------------------------
+  //! Set the supplied region to 0s, without changing the value size. Chunks
+  //! that don't exist already read as 0s and will not be created.
+  //--------------------------------------------------------------------------
+  void zero(std::size_t offset, std::size_t length);
+
+private:
+  //! the capacity of a single chunk
+  std::size_t capacity;
+  //! the value size
+  std::size_t value_size;
+  //! the chunks
+  std::vector<std::shared_ptr<const std::string>> data;
+  //! the generation chunks have been allocated in by this object, 0 for
+  //! chunks not allocated by this object
+  std::vector<uint64_t> owned;
+  //! the current generation, incremented whenever chunks are handed out.
+  //! Only chunks allocated in the current generation can be modified in place.
+  mutable std::atomic<uint64_t> generation;
+  //! the encoding the value has last been written with, only to be accessed
+  //! with std::atomic_load / std::atomic_store
+  mutable std::shared_ptr<const Encoding> last_encoding;
+};
+
+}
+
+#endif  // KINETICIO_CHUNKEDVALUE_HH
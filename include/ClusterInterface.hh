@@ -26,8 +26,11 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <future>
 #include <kinetic/kinetic.h>
 #include <kio/AdminClusterInterface.hh>
+#include "ChunkedValue.hh"
+#include "LatencyStatistics.hh"
 
 namespace kio {
 
@@ -36,6 +39,10 @@ struct ClusterLimits {
     size_t max_version_size;
     size_t max_value_size;
     uint32_t max_range_elements;
+    /* Values are stored in chunks of this size, max_value_size is a multiple of it. */
+    size_t chunk_size;
+    /* Parity chunks of a written value that are kept with the value for updating them incrementally. */
+    size_t parity_size;
 };
 
 struct ClusterStats {
@@ -59,8 +66,40 @@ struct ClusterStats {
 
     /* Cluster health as defined in AdminClusterInterface */
     ClusterStatus health;
+
+    /* Latency statistics of each drive, slow drives are avoided when reading */
+    struct DriveLatency {
+        std::string name;
+        bool slow;
+        std::map<std::pair<OperationType, SizeClass>, LatencyStats> latency;
+    };
+    std::vector<DriveLatency> drive_latency;
+
+    /* Delay after which reads request parity chunks, zero if reads are not hedged */
+    std::chrono::microseconds hedge_delay;
 };
 
+/* Result of an asynchronous cluster operation. */
+struct AsyncResult {
+    /* Status of the operation */
+    kinetic::KineticStatus status;
+
+    /* Key version, set by get and put operations on success */
+    std::shared_ptr<const std::string> version;
+
+    /* Value, set by get operations that read the value on success */
+    std::shared_ptr<const ChunkedValue> value;
+
+    /* Keys, set by range operations on success */
+    std::shared_ptr<const std::vector<std::string>> keys;
+
+    explicit AsyncResult(const kinetic::KineticStatus& status) : status(status), version(), value(), keys()
+    { }
+};
+
+/* Called with the result once an asynchronous cluster operation completed. */
+typedef std::function<void(const AsyncResult&)> AsyncCallback;
+
 class CompareEnum {
 public:
   template<typename T>
@@ -130,6 +169,33 @@ public:
       std::shared_ptr<const std::string>& version,
       std::shared_ptr<const std::string>& value) = 0;
 
+  //----------------------------------------------------------------------------
+  //! Get the value and version associated with the supplied key. The value
+  //! is returned in chunks of the cluster chunk_size limit, clusters storing
+  //! values in chunks can return them without assembling a single string.
+  //! The default implementation copies the value into chunks.
+  //
+  //! @param key the key
+  //! @param version stores the version upon success, not modified on error
+  //! @param value stores the value upon success, not modified on error
+  //! @return status of operation
+  //----------------------------------------------------------------------------
+  virtual kinetic::KineticStatus get(
+      const std::shared_ptr<const std::string>& key,
+      std::shared_ptr<const std::string>& version,
+      std::shared_ptr<const ChunkedValue>& value)
+  {
+    std::shared_ptr<const std::string> string_value;
+    auto status = get(key, version, string_value);
+    if (status.ok()) {
+      value = std::make_shared<const ChunkedValue>(
+          limits().chunk_size ? limits().chunk_size : limits().max_value_size,
+          string_value ? *string_value : std::string()
+      );
+    }
+    return status;
+  }
+
   //----------------------------------------------------------------------------
   //! Get the version associated with the supplied key. Value will not be
   //! read in from the backend.
@@ -142,6 +208,30 @@ public:
       const std::shared_ptr<const std::string>& key,
       std::shared_ptr<const std::string>& version) = 0;
 
+  //----------------------------------------------------------------------------
+  //! Get values and versions associated with multiple keys at once. The
+  //! default implementation gets the keys one after the other, clusters
+  //! capable of executing multiple requests concurrently should overwrite it.
+  //
+  //! @param keys the keys
+  //! @param versions stores the version for each key, empty on error
+  //! @param values stores the value for each key, empty on error
+  //! @return status of operation for each key
+  //----------------------------------------------------------------------------
+  virtual std::vector<kinetic::KineticStatus> multiGet(
+      const std::vector<std::shared_ptr<const std::string>>& keys,
+      std::vector<std::shared_ptr<const std::string>>& versions,
+      std::vector<std::shared_ptr<const ChunkedValue>>& values)
+  {
+    std::vector<kinetic::KineticStatus> status;
+    versions.assign(keys.size(), std::shared_ptr<const std::string>());
+    values.assign(keys.size(), std::shared_ptr<const ChunkedValue>());
+    for (size_t i = 0; i < keys.size(); i++) {
+      status.push_back(get(keys[i], versions[i], values[i]));
+    }
+    return status;
+  }
+
   //----------------------------------------------------------------------------
   //! Write the supplied key-value pair to the cluster. Put is conditional on
   //! the supplied version existing on the cluster.
@@ -159,6 +249,28 @@ public:
       std::shared_ptr<const std::string>& version_out) = 0;
 
 
+  //----------------------------------------------------------------------------
+  //! Write the supplied key-value pair to the cluster. Put is conditional on
+  //! the supplied version existing on the cluster. If the chunk capacity of
+  //! the value equals the cluster chunk_size limit, the value chunks will be
+  //! written without copying them. The default implementation copies the
+  //! value into a single string.
+  //!
+  //! @param key the key
+  //! @param version existing version expected in the cluster, empty for none.
+  //! @param value value to store
+  //! @param version_out contains new key version on success
+  //! @return status of operation
+  //----------------------------------------------------------------------------
+  virtual kinetic::KineticStatus put(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      const std::shared_ptr<const ChunkedValue>& value,
+      std::shared_ptr<const std::string>& version_out)
+  {
+    return put(key, version, value ? value->toString() : std::shared_ptr<const std::string>(), version_out);
+  }
+
   //----------------------------------------------------------------------------
   //! Write the supplied key-value pair to the cluster. Put is not conditional,
   //! will always overwrite potentially existing data.
@@ -173,6 +285,25 @@ public:
       const std::shared_ptr<const std::string>& value,
       std::shared_ptr<const std::string>& version_out) = 0;
 
+  //----------------------------------------------------------------------------
+  //! Write the supplied key-value pair to the cluster. Put is not conditional,
+  //! will always overwrite potentially existing data. Value chunks are
+  //! written without copying as for the conditional chunked put. The default
+  //! implementation copies the value into a single string.
+  //!
+  //! @param key the key
+  //! @param value value to store
+  //! @param version_out contains new key version on success
+  //! @return status of operation
+  //----------------------------------------------------------------------------
+  virtual kinetic::KineticStatus put(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const ChunkedValue>& value,
+      std::shared_ptr<const std::string>& version_out)
+  {
+    return put(key, value ? value->toString() : std::shared_ptr<const std::string>(), version_out);
+  }
+
   //----------------------------------------------------------------------------
   //! Delete the key on the cluster, conditional on supplied version matching
   //! the key version existing on the cluster.
@@ -222,11 +353,221 @@ public:
       std::unique_ptr<std::vector<std::string>>& keys,
       std::size_t max_elements = 0) = 0;
 
+  //----------------------------------------------------------------------------
+  //! Asynchronous operations: Each synchronous operation has a counterpart
+  //! that returns right away and calls the supplied callback with the result
+  //! once the operation completed. The callback may be called by the calling
+  //! thread or by a thread of the cluster, it should not block on other
+  //! asynchronous operations of the same cluster. The default implementations
+  //! execute the synchronous operation and call the callback from the calling
+  //! thread, clusters capable of executing operations asynchronously should
+  //! overwrite them. Overloads without callback return a future instead.
+  //----------------------------------------------------------------------------
+
+  //----------------------------------------------------------------------------
+  //! Get the value and version associated with the supplied key.
+  //!
+  //! @param key the key
+  //! @param skip_value if true, only the version is read
+  //! @param callback called with status, version and value
+  //----------------------------------------------------------------------------
+  virtual void getAsync(
+      const std::shared_ptr<const std::string>& key,
+      bool skip_value,
+      AsyncCallback callback)
+  {
+    std::shared_ptr<const std::string> version;
+    std::shared_ptr<const ChunkedValue> value;
+    AsyncResult result(skip_value ? get(key, version) : get(key, version, value));
+    result.version = version;
+    result.value = value;
+    callback(result);
+  }
+
+  std::future<AsyncResult> getAsync(
+      const std::shared_ptr<const std::string>& key,
+      bool skip_value)
+  {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    auto future = promise->get_future();
+    getAsync(key, skip_value, std::bind(&ClusterInterface::fulfill, promise, std::placeholders::_1));
+    return future;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Write the supplied key-value pair to the cluster. Put is conditional on
+  //! the supplied version existing on the cluster.
+  //!
+  //! @param key the key
+  //! @param version existing version expected in the cluster, empty for none.
+  //! @param value value to store
+  //! @param callback called with status and new key version
+  //----------------------------------------------------------------------------
+  virtual void putAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      const std::shared_ptr<const ChunkedValue>& value,
+      AsyncCallback callback)
+  {
+    std::shared_ptr<const std::string> version_out;
+    AsyncResult result(put(key, version, value, version_out));
+    result.version = version_out;
+    callback(result);
+  }
+
+  std::future<AsyncResult> putAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      const std::shared_ptr<const ChunkedValue>& value)
+  {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    auto future = promise->get_future();
+    putAsync(key, version, value, std::bind(&ClusterInterface::fulfill, promise, std::placeholders::_1));
+    return future;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Write the supplied key-value pair to the cluster. Put is not conditional,
+  //! will always overwrite potentially existing data.
+  //!
+  //! @param key the key
+  //! @param value value to store
+  //! @param callback called with status and new key version
+  //----------------------------------------------------------------------------
+  virtual void putAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const ChunkedValue>& value,
+      AsyncCallback callback)
+  {
+    std::shared_ptr<const std::string> version_out;
+    AsyncResult result(put(key, value, version_out));
+    result.version = version_out;
+    callback(result);
+  }
+
+  std::future<AsyncResult> putAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const ChunkedValue>& value)
+  {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    auto future = promise->get_future();
+    putAsync(key, value, std::bind(&ClusterInterface::fulfill, promise, std::placeholders::_1));
+    return future;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Delete the key on the cluster, conditional on supplied version matching
+  //! the key version existing on the cluster.
+  //!
+  //! @param key     the key
+  //! @param version existing version expected in the cluster
+  //! @param callback called with status
+  //----------------------------------------------------------------------------
+  virtual void removeAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      AsyncCallback callback)
+  {
+    callback(AsyncResult(remove(key, version)));
+  }
+
+  std::future<AsyncResult> removeAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version)
+  {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    auto future = promise->get_future();
+    removeAsync(key, version, std::bind(&ClusterInterface::fulfill, promise, std::placeholders::_1));
+    return future;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Force delete the key on the cluster.
+  //!
+  //! @param key     the key
+  //! @param callback called with status
+  //----------------------------------------------------------------------------
+  virtual void removeAsync(
+      const std::shared_ptr<const std::string>& key,
+      AsyncCallback callback)
+  {
+    callback(AsyncResult(remove(key)));
+  }
+
+  std::future<AsyncResult> removeAsync(
+      const std::shared_ptr<const std::string>& key)
+  {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    auto future = promise->get_future();
+    removeAsync(key, std::bind(&ClusterInterface::fulfill, promise, std::placeholders::_1));
+    return future;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Flush all connections associated with this cluster.
+  //!
+  //! @param callback called with status
+  //----------------------------------------------------------------------------
+  virtual void flushAsync(AsyncCallback callback)
+  {
+    callback(AsyncResult(flush()));
+  }
+
+  std::future<AsyncResult> flushAsync()
+  {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    auto future = promise->get_future();
+    flushAsync(std::bind(&ClusterInterface::fulfill, promise, std::placeholders::_1));
+    return future;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Obtain keys in the supplied range [start,...,end].
+  //!
+  //! @param start  the start point of the requested key range
+  //! @param end    the end point of the requested key range
+  //! @param max_elements the maximum number of elements to return. 0 signifies
+  //!   the max_range_elements of the cluster.
+  //! @param callback called with status and keys
+  //----------------------------------------------------------------------------
+  virtual void rangeAsync(
+      const std::shared_ptr<const std::string>& start_key,
+      const std::shared_ptr<const std::string>& end_key,
+      std::size_t max_elements,
+      AsyncCallback callback)
+  {
+    std::unique_ptr<std::vector<std::string>> keys;
+    AsyncResult result(range(start_key, end_key, keys, max_elements));
+    result.keys = std::move(keys);
+    callback(result);
+  }
+
+  std::future<AsyncResult> rangeAsync(
+      const std::shared_ptr<const std::string>& start_key,
+      const std::shared_ptr<const std::string>& end_key,
+      std::size_t max_elements = 0)
+  {
+    auto promise = std::make_shared<std::promise<AsyncResult>>();
+    auto future = promise->get_future();
+    rangeAsync(start_key, end_key, max_elements,
+               std::bind(&ClusterInterface::fulfill, promise, std::placeholders::_1));
+    return future;
+  }
+
   //----------------------------------------------------------------------------
   //! Destructor.
   //----------------------------------------------------------------------------
   virtual ~ClusterInterface()
   { };
+
+private:
+  //----------------------------------------------------------------------------
+  //! Callback of asynchronous operations returning a future.
+  //----------------------------------------------------------------------------
+  static void fulfill(std::shared_ptr<std::promise<AsyncResult>> promise, const AsyncResult& result)
+  {
+    promise->set_value(result);
+  }
 };
 
 }
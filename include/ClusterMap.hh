@@ -48,12 +48,24 @@ struct ClusterInformation
   size_t numData;
   //! the number of parity blocks in a stripe
   size_t numParity;
+  //! the code used to compute parity blocks
+  RedundancyProvider::Codec codec;
+  //! the number of local parity blocks in a stripe, only used by the LRC code
+  size_t numLocalParity;
   //! the size of a single data / parity block in bytes
   size_t blockSize;
   //! minimum interval between reconnection attempts to a drive (rate limit)
   std::chrono::seconds min_reconnect_interval;
   //! interval after which an operation will timeout without response
   std::chrono::seconds operation_timeout;
+  //! percentile of recent get latencies after which parity chunks are read as well, 0 to disable
+  size_t readHedgePercentile;
+  //! time small requests wait to be sent together with concurrent requests to the same drive
+  std::chrono::microseconds batch_window;
+  //! the number of connections to each drive
+  size_t connections_per_drive;
+  //! the strategy to pick one of the connections to a drive for a request
+  KineticAutoConnection::Selection connection_selection;
   //! the unique ids of drives belonging to this cluster
   std::vector<std::string> drives;
 };
@@ -94,10 +106,29 @@ public:
     std::unordered_map<std::string, std::pair<kinetic::ConnectionOptions, kinetic::ConnectionOptions>> driveInfo
   );
 
+  //--------------------------------------------------------------------------
+  //! Change the configuration of the socket listener shared by all clusters.
+  //!
+  //! @param threads the number of listener threads
+  //! @param pinning if true, listener threads are pinned to one cpu each
+  //--------------------------------------------------------------------------
+  void changeListenerConfiguration(size_t threads, bool pinning);
+
+  //--------------------------------------------------------------------------
+  //! Change the completion configuration of clusters. Only affects clusters
+  //! created afterwards, clusters are re-created after a reset.
+  //!
+  //! @param threads the number of threads completing asynchronous operations
+  //! @param queue_depth the maximum number of queued completed operations
+  //--------------------------------------------------------------------------
+  void changeCompletionConfiguration(size_t threads, size_t queue_depth);
+
   //--------------------------------------------------------------------------
   //! Constructor.
+  //!
+  //! @param pool the buffer pool used by the redundancy providers of clusters
   //--------------------------------------------------------------------------
-  explicit ClusterMap();
+  explicit ClusterMap(std::shared_ptr<BufferPool> pool);
 
 private:
   //! epoll listener loop shared among all connections of clusters in this cluster map
@@ -116,6 +147,15 @@ private:
   //! among multiple cluster instances
   std::unordered_map<std::string, std::shared_ptr<RedundancyProvider>> rpCache;
 
+  //! the buffer pool used by redundancy providers
+  std::shared_ptr<BufferPool> bufferPool;
+
+  //! the number of threads completing asynchronous operations of a cluster
+  size_t completion_threads;
+
+  //! the maximum number of completed asynchronous operations queued by a cluster
+  size_t completion_queue_depth;
+
   //! concurrency control
   std::mutex mutex;
 };
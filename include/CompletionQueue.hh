@@ -0,0 +1,148 @@
+//------------------------------------------------------------------------------
+//! @file CompletionQueue.hh
+//! @author Paul Hermann Lensing
+//! @brief Completes asynchronous cluster operations without a thread per operation.
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#ifndef KINETICIO_COMPLETIONQUEUE_HH
+#define KINETICIO_COMPLETIONQUEUE_HH
+
+/*----------------------------------------------------------------------------*/
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "BackgroundOperationHandler.hh"
+#include "KineticClusterOperation.hh"
+/*----------------------------------------------------------------------------*/
+
+namespace kio {
+
+//------------------------------------------------------------------------------
+//! Waits for any number of submitted cluster operations in a single thread.
+//! Once the result of an operation is available, its completion function is
+//! executed by a worker thread. The polling thread never blocks on the
+//! workers, completion functions that can not be queued for the workers are
+//! held back until a worker becomes available. Threadsafe.
+//------------------------------------------------------------------------------
+class CompletionQueue {
+public:
+  //--------------------------------------------------------------------------
+  //! Add a cluster operation whose operation vector has been submitted. The
+  //! completion function is executed as soon as waitOperationVector() would
+  //! return without blocking or the supplied deadline has passed. The queue
+  //! may not be accessed by the operation until then. If the queue is being
+  //! destructed, the completion function is executed by the calling thread.
+  //!
+  //! @param operation the cluster operation
+  //! @param timeout_time the point of time all operations time out
+  //! @param deadline the point of time the completion function is executed
+  //!   even if operations are still outstanding, time_point::max() for none
+  //! @param complete the completion function, may block but should not wait
+  //!   for other operations of this queue to complete
+  //--------------------------------------------------------------------------
+  void add(const std::shared_ptr<KineticClusterOperation>& operation,
+           const std::chrono::system_clock::time_point& timeout_time,
+           const std::chrono::system_clock::time_point& deadline,
+           std::function<void()> complete);
+
+  //--------------------------------------------------------------------------
+  //! Execute the supplied function by a worker thread once the supplied
+  //! point of time has passed, so that completion functions can wait for
+  //! something without blocking a worker. If the queue is being destructed,
+  //! the function is executed by the calling thread.
+  //!
+  //! @param when the point of time to execute the function at
+  //! @param function the function
+  //--------------------------------------------------------------------------
+  void schedule(const std::chrono::system_clock::time_point& when, std::function<void()> function);
+
+  //--------------------------------------------------------------------------
+  //! Execute the supplied function in a separate thread, for completion
+  //! functions that may block for a long time (e.g. waiting for concurrent
+  //! writers) and should not hold up the completion of other operations. If
+  //! worker_threads such functions are already running, the function is
+  //! executed by the calling thread.
+  //!
+  //! @param function the function
+  //--------------------------------------------------------------------------
+  void offload(std::function<void()> function);
+
+  //--------------------------------------------------------------------------
+  //! Constructor.
+  //!
+  //! @param worker_threads number of threads executing completion functions,
+  //!   has to be > 0
+  //! @param queue_depth maximum number of completion functions queued for
+  //!   execution, has to be > 0
+  //--------------------------------------------------------------------------
+  explicit CompletionQueue(size_t worker_threads, size_t queue_depth);
+
+  //--------------------------------------------------------------------------
+  //! Destructor. Completion functions of operations still in the queue are
+  //! executed right away, the destructor returns once all have finished.
+  //--------------------------------------------------------------------------
+  ~CompletionQueue();
+
+  //--------------------------------------------------------------------------
+  //! No copy constructor.
+  //--------------------------------------------------------------------------
+  CompletionQueue(CompletionQueue&) = delete;
+
+  //--------------------------------------------------------------------------
+  //! No copy assignment.
+  //--------------------------------------------------------------------------
+  void operator=(CompletionQueue&) = delete;
+
+private:
+  struct Entry;
+  struct State;
+
+  //--------------------------------------------------------------------------
+  //! Registered as listener of queued operations, marks the entry to be
+  //! polled. The state is shared with the listeners, as results of cancelled
+  //! operations may still arrive after an entry has been removed.
+  //--------------------------------------------------------------------------
+  static void signal(std::shared_ptr<State> state, std::weak_ptr<Entry> entry);
+
+  //--------------------------------------------------------------------------
+  //! Executed by worker threads, wakes up the poller if completion functions
+  //! are held back as the worker frees a queue slot.
+  //--------------------------------------------------------------------------
+  static void execute(std::shared_ptr<State> state, std::function<void()> function);
+
+  //--------------------------------------------------------------------------
+  //! Poll queued operations whenever they received results or reached their
+  //! wakeup time, hand completed ones to the worker threads.
+  //--------------------------------------------------------------------------
+  void run();
+
+private:
+  //! queued operations and synchronization
+  std::shared_ptr<State> state;
+  //! executes completion functions
+  BackgroundOperationHandler workers;
+  //! executes offloaded functions in one-shot threads
+  BackgroundOperationHandler offloaded;
+  //! polls queued operations
+  std::thread poller;
+};
+
+}
+
+#endif  // KINETICIO_COMPLETIONQUEUE_HH
@@ -28,7 +28,11 @@
 #include <string>
 #include <mutex>
 #include <list>
+#include <map>
+#include <functional>
+#include <system_error>
 #include "ClusterInterface.hh"
+#include "ChunkedValue.hh"
 /*----------------------------------------------------------------------------*/
 
 namespace kio {
@@ -39,7 +43,7 @@ namespace kio {
 //! caller will have to do appropriate locking himself. Block size depends on
 //! cluster configuration. Is threadsafe to enable background flushing.
 //------------------------------------------------------------------------------
-class DataBlock
+class DataBlock : public std::enable_shared_from_this<DataBlock>
 {
   friend class DataCache;
 public:
@@ -49,6 +53,9 @@ public:
   //! Enum for different initialization modes
   enum class Mode { STANDARD, CREATE };
 
+  //! Called once an asynchronous flush or refresh completed, the error is set on failure
+  typedef std::function<void(const std::error_code&)> FlushCallback;
+
 public:
   //--------------------------------------------------------------------------
   //! Reading is guaranteed up-to-date within expiration_time limits. Note that
@@ -62,6 +69,32 @@ public:
   //--------------------------------------------------------------------------
   void read(char* const buffer, size_t offset, size_t length);
 
+  //--------------------------------------------------------------------------
+  //! Read from the value held in memory only, never does any I/O. Unlike
+  //! read, the version is not validated against the backend, call
+  //! refreshAsync first to bring the value up to date.
+  //!
+  //! @param buffer output buffer
+  //! @param offset offset in the block to start reading
+  //! @param length number of bytes to read
+  //! @param size set to the value size if the value is in memory
+  //! @return true if the value is in memory, false if it has to be read
+  //!   from the backend first
+  //--------------------------------------------------------------------------
+  bool readResident(char* const buffer, size_t offset, size_t length, size_t& size);
+
+  //--------------------------------------------------------------------------
+  //! Bring the value held in memory up to date asynchronously, as read does
+  //! before reading. Once the value expired, its version is validated
+  //! against the backend and the value is only read again if the version
+  //! changed. The block has to be owned by a shared_ptr, it is kept alive
+  //! until the callback has been called. If the value is up to date, the
+  //! callback is called by the calling thread.
+  //!
+  //! @param callback called once the value is up to date
+  //--------------------------------------------------------------------------
+  void refreshAsync(FlushCallback callback);
+
   //--------------------------------------------------------------------------
   //! Writing in-memory only, never flushes to the backend. Any write up to the
   //! value size limit of the assigned cluster is legal. Writes do not have to
@@ -85,6 +118,16 @@ public:
   //--------------------------------------------------------------------------
   void flush();
 
+  //--------------------------------------------------------------------------
+  //! Flush all changes to the backend asynchronously using the cluster
+  //! async path. The block has to be owned by a shared_ptr, it is kept
+  //! alive until the callback has been called. Writes to the block while the
+  //! flush is outstanding are allowed, they will not be covered by it.
+  //!
+  //! @param callback called once the flush completed
+  //--------------------------------------------------------------------------
+  void flushAsync(FlushCallback callback);
+
   //--------------------------------------------------------------------------
   //! Return the actual value size. Is up-to-date within expiration_time limits.
   //!
@@ -99,6 +142,14 @@ public:
   //--------------------------------------------------------------------------
   std::size_t capacity() const;
 
+  //--------------------------------------------------------------------------
+  //! Return the maximum amount of memory used by the block, including the
+  //! parity chunks retained after writing the value.
+  //!
+  //! @return size in bytes
+  //--------------------------------------------------------------------------
+  std::size_t footprint() const;
+
   //--------------------------------------------------------------------------
   //! Test for your flushing needs. Block is considered dirty if it is either
   //! freshly created or it has been written to since its last flush.
@@ -107,6 +158,42 @@ public:
   //--------------------------------------------------------------------------
   bool dirty() const;
 
+  //--------------------------------------------------------------------------
+  //! Test if the next read would have to get the value from the backend
+  //! without any prior version validation, e.g. because the block has never
+  //! been read. Does not do any I/O.
+  //!
+  //! @return true if the value has to be read from the backend
+  //--------------------------------------------------------------------------
+  bool requiresRemoteValue();
+  //--------------------------------------------------------------------------
+  //! Test if flushing would have to read the value from the backend first
+  //! in order to merge in local changes. This is not the case if the block
+  //! has been read or flushed before, or if local changes replace the
+  //! complete value. Does not do any I/O.
+  //!
+  //! @return true if flushing requires reading the remote value
+  //--------------------------------------------------------------------------
+  bool flushRequiresRemoteValue();
+  //--------------------------------------------------------------------------
+  //! Set the value of the block to a value that has been read from the
+  //! backend by the caller, for example as part of a multi-key get. Local
+  //! changes are merged in. Ignored if the block no longer requires a remote
+  //! value or the supplied status indicates an error.
+  //!
+  //! @param status the status of the get operation
+  //! @param version the version returned by the get operation
+  //! @param value the value returned by the get operation
+  //--------------------------------------------------------------------------
+  void setRemoteValue(const kinetic::KineticStatus& status,
+                      const std::shared_ptr<const std::string>& version,
+                      const std::shared_ptr<const ChunkedValue>& value);
+  //--------------------------------------------------------------------------
+  //! Return the name of the block.
+  //!
+  //! @return the key of the block
+  //--------------------------------------------------------------------------
+  const std::shared_ptr<const std::string>& getKey() const;
   //--------------------------------------------------------------------------
   //! The identity string of a block combines the set cluster and key to form
   //! an identifier. As this identifier depends on the cluster object it will 
@@ -163,7 +250,107 @@ private:
   //! via write and / or truncate on the local copy of the value.
   //--------------------------------------------------------------------------
   void getRemoteValue();
-  
+  //--------------------------------------------------------------------------
+  //! Merges any existing local changes into the value read from the backend.
+  //!
+  //! @param status the status of the get operation reading the remote value
+  //--------------------------------------------------------------------------
+  void mergeRemoteValue(const kinetic::KineticStatus& status);
+  //--------------------------------------------------------------------------
+  //! Implementation of requiresRemoteValue, block mutex has to be held.
+  //--------------------------------------------------------------------------
+  bool needsRemoteValue() const;
+  //--------------------------------------------------------------------------
+  //! Test if the regions changed since the last flush cover the complete
+  //! value, so that the remote value does not affect the flushed value.
+  //! Block mutex has to be held.
+  //--------------------------------------------------------------------------
+  bool overwritesRemoteValue() const;
+  //--------------------------------------------------------------------------
+  //! Add a region to the regions changed since the last flush. Block mutex
+  //! has to be held.
+  //!
+  //! @param start first byte of the region
+  //! @param end first byte following the region
+  //--------------------------------------------------------------------------
+  void addWrittenRegion(size_t start, size_t end);
+  //--------------------------------------------------------------------------
+  //! Return the chunk capacity used for the local value, equals the chunk
+  //! size of the assigned cluster so that values can be put without copying.
+  //!
+  //! @return chunk capacity in bytes
+  //--------------------------------------------------------------------------
+  std::size_t chunkCapacity() const;
+  //--------------------------------------------------------------------------
+  //! Create a modifiable copy of the remote value. Chunks are shared with
+  //! the remote value and only copied once they are written to.
+  //!
+  //! @return a copy of the remote value, or an empty value if there is none
+  //--------------------------------------------------------------------------
+  std::shared_ptr<ChunkedValue> copyRemoteValue() const;
+  //--------------------------------------------------------------------------
+  //! Flush asynchronously based on the remote value, as done by flush if the
+  //! block has never been read or a put failed due to a version mismatch.
+  //! Block mutex has to be held, it is released before any request is
+  //! issued.
+  //!
+  //! @param lock the held block mutex
+  //! @param callback the flush callback
+  //--------------------------------------------------------------------------
+  void flushRemote(std::unique_lock<std::mutex>& lock, FlushCallback callback);
+  //--------------------------------------------------------------------------
+  //! Merge local changes into the remote value read by flushRemote, then put
+  //! the merged value.
+  //!
+  //! @param expected_version the version of the block when the get was issued
+  //! @param callback the flush callback
+  //! @param result the result of reading the remote value
+  //--------------------------------------------------------------------------
+  void flushMerge(std::shared_ptr<const std::string> expected_version, FlushCallback callback,
+                  const AsyncResult& result);
+  //--------------------------------------------------------------------------
+  //! Put a snapshot of the current value asynchronously. Block mutex has to
+  //! be held, it is released before the put is issued.
+  //!
+  //! @param lock the held block mutex
+  //! @param overwrite if true, the put is not conditional on the version
+  //! @param callback the flush callback
+  //--------------------------------------------------------------------------
+  void flushPut(std::unique_lock<std::mutex>& lock, bool overwrite, FlushCallback callback);
+  //--------------------------------------------------------------------------
+  //! Complete an asynchronous flush. Changes are only marked as flushed if
+  //! the block has not been modified or flushed by anyone else in the
+  //! meantime.
+  //!
+  //! @param value the value that has been put
+  //! @param expected_version the version of the block when the put was issued
+  //! @param flushed_updates the number of updates covered by the put
+  //! @param callback the flush callback
+  //! @param result the result of the put
+  //--------------------------------------------------------------------------
+  void flushComplete(std::shared_ptr<const ChunkedValue> value,
+                     std::shared_ptr<const std::string> expected_version, size_t flushed_updates,
+                     FlushCallback callback, const AsyncResult& result);
+  //--------------------------------------------------------------------------
+  //! Complete the version validation of refreshAsync, reads the value if
+  //! the remote version differs from the version held in memory.
+  //!
+  //! @param expected_version the version of the block when the get was issued
+  //! @param callback the refresh callback
+  //! @param result the result of reading the remote version
+  //--------------------------------------------------------------------------
+  void refreshVersion(std::shared_ptr<const std::string> expected_version, FlushCallback callback,
+                      const AsyncResult& result);
+  //--------------------------------------------------------------------------
+  //! Complete refreshAsync by merging local changes into the value read.
+  //!
+  //! @param expected_version the version of the block when the get was issued
+  //! @param callback the refresh callback
+  //! @param result the result of reading the remote value
+  //--------------------------------------------------------------------------
+  void refreshValue(std::shared_ptr<const std::string> expected_version, FlushCallback callback,
+                    const AsyncResult& result);
+
 private:
   //! setting the block mode can increase performance by preventing unnecessary
   //! I/O in some cases.
@@ -178,11 +365,12 @@ private:
   //! the latest known version of the key that is stored in the cluster
   std::shared_ptr<const std::string> version;
   
-  //! the latest known data of the key that is stored in the cluster
-  std::shared_ptr<const std::string> remote_value; 
+  //! the latest known data of the key that is stored in the cluster, reads
+  //! are served directly from its chunks
+  std::shared_ptr<const ChunkedValue> remote_value;
 
   //! if data is written, the local_value will replace the remote value 
-  std::shared_ptr<std::string> local_value;
+  std::shared_ptr<ChunkedValue> local_value;
   
   //! keeping track of the value size, since value may be pre-allocated to maximum size for efficiency
   std::size_t value_size;
@@ -191,6 +379,11 @@ private:
   //! last been flushed (offset, length)
   std::list<std::pair<size_t, size_t> > updates;
 
+  //! the regions that have been changed since this data block has last been
+  //! flushed, merged and ordered (start -> end). A truncate changes
+  //! everything from the truncation offset up to capacity.
+  std::map<size_t, size_t> written;
+
   //! time the block was last verified to be up to date
   std::chrono::system_clock::time_point timestamp;
   
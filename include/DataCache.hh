@@ -26,12 +26,16 @@
 #include "PrefetchOracle.hh"
 #include "BackgroundOperationHandler.hh"
 #include "DataBlock.hh"
+#include "BlockMap.hh"
 #include <unordered_map>
 #include <condition_variable>
 #include <exception>
 #include <mutex>
 #include <memory>
 #include <set>
+#include <list>
+#include <vector>
+#include <atomic>
 /*----------------------------------------------------------------------------*/
 
 namespace kio {
@@ -40,12 +44,43 @@ namespace kio {
 class FileIo;
 
 //----------------------------------------------------------------------------
-//! LRU cache for Data. Threadsafe. Will create blocks
-//! that are not in cache automatically during get()
+//! Cache for Data. Threadsafe. Will create blocks that are not in cache
+//! automatically during get(). To reduce lock contention the cache is split
+//! into shards, capacity is enforced for the cache as a whole. The
+//! replacement policy can be chosen at runtime.
 //----------------------------------------------------------------------------
 class DataCache {
 
 public:
+  //--------------------------------------------------------------------------
+  //! Available replacement policies.
+  //!
+  //! LRU: evict the least recently used block.
+  //! TWO_Q: scan resistant 2Q. Blocks enter a FIFO probation queue and are
+  //!   only admitted to the main LRU queue if they are accessed again after
+  //!   having been evicted from probation. Blocks read once, e.g. by a large
+  //!   sequential read or readahead, will not displace frequently used
+  //!   blocks.
+  //--------------------------------------------------------------------------
+  enum class Policy { LRU, TWO_Q };
+
+  //--------------------------------------------------------------------------
+  //! Cache statistics, counted since the replacement policy was last set.
+  //--------------------------------------------------------------------------
+  struct Statistics {
+    //! the replacement policy the counters apply to
+    Policy policy;
+    //! number of requests served from the cache
+    uint64_t hits;
+    //! number of requests that required adding a block to the cache
+    uint64_t misses;
+    //! number of blocks evicted due to cache pressure
+    uint64_t evictions;
+    //! number of missed blocks admitted to the 2Q main queue directly, as
+    //! they have recently been evicted from probation
+    uint64_t ghost_hits;
+  };
+
   //--------------------------------------------------------------------------
   //! Return the data block associated with the supplied owner and block
   //! number.
@@ -68,6 +103,16 @@ public:
   //--------------------------------------------------------------------------
   void flush(kio::FileIo* owner);
 
+  //--------------------------------------------------------------------------
+  //! Flushes all dirty data associated with the owner asynchronously, blocks
+  //! are flushed concurrently.
+  //!
+  //! @param owner a pointer to the kio::FileIo object the data belongs to
+  //! @param callback called once all blocks have been flushed, with the
+  //!   error of the first failed block if any
+  //--------------------------------------------------------------------------
+  void flushAsync(kio::FileIo* owner, DataBlock::FlushCallback callback);
+
   //--------------------------------------------------------------------------
   //! Drop the owner from the cache, optionally also drop associated blocks
   //! (dirty blocks will not be flushed in this case).
@@ -77,6 +122,25 @@ public:
   //--------------------------------------------------------------------------
   void drop(kio::FileIo* owner, bool force=false);
 
+  //--------------------------------------------------------------------------
+  //! Intern the supplied file name. Cache items are identified by file id
+  //! and block number instead of by key strings. Owners acquire the id of
+  //! their file once and have to release it when they no longer use it.
+  //! Ids are never re-used.
+  //!
+  //! @param name the file name, has to identify the cluster instance as
+  //!   well as the path
+  //! @return the file id, equal for all owners of the same file
+  //--------------------------------------------------------------------------
+  uint64_t acquireFileId(const std::string& name);
+
+  //--------------------------------------------------------------------------
+  //! Release a file id obtained by acquireFileId.
+  //!
+  //! @param id the file id
+  //--------------------------------------------------------------------------
+  void releaseFileId(uint64_t id);
+
   //--------------------------------------------------------------------------
   //! Return current cache utilization as a double value between 0 and 1.
   //!
@@ -84,20 +148,31 @@ public:
   //--------------------------------------------------------------------------
   double utilization();
 
+  //--------------------------------------------------------------------------
+  //! Return hit, miss and eviction counters of the current replacement
+  //! policy.
+  //!
+  //! @return cache statistics
+  //--------------------------------------------------------------------------
+  Statistics statistics();
+
   //--------------------------------------------------------------------------
   //! The configuration of an existing ClusterChunkCache object can be changed
-  //! during runtime.
+  //! during runtime. Changing the replacement policy resets statistics.
   //!
   //! @param capacity absolute maximum size of the cache in bytes
+  //! @param policy the replacement policy
   //--------------------------------------------------------------------------
-  void changeConfiguration(size_t capacity);
+  void changeConfiguration(size_t capacity, Policy policy = Policy::LRU);
 
   //--------------------------------------------------------------------------
   //! Constructor.
   //!
   //! @param capacity absolute maximum size of the cache in bytes
+  //! @param num_shards number of independently locked cache shards
+  //! @param policy the replacement policy
   //--------------------------------------------------------------------------
-  explicit DataCache(size_t capacity);
+  explicit DataCache(size_t capacity, size_t num_shards = 16, Policy policy = Policy::LRU);
 
   //--------------------------------------------------------------------------
   //! No copy constructor.
@@ -113,27 +188,32 @@ private:
   //! maximum size of the cache (hard cap), atomic so it may be changed during runtime
   std::atomic<size_t> capacity;
 
-  //! current size of the cache
+  //! current size of the cache, summed over all shards
   std::atomic<size_t> current_size;
 
-  //! current size of the unused items list
-  size_t unused_size;
-  
+  //! the replacement policy, shards keep a copy that is updated under the shard mutex
+  std::atomic<Policy> policy;
+
+  //! the shard shrunk next if the cache exceeds its capacity
+  std::atomic<size_t> next_shrink_shard;
+
+  //! statistics counters
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<uint64_t> evictions;
+  std::atomic<uint64_t> ghost_hits;
+
   struct CacheItem {
     std::set<kio::FileIo*> owners;
     std::shared_ptr<kio::DataBlock> data;
     std::chrono::system_clock::time_point last_access;
+    uint64_t file_id;
+    int blocknumber;
+    //! true if the item is in the 2Q probation queue
+    bool probation;
   };
 
-  //! A linked list of data blocks stored in LRU order
-  std::list<CacheItem> cache;
-
-  // List of items that are no longer used but kept around for future re-use to avoid memory allocation. 
-  std::list<CacheItem> unused_items; 
-  
-  //! the lookup table
   typedef std::list<CacheItem>::iterator cache_iterator;
-  std::unordered_map<std::string, cache_iterator> lookup;
 
   //! comparison operator so we can create std::set<cache_iterator>
   struct cache_iterator_compare {
@@ -143,27 +223,163 @@ private:
     }
   };
 
-  //! keep set of cache items associated with each owner (for drop & flush commands)
-  std::unordered_map<const kio::FileIo*, std::set<cache_iterator, cache_iterator_compare>> owner_tables;
+  //--------------------------------------------------------------------------
+  //! An independently locked part of the cache. Every block is stored in
+  //! exactly one shard, chosen by hashing cluster instance, path and block
+  //! number. Each shard keeps its own replacement queues.
+  //--------------------------------------------------------------------------
+  struct Shard {
+    //! the replacement policy used by this shard
+    Policy policy;
+
+    //! current size of this shard
+    size_t current_size;
 
-  //! Thread safety when accessing cache structures (lookup table and lru list)
-  std::mutex cache_mutex;
+    //! current size of the unused items list
+    size_t unused_size;
+
+    //! A linked list of data blocks stored in LRU order (the 2Q main queue)
+    std::list<CacheItem> cache;
+
+    //! 2Q probation queue, data blocks stored in FIFO order
+    std::list<CacheItem> probation;
+
+    //! 2Q history of blocks evicted from probation, most recent first
+    std::list<std::pair<uint64_t, int>> ghosts;
+
+    //! lookup table for the ghost list
+    BlockMap<std::list<std::pair<uint64_t, int>>::iterator> ghost_lookup;
+
+    //! List of items that are no longer used but kept around for future re-use to avoid memory allocation.
+    std::list<CacheItem> unused_items;
+
+    //! the lookup table
+    BlockMap<cache_iterator> lookup;
+
+    //! keep set of cache items associated with each owner (for drop & flush commands)
+    std::unordered_map<const kio::FileIo*, std::set<cache_iterator, cache_iterator_compare>> owner_tables;
+
+    //! Thread safety when accessing shard structures (lookup table and lru list)
+    std::mutex mutex;
+
+    explicit Shard(Policy p) :
+        policy(p), current_size(0), unused_size(0), cache(), probation(), ghosts(), ghost_lookup(), unused_items(),
+        lookup(), owner_tables(), mutex() { }
+  };
+
+  //! the shards, the vector itself is constant after construction
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  struct FileIdEntry {
+    uint64_t id;
+    size_t references;
+  };
+
+  //! interned file names
+  std::unordered_map<std::string, FileIdEntry> file_ids;
+
+  //! reverse lookup of interned file names
+  std::unordered_map<uint64_t, std::string> file_names;
+
+  //! the id assigned to the next interned file name
+  uint64_t next_file_id;
+
+  //! Thread safety when accessing file id tables, never held while acquiring a shard mutex
+  std::mutex file_id_mutex;
 
 private:
   //--------------------------------------------------------------------------
-  //! Remove an item from the cache as well as the lookup table and from
-  //! associated owners.
+  //! Return the shard responsible for the supplied block.
+  //!
+  //! @param file_id the file id of the block
+  //! @param blocknumber the block number
+  //! @return the shard
+  //--------------------------------------------------------------------------
+  Shard& shard(uint64_t file_id, int blocknumber);
+
+  //--------------------------------------------------------------------------
+  //! Look up a cached block, updating LRU order and owner tables if it is
+  //! found. Shard mutex has to be held.
   //!
+  //! @param shard the shard responsible for the block
+  //! @param owner a pointer to the kio::FileIo object requesting the block
+  //! @param blocknumber the block number
+  //! @return the block if cached, an empty pointer otherwise
+  //--------------------------------------------------------------------------
+  std::shared_ptr<kio::DataBlock> lookup_item(Shard& shard, kio::FileIo* owner, int blocknumber);
+
+  //--------------------------------------------------------------------------
+  //! Collect all blocks associated with the owner, so that they can be
+  //! flushed without holding any shard mutex.
+  //!
+  //! @param owner a pointer to the kio::FileIo object the blocks belong to
+  //! @return the blocks
+  //--------------------------------------------------------------------------
+  std::vector<std::shared_ptr<kio::DataBlock>> owner_blocks(kio::FileIo* owner);
+
+  //--------------------------------------------------------------------------
+  //! Add a reference to an already acquired file id.
+  //!
+  //! @param id the file id
+  //--------------------------------------------------------------------------
+  void retainFileId(uint64_t id);
+
+  //--------------------------------------------------------------------------
+  //! Remove an item from the shard as well as the lookup table and from
+  //! associated owners. Shard mutex has to be held.
+  //!
+  //! @param shard the shard containing the item
   //! @param it an iterator to the element to be removed
   //! @return iterator to following element
   //!--------------------------------------------------------------------------
-  cache_iterator remove_item(const cache_iterator& it);
-  
+  cache_iterator remove_item(Shard& shard, const cache_iterator& it);
+
+  //--------------------------------------------------------------------------
+  //! Attempt to shrink the cache by discarding unused items from the
+  //! tail of the supplied shard. Shard mutex has to be held.
+  //!
+  //! @param shard the shard to shrink
+  //! @param dirty if set and clean items do not suffice, unused dirty items
+  //!   are added to be flushed by the caller once the mutex is released
+  //--------------------------------------------------------------------------
+  void try_shrink(Shard& shard, std::vector<std::shared_ptr<kio::DataBlock>>* dirty);
+
+  //--------------------------------------------------------------------------
+  //! Shrink shards round-robin as long as the cache exceeds its capacity.
+  //! If clean items do not suffice, dirty items are flushed without holding
+  //! any shard mutex and evicted in a second round. No shard mutex may be
+  //! held.
+  //--------------------------------------------------------------------------
+  void shrink_round_robin();
+
+  //--------------------------------------------------------------------------
+  //! Discard expired clean items from the tail of a queue. Dirty items are
+  //! flushed by the kio::WriteBackHandler.
+  //!
+  //! @param shard the shard containing the queue
+  //! @param queue the queue
+  //--------------------------------------------------------------------------
+  void shrink_expired(Shard& shard, std::list<CacheItem>& queue);
+
   //--------------------------------------------------------------------------
-  //! Attempt to shrink the cache by discarding unused items from the 
-  //! cache tail. 
+  //! Evict clean items from the tail of a queue as long as the cache exceeds
+  //! its capacity.
+  //!
+  //! @param shard the shard containing the queue
+  //! @param queue the queue
+  //! @param dirty if set, unused dirty items are added until they cover the
+  //!   amount the cache exceeds its capacity by
+  //--------------------------------------------------------------------------
+  void evict(Shard& shard, std::list<CacheItem>& queue, std::vector<std::shared_ptr<kio::DataBlock>>* dirty);
+
+  //--------------------------------------------------------------------------
+  //! Remember a block evicted from the 2Q probation queue.
+  //!
+  //! @param shard the shard
+  //! @param file_id the file id of the block
+  //! @param blocknumber the block number
   //--------------------------------------------------------------------------
-  void try_shrink(); 
+  void add_ghost(Shard& shard, uint64_t file_id, int blocknumber);
 };
 
 
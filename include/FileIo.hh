@@ -30,7 +30,10 @@
 #include <unordered_map>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <queue>
+#include <set>
 #include <list>
 
 namespace kio {
@@ -41,6 +44,7 @@ namespace kio {
 //------------------------------------------------------------------------------
 class FileIo : public FileIoInterface {
   friend class DataCache;
+  friend class WriteBackHandler;
 
 public:
   //--------------------------------------------------------------------------
@@ -75,6 +79,65 @@ public:
   //--------------------------------------------------------------------------
   int64_t Write(long long offset, const char* buffer, int length, uint16_t timeout = 0);
 
+  //--------------------------------------------------------------------------
+  //! Vectored read from file - sync. All data blocks touched by the request
+  //! are fetched concurrently before the data is copied to the chunk buffers.
+  //!
+  //! @param chunks list of offset, buffer and length triplets
+  //! @param timeout timeout value
+  //! @return total number of bytes read over all chunks
+  //--------------------------------------------------------------------------
+  int64_t ReadV(const std::vector<IoChunk>& chunks, uint16_t timeout = 0);
+
+  //--------------------------------------------------------------------------
+  //! Vectored write to file - sync
+  //!
+  //! @param chunks list of offset, buffer and length triplets
+  //! @param timeout timeout value
+  //! @return total number of bytes written over all chunks
+  //--------------------------------------------------------------------------
+  int64_t WriteV(const std::vector<IoWriteChunk>& chunks, uint16_t timeout = 0);
+
+  using FileIoInterface::ReadAsync;
+  using FileIoInterface::WriteAsync;
+  using FileIoInterface::SyncAsync;
+
+  //--------------------------------------------------------------------------
+  //! Read from file - async. Data blocks that are not cached are read and
+  //! expired blocks are validated concurrently using the cluster async path,
+  //! the data is copied to the buffer once all of them are up to date. The
+  //! end of the file is verified by the calling thread. If all data blocks
+  //! are cached and up to date, the callback is called by the calling thread.
+  //!
+  //! @param offset offset in file
+  //! @param buffer where the data is read
+  //! @param length read length
+  //! @param callback called with the number of bytes read
+  //! @param timeout timeout value
+  //--------------------------------------------------------------------------
+  void ReadAsync(long long offset, char* buffer, int length, IoCallback callback, uint16_t timeout = 0);
+
+  //--------------------------------------------------------------------------
+  //! Write to file - async. Writes complete once the data is in the cache,
+  //! the callback is called by the calling thread.
+  //!
+  //! @param offset offset
+  //! @param buffer data to be written
+  //! @param length length
+  //! @param callback called with the number of bytes written
+  //! @param timeout timeout value
+  //--------------------------------------------------------------------------
+  void WriteAsync(long long offset, const char* buffer, int length, IoCallback callback, uint16_t timeout = 0);
+
+  //--------------------------------------------------------------------------
+  //! Sync file to disk - async. Dirty data blocks are flushed concurrently
+  //! using the cluster async path.
+  //!
+  //! @param callback called once the file has been synced
+  //! @param timeout timeout value
+  //--------------------------------------------------------------------------
+  void SyncAsync(IoCallback callback, uint16_t timeout = 0);
+
   //--------------------------------------------------------------------------
   //! Truncate
   //!
@@ -173,6 +236,87 @@ private:
 
   int64_t ReadWrite(long long off, char* buffer, int length, rw mode, uint16_t timeout = 0);
 
+  //--------------------------------------------------------------------------
+  //! Write the supplied data into the cache and register the written blocks
+  //! with the write back handler. Does not wait for the data to be flushed.
+  //!
+  //! @param off the file offset to start writing
+  //! @param buffer the data to write
+  //! @param length the number of bytes to write
+  //! @return the number of bytes written
+  //--------------------------------------------------------------------------
+  int64_t writeCache(long long off, const char* buffer, int length);
+
+  //--------------------------------------------------------------------------
+  //! Throw the oldest exception stored by a background flush, if any.
+  //--------------------------------------------------------------------------
+  void throwFlushException();
+
+  struct ReadRequest;
+
+  //--------------------------------------------------------------------------
+  //! Called for each data block refreshed by ReadAsync, completes the
+  //! request once all blocks are up to date.
+  //!
+  //! @param request the read request
+  //! @param data the data block
+  //! @param error set if the block could not be refreshed
+  //--------------------------------------------------------------------------
+  void completeBlockRead(std::shared_ptr<ReadRequest> request, std::shared_ptr<kio::DataBlock> data,
+                         const std::error_code& error);
+
+  //--------------------------------------------------------------------------
+  //! Copy the data of a read request once all data blocks are available and
+  //! call the request callback. Data is only copied from blocks held in
+  //! memory, blocks that could not be read in fail the request.
+  //!
+  //! @param request the read request
+  //--------------------------------------------------------------------------
+  void completeRead(std::shared_ptr<ReadRequest> request);
+
+  //--------------------------------------------------------------------------
+  //! Called once background flushes of this object that were in progress
+  //! when SyncAsync was called completed, flushes the cache.
+  //!
+  //! @param callback the request callback
+  //--------------------------------------------------------------------------
+  void startCacheFlush(IoCallback callback);
+
+  //--------------------------------------------------------------------------
+  //! Called once SyncAsync flushed the cache, flushes the cluster.
+  //!
+  //! @param callback the request callback
+  //! @param error set if flushing the cache failed
+  //--------------------------------------------------------------------------
+  void completeCacheFlush(IoCallback callback, const std::error_code& error);
+
+  //--------------------------------------------------------------------------
+  //! Called once SyncAsync flushed the cluster.
+  //!
+  //! @param callback the request callback
+  //! @param result the result of flushing the cluster
+  //--------------------------------------------------------------------------
+  void completeSync(IoCallback callback, const AsyncResult& result);
+
+  //--------------------------------------------------------------------------
+  //! Register an outstanding asynchronous request.
+  //--------------------------------------------------------------------------
+  void beginAsync();
+
+  //--------------------------------------------------------------------------
+  //! Deregister an outstanding asynchronous request and call its callback.
+  //! The object may be destructed as soon as the request is deregistered.
+  //!
+  //! @param callback the request callback
+  //! @param result the request result
+  //--------------------------------------------------------------------------
+  void finishAsync(IoCallback callback, const IoResult& result);
+
+  //--------------------------------------------------------------------------
+  //! Block until all outstanding asynchronous requests completed.
+  //--------------------------------------------------------------------------
+  void waitAsync();
+
   //--------------------------------------------------------------------------
   //! Attempt to prefetch blocks based on the provided block number. If no
   //! access pattern can be detected, no io-threads are available or the cache
@@ -183,15 +327,17 @@ private:
   void scheduleReadahead(int blocknumber);
 
   //--------------------------------------------------------------------------
-  //! Schedule a background flush for the supplied data block.
+  //! Fetch the supplied data blocks concurrently with a single multi-key get
+  //! on the cluster. Blocks that are already cached are skipped, blocks that
+  //! could not be fetched will be read in on first access.
   //!
-  //! @param data the data to flush
+  //! @param blocknumbers ordered set of data block numbers to fetch
   //--------------------------------------------------------------------------
-  void scheduleFlush(std::shared_ptr<kio::DataBlock> data);
+  void fetchBlocks(const std::set<int>& blocknumbers);
 
   //--------------------------------------------------------------------------
   //! Execute a flush operation. As this function is intended to be run
-  //! by one of the background io threads, a possibly thrown exception will
+  //! by the write back handler, a possibly thrown exception will
   //! be stored in this FileIo's exception queue.
   //!
   //! @param data the data to flush to the backend
@@ -217,12 +363,19 @@ protected:
   //! read-ahead
   PrefetchOracle prefetchOracle;
 
-  //! the currently last block number
-  int eof_blocknumber;
+  //! thread safety when accessing prefetchOracle
+  std::mutex readahead_mutex;
+
+  //! the currently last block number, raised by writes while asynchronous reads may access it. Lowered only by
+  //! compare and swap against the value read, so that a concurrent raise is never undone.
+  std::atomic<int> eof_blocknumber;
 
   //! time point it was verified that eof_blocknumber is in sync with the backend (multi-clients)
   std::chrono::system_clock::time_point eof_verification_time;
 
+  //! thread safety when verifying eof_blocknumber and accessing eof_verification_time
+  std::mutex eof_mutex;
+
   //! Exceptions occurring during background execution are stored and thrown at the next request.
   std::queue<std::system_error> exceptions;
 
@@ -234,6 +387,18 @@ protected:
 
   //! the extracted path from the full path 'kinetic:clusterId:path'
   std::string path;
+
+  //! the interned id of path and cluster instance, identifies file blocks in the data cache
+  uint64_t file_id;
+
+  //! number of outstanding asynchronous requests
+  size_t async_outstanding;
+
+  //! thread safety when accessing async_outstanding
+  std::mutex async_mutex;
+
+  //! notified when an asynchronous request completed
+  std::condition_variable async_cv;
 };
 
 }
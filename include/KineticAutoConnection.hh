@@ -28,26 +28,34 @@
 #include <memory>
 #include <mutex>
 #include <random>
+#include <atomic>
+#include <vector>
 #include "SocketListener.hh"
+#include "LatencyStatistics.hh"
+#include "KineticCallbacks.hh"
 #include "BackgroundOperationHandler.hh"
 #include "DestructionMutex.hh"
 
 namespace kio{
 
 //------------------------------------------------------------------------------
+//! A single member of the connection pool of a KineticAutoConnection.
 //! Wrapping kinetic::ThreadsafeNonblockingKineticConnection, (re)connecting
 //! automatically when the underlying connection is requested.
 //------------------------------------------------------------------------------
-class KineticAutoConnection {
+class PooledConnection {
 public:
   //--------------------------------------------------------------------------
   //! Set the connection error status if an operation on the connection
-  //! failed catastrophically.
+  //! failed catastrophically. Tracked commands that have not completed yet
+  //! fail right away.
   //!
   //! @param errorConnection the underlying connection for which an error was
   //!   observed.
+  //! @return true if errorConnection is the underlying connection of this
+  //!   pool member, false otherwise
   //--------------------------------------------------------------------------
-  void setError(std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& errorConnection);
+  bool setError(std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& errorConnection);
 
   //--------------------------------------------------------------------------
   //! Return copy of underlying connection pointer, reconnect if indicated by
@@ -59,33 +67,68 @@ public:
   std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> get();
 
   //--------------------------------------------------------------------------
-  //! Return human readable name of the auto connection. 
+  //! Return human readable name of the pool member.
   //--------------------------------------------------------------------------
   const std::string& getName() const;
-  
+
+  //--------------------------------------------------------------------------
+  //! Track a command issued on this pool member until it completes.
+  //!
+  //! @param callback the callback of the command
+  //--------------------------------------------------------------------------
+  void track(const std::shared_ptr<KineticCallback>& callback);
+
+  //--------------------------------------------------------------------------
+  //! Request the listener thread of this pool member to send the commands
+  //! issued on the supplied connection.
+  //!
+  //! @param con the underlying connection the commands have been issued on
+  //! @return false if con is not the healthy underlying connection of this
+  //!   pool member, true otherwise
+  //--------------------------------------------------------------------------
+  bool notify(const std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& con);
+
+  //--------------------------------------------------------------------------
+  //! @return the number of tracked commands that have not completed yet
+  //--------------------------------------------------------------------------
+  size_t outstanding();
+
+  //--------------------------------------------------------------------------
+  //! @return true if the supplied connection is the underlying connection of
+  //!   this pool member
+  //--------------------------------------------------------------------------
+  bool owns(const std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& con);
+
   //--------------------------------------------------------------------------
   //! Constructor.
   //!
+  //! @param sockwatch the listener to register the connection with
   //! @param options host / port / key of target kinetic drive
   //! @param ratelimit minimum time between reconnection attempts
-  //! @param min_getlog_interval minimum time between getlog attempts
+  //! @param name human readable name for logging purposes
+  //! @param preference 0 to prioritize the first interface of the drive, 1
+  //!   to prioritize the second, any other value to choose randomly
   //--------------------------------------------------------------------------
-  KineticAutoConnection(
+  PooledConnection(
       SocketListener& sockwatch,
       std::pair< kinetic::ConnectionOptions, kinetic::ConnectionOptions > options,
-      std::chrono::seconds ratelimit
+      std::chrono::seconds ratelimit,
+      std::string name,
+      int preference
   );
 
   //--------------------------------------------------------------------------
   //! Destructor.
   //--------------------------------------------------------------------------
-  ~KineticAutoConnection();
+  ~PooledConnection();
 
 private:
-  //! the two interfaces of the target drive, first interface will be prioritized
+  //! the two interfaces of the target drive
   const std::pair< kinetic::ConnectionOptions, kinetic::ConnectionOptions > options;
   //! minimum time between reconnection attempts
   const std::chrono::seconds ratelimit;
+  //! the interface to prioritize, random if neither 0 nor 1
+  const int preference;
   //! the underlying connection
   std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> connection;
   //! healthy if the underlying connection is believed to be currently working
@@ -96,6 +139,10 @@ private:
   std::string logstring;
   //! timestamp of the last connection attempt
   std::chrono::system_clock::time_point timestamp;
+  //! callbacks of commands issued on this pool member that may not have completed yet
+  std::vector<std::weak_ptr<KineticCallback>> inflight;
+  //! the number of tracked callbacks at which completed callbacks are removed
+  size_t inflight_prune;
   //! thread safety
   std::mutex mutex;
   //! use calling thread for initial connect
@@ -109,13 +156,150 @@ private:
   BackgroundOperationHandler bg;
 
 private:
+  //--------------------------------------------------------------------------
+  //! Remove callbacks of completed commands from inflight and set the size at
+  //! which to prune again to twice the remaining size. Mutex has to be held.
+  //--------------------------------------------------------------------------
+  void prune();
+
   //--------------------------------------------------------------------------
   //! Attempt to connect unless blocked by rate limit. Will attempt both host
-  //! names supplied to options and prioritize randomly.
+  //! names supplied to options, prioritized as configured.
   //--------------------------------------------------------------------------
   void connect();
 };
 
+//------------------------------------------------------------------------------
+//! Access to a single drive via a pool of connections, each (re)connecting
+//! automatically when the underlying connection is requested.
+//------------------------------------------------------------------------------
+class KineticAutoConnection {
+public:
+  //! Strategies to pick a pool member for a command.
+  enum class Selection {
+    ROUND_ROBIN, LEAST_OUTSTANDING
+  };
+
+  //--------------------------------------------------------------------------
+  //! Set the connection error status if an operation on the connection
+  //! failed catastrophically.
+  //!
+  //! @param errorConnection the underlying connection for which an error was
+  //!   observed.
+  //--------------------------------------------------------------------------
+  void setError(std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& errorConnection);
+
+  //--------------------------------------------------------------------------
+  //! Return copy of the underlying connection pointer of a pool member
+  //! selected according to the configured strategy. Unusable pool members
+  //! are skipped and reconnect in the background if allowed by rate limit.
+  //! Throws if no pool member is usable.
+  //!
+  //! @return copy of underlying connection pointer
+  //--------------------------------------------------------------------------
+  std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> get();
+
+  //--------------------------------------------------------------------------
+  //! Queue a command that has been issued on the supplied connection to be
+  //! sent by the next call to flush(). Commands queued by concurrent
+  //! operations are sent together, so that a single Run() call on the
+  //! connection pipelines all of them to the drive. Commands fail right
+  //! away if their connection goes into error state.
+  //!
+  //! @param con the underlying connection the command has been issued on
+  //! @param callback the callback of the command, notified if the command
+  //!   could not be sent
+  //--------------------------------------------------------------------------
+  void enqueue(const std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& con,
+               const std::shared_ptr<KineticCallback>& callback);
+
+  //--------------------------------------------------------------------------
+  //! Send all queued commands. Sending is done by the socket listener thread
+  //! of the connection as soon as the socket accepts data, the calling thread
+  //! does no socket I/O. If another thread is currently flushing this
+  //! connection, it will flush the queued commands as well and the call
+  //! returns immediately.
+  //--------------------------------------------------------------------------
+  void flush();
+
+  //--------------------------------------------------------------------------
+  //! @return the time small commands should wait for concurrent commands
+  //!   before being sent, zero if commands are sent right away
+  //--------------------------------------------------------------------------
+  std::chrono::microseconds batchWindow() const;
+
+  //--------------------------------------------------------------------------
+  //! Return human readable name of the auto connection. 
+  //--------------------------------------------------------------------------
+  const std::string& getName() const;
+
+  //--------------------------------------------------------------------------
+  //! @return latency statistics of operations executed on this connection
+  //--------------------------------------------------------------------------
+  LatencyStatistics& latency();
+
+  //--------------------------------------------------------------------------
+  //! @return true if the drive has been marked as slow compared to the other
+  //!   drives it is used with, false otherwise
+  //--------------------------------------------------------------------------
+  bool isSlow() const;
+
+  //--------------------------------------------------------------------------
+  //! Mark the drive as slow compared to the other drives it is used with.
+  //!
+  //! @param slow true if the drive is slow, false otherwise
+  //--------------------------------------------------------------------------
+  void setSlow(bool slow);
+
+  //--------------------------------------------------------------------------
+  //! Constructor.
+  //!
+  //! @param options host / port / key of target kinetic drive
+  //! @param ratelimit minimum time between reconnection attempts
+  //! @param batch_window time small commands wait for concurrent commands
+  //!   to be sent together
+  //! @param pool_size the number of connections to the drive, if larger than
+  //!   one both interfaces of the drive are used
+  //! @param selection the strategy to pick a pool member for a command
+  //--------------------------------------------------------------------------
+  KineticAutoConnection(
+      SocketListener& sockwatch,
+      std::pair< kinetic::ConnectionOptions, kinetic::ConnectionOptions > options,
+      std::chrono::seconds ratelimit,
+      std::chrono::microseconds batch_window = std::chrono::microseconds::zero(),
+      size_t pool_size = 1,
+      Selection selection = Selection::ROUND_ROBIN
+  );
+
+  //--------------------------------------------------------------------------
+  //! Destructor.
+  //--------------------------------------------------------------------------
+  ~KineticAutoConnection();
+
+private:
+  //! string representation of connection options for logging purposes
+  std::string logstring;
+  //! the connections to the drive
+  std::vector<std::unique_ptr<PooledConnection>> pool;
+  //! the strategy to pick a pool member for a command
+  const Selection selection;
+  //! the pool member to start selection with
+  std::atomic<size_t> next;
+  //! latency statistics of operations on this connection
+  LatencyStatistics latency_statistics;
+  //! true if the drive is slow compared to the other drives it is used with
+  std::atomic<bool> slow;
+  //! time small commands wait for concurrent commands to be sent together
+  const std::chrono::microseconds batch_window;
+  //! commands issued but not yet sent, with the connection they have been issued on
+  std::vector<std::pair<std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>,
+      std::shared_ptr<KineticCallback>>> batch;
+  //! true while a thread is sending queued commands
+  bool flushing;
+  //! concurrency control of queued commands
+  std::mutex batch_mutex;
+};
+
 }
 
 #endif	
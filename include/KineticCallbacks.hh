@@ -24,10 +24,12 @@
 #define  KINETICIO_OPERATIONCALLBACKS_HH
 
 #include <kinetic/kinetic.h>
+#include "LatencyStatistics.hh"
 #include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <map>
 #include <vector>
 #include <string>
 
@@ -42,14 +44,43 @@ class CallbackSynchronization {
 
 public:
   //----------------------------------------------------------------------------
-  //! Blocking wait until either the timeout point has passed or the number of
-  //! outstanding results reaches the supplied minimum.
+  //! Blocking wait until either the timeout point has passed or there are no
+  //! more outstanding results.
   //!
   //! @param timeout_time the point of time the function is guaranteed to return
-  //! @param min_outstanding the number of outstanding results to wait for
   //----------------------------------------------------------------------------
   void wait_until(std::chrono::system_clock::time_point timeout_time);
 
+  //----------------------------------------------------------------------------
+  //! Blocking wait until either the timeout point has passed, there are no
+  //! more outstanding results or more than the supplied number of results
+  //! have been received.
+  //!
+  //! @param timeout_time the point of time the function is guaranteed to return
+  //! @param last_received the number of results received when last checked
+  //! @return the number of results received
+  //----------------------------------------------------------------------------
+  size_t wait_until(std::chrono::system_clock::time_point timeout_time, size_t last_received);
+
+  //----------------------------------------------------------------------------
+  //! Register a function to be called whenever a result is received, allowing
+  //! to wait on multiple synchronization objects at once. The function is
+  //! called by the thread delivering the result without holding any locks.
+  //!
+  //! @param listener the function, replaces a previously registered one. An
+  //!   empty function unregisters.
+  //----------------------------------------------------------------------------
+  void setListener(std::function<void()> listener);
+
+  //----------------------------------------------------------------------------
+  //! Successful results reporting a version are tallied as they are received,
+  //! so that the result of a read can be decided without inspecting every
+  //! callback.
+  //!
+  //! @return the number of successful results of the most frequent version
+  //----------------------------------------------------------------------------
+  size_t versionFrequency();
+
   //----------------------------------------------------------------------------
   //! Constructor
   //----------------------------------------------------------------------------
@@ -63,10 +94,26 @@ public:
 private:
   //! the number of currently outstanding requests
   int outstanding;
+  //! the number of results received
+  size_t received;
   //! condition variable for wait_until functionality
   std::condition_variable cv;
+  //! called whenever a result is received
+  std::function<void()> listener;
+  //! the number of successful results for each reported version
+  std::map<std::string, size_t> versions;
+  //! the highest count in versions
+  size_t version_frequency;
   //! mutex for condition variable and thread safety
   std::mutex mutex;
+
+  //----------------------------------------------------------------------------
+  //! Add or remove a version to / from the tally, mutex has to be held.
+  //!
+  //! @param version the version
+  //! @param add true to add the version, false to remove it
+  //----------------------------------------------------------------------------
+  void tally(const std::string& version, bool add);
 };
 
 //------------------------------------------------------------------------------
@@ -84,6 +131,15 @@ public:
   //----------------------------------------------------------------------------
   void OnResult(kinetic::KineticStatus result);
 
+  //----------------------------------------------------------------------------
+  //! As OnResult(result), a successful result additionally counts the
+  //! supplied version, see CallbackSynchronization::versionFrequency()
+  //!
+  //! @param result the result of the operation this callback belongs to.
+  //! @param version the version reported by the operation
+  //----------------------------------------------------------------------------
+  void OnResult(kinetic::KineticStatus result, const std::string& version);
+
   //----------------------------------------------------------------------------
   //! Obtain the result of the operation this callback belongs to. Note that
   //! the returned result will only be valid if finished()==true
@@ -92,6 +148,11 @@ public:
   //----------------------------------------------------------------------------
   kinetic::KineticStatus& getResult();
 
+  //----------------------------------------------------------------------------
+  //! Discard the result of a finished operation, so that the operation this
+  //! callback belongs to can be executed again. A counted version is removed
+  //! from the tally, as it is when the callback is destroyed.
+  //----------------------------------------------------------------------------
   void reset();
 
   //----------------------------------------------------------------------------
@@ -101,6 +162,31 @@ public:
   //----------------------------------------------------------------------------
   bool finished();
 
+  //----------------------------------------------------------------------------
+  //! Obtain the point in time the result has been set. Only valid if
+  //! finished()==true
+  //!
+  //! @return the completion time of the operation this callback belongs to
+  //----------------------------------------------------------------------------
+  std::chrono::system_clock::time_point completionTime();
+
+  //----------------------------------------------------------------------------
+  //! @return the type of the operation this callback belongs to
+  //----------------------------------------------------------------------------
+  virtual OperationType type();
+
+  //----------------------------------------------------------------------------
+  //! @return the number of value bytes transferred by the operation this
+  //!   callback belongs to, only valid if finished()==true
+  //----------------------------------------------------------------------------
+  virtual size_t bytes();
+
+  //----------------------------------------------------------------------------
+  //! @return the number of value bytes the operation this callback belongs to
+  //!   is expected to transfer, valid before the operation completed
+  //----------------------------------------------------------------------------
+  virtual size_t expectedBytes();
+
   //----------------------------------------------------------------------------
   //! Constructor
   //----------------------------------------------------------------------------
@@ -118,6 +204,15 @@ private:
   std::shared_ptr<CallbackSynchronization> sync;
   //! true if the associated kinetic operation has completed, false otherwise
   bool done;
+  //! the point in time the result has been set
+  std::chrono::system_clock::time_point completion_time;
+  //! the version counted for a successful result, if any
+  std::unique_ptr<std::string> counted_version;
+
+  //----------------------------------------------------------------------------
+  //! Implements OnResult, counting the version if one is supplied.
+  //----------------------------------------------------------------------------
+  void setResult(kinetic::KineticStatus result, const std::string* version);
 };
 
 class GetCallback : public KineticCallback, public kinetic::GetCallbackInterface {
@@ -128,12 +223,19 @@ public:
 
   void Failure(kinetic::KineticStatus error);
 
-  explicit GetCallback(std::shared_ptr<CallbackSynchronization> s);
+  OperationType type();
+
+  size_t bytes();
+
+  size_t expectedBytes();
+
+  explicit GetCallback(std::shared_ptr<CallbackSynchronization> s, size_t expected_size = 0);
 
   ~GetCallback();
 
 private:
   std::shared_ptr<kinetic::KineticRecord> record;
+  size_t expected_size;
 };
 
 class GetVersionCallback : public KineticCallback, public kinetic::GetVersionCallbackInterface {
@@ -144,6 +246,8 @@ public:
 
   void Failure(kinetic::KineticStatus error);
 
+  OperationType type();
+
   explicit GetVersionCallback(std::shared_ptr<CallbackSynchronization> s);
 
   ~GetVersionCallback();
@@ -174,9 +278,16 @@ public:
 
   void Failure(kinetic::KineticStatus error);
 
-  explicit PutCallback(std::shared_ptr<CallbackSynchronization> s);
+  OperationType type();
+
+  size_t bytes();
+
+  explicit PutCallback(std::shared_ptr<CallbackSynchronization> s, size_t value_size = 0);
 
   ~PutCallback();
+
+private:
+  size_t value_size;
 };
 
 class BasicCallback : public KineticCallback, public kinetic::SimpleCallbackInterface {
@@ -185,6 +296,8 @@ public:
 
   void Failure(kinetic::KineticStatus error);
 
+  OperationType type();
+
   explicit BasicCallback(std::shared_ptr<CallbackSynchronization> s);
 
   ~BasicCallback();
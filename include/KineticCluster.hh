@@ -28,6 +28,7 @@
 #include "KineticCallbacks.hh"
 #include "SocketListener.hh"
 #include "RedundancyProvider.hh"
+#include "CompletionQueue.hh"
 #include <utility>
 #include <chrono>
 #include <mutex>
@@ -58,11 +59,23 @@ public:
       std::shared_ptr<const std::string>& version,
       std::shared_ptr<const std::string>& value);
 
+  //! See documentation in superclass.
+  kinetic::KineticStatus get(
+      const std::shared_ptr<const std::string>& key,
+      std::shared_ptr<const std::string>& version,
+      std::shared_ptr<const ChunkedValue>& value);
+
   //! See documentation in superclass.
   kinetic::KineticStatus get(
       const std::shared_ptr<const std::string>& key,
       std::shared_ptr<const std::string>& version);
 
+  //! See documentation in superclass.
+  std::vector<kinetic::KineticStatus> multiGet(
+      const std::vector<std::shared_ptr<const std::string>>& keys,
+      std::vector<std::shared_ptr<const std::string>>& versions,
+      std::vector<std::shared_ptr<const ChunkedValue>>& values);
+
   //! See documentation in superclass.
   kinetic::KineticStatus put(
       const std::shared_ptr<const std::string>& key,
@@ -70,12 +83,25 @@ public:
       const std::shared_ptr<const std::string>& value,
       std::shared_ptr<const std::string>& version_out);
 
+  //! See documentation in superclass.
+  kinetic::KineticStatus put(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      const std::shared_ptr<const ChunkedValue>& value,
+      std::shared_ptr<const std::string>& version_out);
+
   //! See documentation in superclass.
   kinetic::KineticStatus put(
       const std::shared_ptr<const std::string>& key,
       const std::shared_ptr<const std::string>& value,
       std::shared_ptr<const std::string>& version_out);
 
+  //! See documentation in superclass.
+  kinetic::KineticStatus put(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const ChunkedValue>& value,
+      std::shared_ptr<const std::string>& version_out);
+
   //! See documentation in superclass.
   kinetic::KineticStatus remove(
       const std::shared_ptr<const std::string>& key,
@@ -94,6 +120,53 @@ public:
       std::unique_ptr<std::vector<std::string>>& keys,
       size_t max_elements = 0);
 
+  //! Future based asynchronous operations, see documentation in superclass.
+  using ClusterInterface::getAsync;
+  using ClusterInterface::putAsync;
+  using ClusterInterface::removeAsync;
+  using ClusterInterface::flushAsync;
+  using ClusterInterface::rangeAsync;
+
+  //! See documentation in superclass.
+  void getAsync(
+      const std::shared_ptr<const std::string>& key,
+      bool skip_value,
+      AsyncCallback callback);
+
+  //! See documentation in superclass.
+  void putAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      const std::shared_ptr<const ChunkedValue>& value,
+      AsyncCallback callback);
+
+  //! See documentation in superclass.
+  void putAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const ChunkedValue>& value,
+      AsyncCallback callback);
+
+  //! See documentation in superclass.
+  void removeAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      AsyncCallback callback);
+
+  //! See documentation in superclass.
+  void removeAsync(
+      const std::shared_ptr<const std::string>& key,
+      AsyncCallback callback);
+
+  //! See documentation in superclass.
+  void flushAsync(AsyncCallback callback);
+
+  //! See documentation in superclass.
+  void rangeAsync(
+      const std::shared_ptr<const std::string>& start_key,
+      const std::shared_ptr<const std::string>& end_key,
+      std::size_t max_elements,
+      AsyncCallback callback);
+
   //--------------------------------------------------------------------------
   //! Constructor.
   //!
@@ -102,11 +175,21 @@ public:
   //! @param operation_timeout the maximum interval an operation is allowed
   //! @param rp_data RedundancyProvider to be used for data keys
   //! @param rp_metadata RedundancyProvider to be used for metadata keys
+  //! @param hedge_percentile percentile of recent chunk read latencies of
+  //!   the drives after which parity chunks are requested as well, 0
+  //!   disables hedged reads
+  //! @param completion_threads number of threads completing asynchronous
+  //!   operations
+  //! @param completion_queue_depth maximum number of completed asynchronous
+  //!   operations queued for the completion threads
   //--------------------------------------------------------------------------
   explicit KineticCluster(
       std::string id, std::size_t block_size, std::chrono::seconds operation_timeout,
       std::vector<std::unique_ptr<KineticAutoConnection>> connections,
-      std::shared_ptr<RedundancyProvider> rp
+      std::shared_ptr<RedundancyProvider> rp,
+      std::size_t hedge_percentile = 0,
+      std::size_t completion_threads = 4,
+      std::size_t completion_queue_depth = 1024
   );
 
   //--------------------------------------------------------------------------
@@ -115,32 +198,160 @@ public:
   virtual ~KineticCluster();
 
 protected:
+  //--------------------------------------------------------------------------
+  //! Stripe operations reference their key and values. Requests own them
+  //! alongside the operation, so that the operation can outlive the call
+  //! that started it.
+  //--------------------------------------------------------------------------
+  struct GetRequest;
+  struct PutRequest;
+  struct RemoveRequest;
+
   //--------------------------------------------------------------------------
   //! Single implementation functions for functionality with
-  //! multiple interface functions.
+  //! multiple interface functions. Synchronous operations execute requests
+  //! in the calling thread, asynchronous operations submit them and execute
+  //! them in a completion thread once the results are available.
   //--------------------------------------------------------------------------
   kinetic::KineticStatus do_remove(
       const std::shared_ptr<const std::string>& key,
       const std::shared_ptr<const std::string>& version,
       kinetic::WriteMode mode);
 
+  void do_removeAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      kinetic::WriteMode mode,
+      AsyncCallback callback);
+
+  kinetic::KineticStatus executeRemove(RemoveRequest& request);
+
+  void completeRemove(std::shared_ptr<RemoveRequest> request, AsyncCallback callback);
+
+  void finishRemove(std::shared_ptr<RemoveRequest> request, AsyncCallback callback);
+
   kinetic::KineticStatus do_get(
       const std::shared_ptr<const std::string>& key,
       std::shared_ptr<const std::string>& version,
-      std::shared_ptr<const std::string>& value, bool skip_value);
+      std::shared_ptr<const ChunkedValue>& value, bool skip_value);
+
+  //--------------------------------------------------------------------------
+  //! Execute the supplied get operation and evaluate its results, resolving
+  //! concurrent writes. Operations may already be in flight when called.
+  //--------------------------------------------------------------------------
+  kinetic::KineticStatus do_get(
+      StripeOperation_GET& getop,
+      const std::shared_ptr<const std::string>& key,
+      std::shared_ptr<const std::string>& version,
+      std::shared_ptr<const ChunkedValue>& value, bool skip_value);
+
+  //--------------------------------------------------------------------------
+  //! Set the results of an executed get operation once concurrent writes
+  //! have been resolved, writing an indicator key if required.
+  //--------------------------------------------------------------------------
+  kinetic::KineticStatus finishGet(
+      StripeOperation_GET& getop,
+      const kinetic::KineticStatus& status,
+      const std::shared_ptr<const std::string>& key,
+      std::shared_ptr<const std::string>& version,
+      std::shared_ptr<const ChunkedValue>& value, bool skip_value);
 
   kinetic::KineticStatus do_put(
       const std::shared_ptr<const std::string>& key,
       const std::shared_ptr<const std::string>& version,
-      const std::shared_ptr<const std::string>& value,
+      const ChunkedValue& value,
       std::shared_ptr<const std::string>& version_out,
       kinetic::WriteMode mode);
 
+  void do_putAsync(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      const ChunkedValue& value,
+      kinetic::WriteMode mode,
+      AsyncCallback callback);
+
+  //--------------------------------------------------------------------------
+  //! Validate the input and build the stripe of a put request.
+  //!
+  //! @param request set to the put request on success
+  //! @return status of request creation
+  //--------------------------------------------------------------------------
+  kinetic::KineticStatus preparePut(
+      const std::shared_ptr<const std::string>& key,
+      const std::shared_ptr<const std::string>& version,
+      const ChunkedValue& value,
+      kinetic::WriteMode mode,
+      std::shared_ptr<PutRequest>& request);
+
+  kinetic::KineticStatus executePut(PutRequest& request, std::shared_ptr<const std::string>& version_out);
+
+  void completePut(std::shared_ptr<PutRequest> request, AsyncCallback callback);
+
+  void finishPut(std::shared_ptr<PutRequest> request, AsyncCallback callback);
+
+  void completeGet(std::shared_ptr<GetRequest> request, std::chrono::microseconds hedge_delay,
+                   AsyncCallback callback);
+
+  //--------------------------------------------------------------------------
+  //! Evaluate a get request once its operations have been completed, see
+  //! StripeOperation_GET::complete(). Should another stage of the read have
+  //! been submitted instead, it is queued to call the supplied function on
+  //! completion, so that no completion thread waits for it.
+  //!
+  //! @param request the get request
+  //! @param status set to the request status if it has been evaluated
+  //! @param next the function to call once the next stage completed
+  //! @return true if status has been set, false if the next stage is queued
+  //--------------------------------------------------------------------------
+  bool stageGet(std::shared_ptr<GetRequest> request, kinetic::KineticStatus& status, std::function<void()> next);
+
+  //--------------------------------------------------------------------------
+  //! Asynchronous counterpart of the concurrent write check in do_get: The
+  //! stripe version is read again by a new request after the check interval
+  //! has passed, instead of sleeping in a completion thread.
+  //--------------------------------------------------------------------------
+  void checkGet(std::shared_ptr<GetRequest> request, kinetic::KineticStatus status,
+                std::chrono::system_clock::time_point start_time, AsyncCallback callback);
+
+  void completeCheckGet(std::shared_ptr<GetRequest> request, std::shared_ptr<GetRequest> check,
+                        kinetic::KineticStatus status, std::chrono::system_clock::time_point start_time,
+                        AsyncCallback callback);
+
+  //--------------------------------------------------------------------------
+  //! Deliver the result of an asynchronous get request. Writing an
+  //! indicator key blocks, so requests requiring one are offloaded.
+  //--------------------------------------------------------------------------
+  void resolveGet(std::shared_ptr<GetRequest> request, kinetic::KineticStatus status, AsyncCallback callback);
+
+  void finishGetAsync(std::shared_ptr<GetRequest> request, kinetic::KineticStatus status, AsyncCallback callback);
+
+  kinetic::KineticStatus executeFlush(ClusterFlushOp& flushop);
+
+  void completeFlush(std::shared_ptr<ClusterFlushOp> flushop, AsyncCallback callback);
+
+  kinetic::KineticStatus executeRange(ClusterRangeOp& rangeop, std::unique_ptr<std::vector<std::string>>& keys);
+
+  void completeRange(std::shared_ptr<ClusterRangeOp> rangeop, AsyncCallback callback);
+
   //--------------------------------------------------------------------------
   //! Update the clusterio statistics, capacity and health information.
   //--------------------------------------------------------------------------
   void updateSnapshot(std::shared_ptr<DestructionMutex> dm);
 
+  //--------------------------------------------------------------------------
+  //! Recompute the hedge delay from the latency statistics of the drives and
+  //! mark drives that are considerably slower than the cluster median as
+  //! slow. Mutex has to be held.
+  //--------------------------------------------------------------------------
+  void updateLatencies();
+
+  //--------------------------------------------------------------------------
+  //! @return the delay after which parity chunks should be requested by get
+  //!   operations, zero if hedged reads are disabled or not enough chunk
+  //!   read latencies have been recorded yet
+  //--------------------------------------------------------------------------
+  std::chrono::microseconds hedgeDelay();
+
   //--------------------------------------------------------------------------
   //! Turn a single value into a stripe, complete with redundancy information
   //! 
@@ -151,6 +362,18 @@ protected:
       const std::string& value
   );
 
+  //--------------------------------------------------------------------------
+  //! Turn a chunked value into a stripe, complete with redundancy information.
+  //! Value chunks are used as data chunks of the stripe without copying if
+  //! the value chunk capacity equals the cluster chunk capacity.
+  //!
+  //! @param value the value
+  //! @return the stripe build from the value
+  //--------------------------------------------------------------------------
+  std::vector<std::shared_ptr<const std::string>> valueToStripe(
+      const ChunkedValue& value
+  );
+
 
 protected:
   //! cluster id
@@ -162,6 +385,9 @@ protected:
   //! maximum capacity of a single value / parity chunk
   const std::size_t chunkCapacity;
 
+  //! a chunk of chunkCapacity 0s, used to pad stripes of small values
+  const std::shared_ptr<const std::string> zeroChunk;
+
   //! timeout of asynchronous operations
   const std::chrono::seconds operation_timeout;
 
@@ -180,11 +406,23 @@ protected:
   //! the cluster statistics
   ClusterStats statistics_snapshot;
 
+  //! percentile of chunk read latencies used as hedge delay, 0 if hedged reads are disabled
+  const std::size_t hedge_percentile;
+
+  //! the current hedge delay
+  std::chrono::microseconds hedge_delay;
+
+  //! time point the hedge delay and slow drives have been last updated
+  std::chrono::system_clock::time_point latencies_updated;
+
   //! prevent background threads accessing member variables after destruction
   std::shared_ptr<DestructionMutex> dmutex;
 
   //! concurrency control
   std::mutex mutex;
+
+  //! completes asynchronous operations, destructed first so that pending operations may still access the cluster
+  CompletionQueue completions;
 };
 
 }
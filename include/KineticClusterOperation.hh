@@ -83,6 +83,67 @@ public:
   //--------------------------------------------------------------------------
   std::map<kinetic::StatusCode, size_t, CompareStatusCode> executeOperationVector(const std::chrono::seconds& timeout);
 
+  //--------------------------------------------------------------------------
+  //! Start execution of all unfinished operations of the operation vector
+  //! without waiting for results. Operations that are already in flight will
+  //! not be submitted again. Allows to have multiple cluster operations in
+  //! flight concurrently.
+  //--------------------------------------------------------------------------
+  void submitOperationVector();
+
+  //--------------------------------------------------------------------------
+  //! Wait for submitted operations to complete, timing out any operation
+  //! still outstanding at the supplied point in time. Operations on drives
+  //! with sufficient latency statistics time out earlier, once they exceed
+  //! the adaptive timeout of their drive. Returns early if the result of
+  //! the cluster operation has been decided. Operations still in
+  //! flight at that point are cancelled and remain unfinished, their replies
+  //! are discarded in the background. They will be submitted again by the
+  //! next call to submitOperationVector().
+  //!
+  //! @param timeout_time the point of time the function is guaranteed to return
+  //! @return a std::map containing the frequency of operation results
+  //--------------------------------------------------------------------------
+  std::map<kinetic::StatusCode, size_t, CompareStatusCode> waitOperationVector(
+      const std::chrono::system_clock::time_point& timeout_time);
+
+  //--------------------------------------------------------------------------
+  //! Non-blocking counterpart of waitOperationVector(): Times out operations
+  //! that exceeded the adaptive timeout of their drive and checks if
+  //! waitOperationVector() would return right away.
+  //!
+  //! @param timeout_time the point of time all operations time out
+  //! @param wakeup set to the point in time the operation has to be polled
+  //!   again at the latest, if it has not completed
+  //! @return true if the result of the cluster operation has been decided,
+  //!   all operations completed or timeout_time has passed
+  //--------------------------------------------------------------------------
+  bool poll(const std::chrono::system_clock::time_point& timeout_time,
+            std::chrono::system_clock::time_point& wakeup);
+
+  //--------------------------------------------------------------------------
+  //! Register a function to be called whenever an operation of the operation
+  //! vector completes, see CallbackSynchronization::setListener().
+  //!
+  //! @param listener the function, an empty function unregisters
+  //--------------------------------------------------------------------------
+  void setListener(std::function<void()> listener);
+
+  //--------------------------------------------------------------------------
+  //! Executes the supplied function at the supplied point in time.
+  //--------------------------------------------------------------------------
+  typedef std::function<void(const std::chrono::system_clock::time_point&, std::function<void()>)> FlushScheduler;
+
+  //--------------------------------------------------------------------------
+  //! Have submitOperationVector() return without waiting for the batch
+  //! window of the connections. The connections are flushed by the
+  //! scheduler once the window passed instead. Required for operations that
+  //! are submitted by threads that may not block, e.g. completion threads.
+  //!
+  //! @param scheduler the scheduler used to flush the connections
+  //--------------------------------------------------------------------------
+  void deferFlush(FlushScheduler scheduler);
+
 protected:
   struct KineticAsyncOperation {
       //! The assigned kinetic function, all arguments except the connection have to be bound.
@@ -91,6 +152,12 @@ protected:
       std::shared_ptr<KineticCallback> callback;
       //! The AutoConnection assigned to this operation, function will be called on the underlying connection.
       KineticAutoConnection* connection;
+      //! The underlying connection while the operation is in flight, empty otherwise.
+      std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> con;
+      //! The handler key of the operation while it is in flight.
+      kinetic::HandlerKey hkey;
+      //! The point in time the operation has been submitted.
+      std::chrono::system_clock::time_point submitted;
   };
 
   //! Operation vector
@@ -102,6 +169,9 @@ protected:
   //! Connection vector
   std::vector<std::unique_ptr<KineticAutoConnection>>& connections;
 
+  //! Flushes connections after the batch window if set, see deferFlush()
+  FlushScheduler flush_scheduler;
+
   //--------------------------------------------------------------------------
   //! Used for initial setup (and possible future expansion) of the operation
   //! vector. Chooses the connections to be used. Can be overwritten for
@@ -114,6 +184,41 @@ protected:
   virtual void expandOperationVector(
       std::size_t size, std::size_t offset
   );
+
+  //--------------------------------------------------------------------------
+  //! Completion predicate, checked whenever an operation completes. Can be
+  //! overwritten by operation types that do not require all results.
+  //!
+  //! @return true if the result of the cluster operation is decided by the
+  //!   operations completed so far, false to wait for all operations
+  //--------------------------------------------------------------------------
+  virtual bool decided();
+
+  //--------------------------------------------------------------------------
+  //! Time out all operations in flight that exceeded the adaptive timeout of
+  //! their drive.
+  //!
+  //! @param timeout_time the point of time all operations time out
+  //! @return the point in time the next operation in flight will time out
+  //--------------------------------------------------------------------------
+  std::chrono::system_clock::time_point timeoutOperations(
+      const std::chrono::system_clock::time_point& timeout_time);
+
+  //--------------------------------------------------------------------------
+  //! Time out a single operation in flight and record its latency.
+  //!
+  //! @param op the operation
+  //--------------------------------------------------------------------------
+  void timeoutOperation(KineticAsyncOperation& op);
+
+  //--------------------------------------------------------------------------
+  //! Check if any status code has been returned by the supplied number of
+  //! completed operations.
+  //!
+  //! @param quorum_size the minimum number of aligned replies
+  //! @return true if quorum has been reached, false otherwise
+  //--------------------------------------------------------------------------
+  bool quorumReached(size_t quorum_size);
 };
 
 
@@ -210,6 +315,15 @@ public:
   //--------------------------------------------------------------------------
   kinetic::KineticStatus execute(const std::chrono::seconds& timeout, size_t quorum_size);
 
+  //--------------------------------------------------------------------------
+  //! Start the operation without waiting for results. The operation is
+  //! decided as soon as a quorum of aligned replies has been received, call
+  //! execute() with the same quorum size to obtain the overall status.
+  //!
+  //! @param quorum_size the minimum number of aligned replies required
+  //--------------------------------------------------------------------------
+  void submit(size_t quorum_size);
+
   //--------------------------------------------------------------------------
   //! Constructor
   //!
@@ -221,6 +335,14 @@ public:
   ClusterFlushOp(
       std::vector<std::unique_ptr<KineticAutoConnection>>& connections
   );
+
+protected:
+  //! see parent class, decided once a quorum of aligned replies is reached
+  bool decided();
+
+private:
+  //! the minimum number of aligned replies required
+  size_t quorum;
 };
 
 
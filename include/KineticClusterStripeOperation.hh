@@ -32,6 +32,7 @@
 #include "KineticAutoConnection.hh"
 #include "RedundancyProvider.hh"
 #include "KineticClusterOperation.hh"
+#include "ChunkedValue.hh"
 
 namespace kio {
 
@@ -121,8 +122,10 @@ public:
   //! Constructor, sets up the operation vector.
   //!
   //! @params... all the params
+  //! @param chunk_size the expected size of a chunk, reads are batched as
+  //!   small or large operations by it before their size is known
   //--------------------------------------------------------------------------
-  explicit StripeOperation_GET(const std::shared_ptr<const std::string>& key, bool skip_value,
+  explicit StripeOperation_GET(const std::shared_ptr<const std::string>& key, bool skip_value, std::size_t chunk_size,
                                std::vector<std::unique_ptr<KineticAutoConnection>>& connections,
                                std::shared_ptr<RedundancyProvider>& redundancy, bool skip_partial_get = false);
 
@@ -136,11 +139,70 @@ public:
   kinetic::KineticStatus execute(const std::chrono::seconds& timeout);
 
   //--------------------------------------------------------------------------
-  //! Return the value if execute succeeded
+  //! Execute with hedged reads: Should any data chunk not have been read
+  //! after the supplied delay, parity chunks are requested as well. The
+  //! stripe is evaluated as soon as nData chunks of the same version have
+  //! been read, remaining requests are cancelled. Falls back to
+  //! execute(timeout) if the stripe can not be evaluated from the chunks read.
   //!
+  //! @param timeout the network timeout
+  //! @param hedge_delay the delay after which parity chunks are requested,
+  //!   hedging is disabled if zero
+  //! @return returns operation status
+  //--------------------------------------------------------------------------
+  kinetic::KineticStatus execute(const std::chrono::seconds& timeout,
+                                 const std::chrono::microseconds& hedge_delay);
+
+  //--------------------------------------------------------------------------
+  //! Start reading the stripe without waiting for results, allowing multiple
+  //! get operations to be in flight concurrently. As with execute(), reads
+  //! from slow drives are avoided and the stripe is decided as soon as nData
+  //! chunks of the same version have been read. Call execute() to evaluate
+  //! the stripe, the hedge delay counts from the call to submit().
+  //--------------------------------------------------------------------------
+  void submit();
+
+  //--------------------------------------------------------------------------
+  //! Request parity chunks if the stripe has not been decided and any data
+  //! chunk is still outstanding.
+  //!
+  //! @return true if parity chunks have been requested, false otherwise
+  //--------------------------------------------------------------------------
+  bool hedge();
+
+  //--------------------------------------------------------------------------
+  //! Non-blocking counterpart of execute(), to be called once the operations
+  //! started by submit() or a previous call have been completed by poll().
+  //! Evaluates the stripe. If the stripe can not be evaluated, the next
+  //! stage of the read is submitted instead, in the same order as execute()
+  //! uses: local parity chunks, parity chunks and skipped data chunks, and
+  //! handoff chunks last. Handoff chunks are looked up by the operation
+  //! returned by handoffLookup(), which has to complete before the next call.
+  //!
+  //! @param timeout_time the point of time the operations in flight time out
+  //! @param status set to the operation status if the stripe is evaluated
+  //! @return true if status has been set, false if another stage has been
+  //!   submitted
+  //--------------------------------------------------------------------------
+  bool complete(const std::chrono::system_clock::time_point& timeout_time, kinetic::KineticStatus& status);
+
+  //--------------------------------------------------------------------------
+  //! Return the handoff key lookup submitted by complete(), if any.
+  //!
+  //! @return the lookup while it is in flight, an empty pointer otherwise
+  //--------------------------------------------------------------------------
+  std::shared_ptr<ClusterRangeOp> handoffLookup() const;
+
+  //--------------------------------------------------------------------------
+  //! Return the value if execute succeeded. The data chunks of the stripe
+  //! are used as value chunks without copying if they are laid out as
+  //! required by the supplied chunk capacity, which is the case for any
+  //! value that has been written with the same chunk capacity.
+  //!
+  //! @param chunk_capacity the chunk capacity of the returned value
   //! @return the value
   //--------------------------------------------------------------------------
-  std::shared_ptr<const std::string> getValue() const;
+  std::shared_ptr<const ChunkedValue> getValue(std::size_t chunk_capacity) const;
 
   //--------------------------------------------------------------------------
   //! Return the version if execute succeeded
@@ -203,14 +265,104 @@ protected:
   //--------------------------------------------------------------------------
   bool insertHandoffChunks();
 
+  //--------------------------------------------------------------------------
+  //! Create the range operation listing the handoff keys of the currently
+  //! most frequent version.
+  //!
+  //! @return the range operation, an empty pointer if there is no version
+  //--------------------------------------------------------------------------
+  std::shared_ptr<ClusterRangeOp> makeHandoffLookup();
+
+  //--------------------------------------------------------------------------
+  //! Modify the operation vector to access the handoff keys found by the
+  //! supplied range operation, see insertHandoffChunks().
+  //!
+  //! @param range the executed range operation
+  //! @return true if any operations were modified, false otherwise
+  //--------------------------------------------------------------------------
+  bool insertHandoffChunks(ClusterRangeOp& range);
+
+  //--------------------------------------------------------------------------
+  //! Add the operations of the stage following the current stage to the
+  //! operation vector, see complete().
+  //!
+  //! @return true if a stage has been added, false if all stages failed
+  //--------------------------------------------------------------------------
+  bool nextStage();
+
+  //--------------------------------------------------------------------------
+  //! Replace data chunk reads from drives currently considered slow with
+  //! parity chunk reads, as long as the stripe can still be reconstructed.
+  //! Skipped reads are remembered so that they can be attempted later on.
+  //! Reads already in flight are not replaced.
+  //--------------------------------------------------------------------------
+  void avoidSlowDrives();
+
   kinetic::KineticStatus do_execute(const std::chrono::seconds& timeout);
 
+  //--------------------------------------------------------------------------
+  //! Read the data chunks, adding parity chunks and handoff chunks in stages
+  //! if the stripe can not be evaluated.
+  //!
+  //! @param timeout the network timeout
+  //! @return returns operation status
+  //--------------------------------------------------------------------------
+  kinetic::KineticStatus execute_staged(const std::chrono::seconds& timeout);
+
+  //--------------------------------------------------------------------------
+  //! Read the data chunks, adding parity chunks if any data chunk has not
+  //! been read after the hedge delay.
+  //!
+  //! @param timeout the network timeout
+  //! @param hedge_delay the delay after which parity chunks are requested
+  //! @return returns operation status
+  //--------------------------------------------------------------------------
+  kinetic::KineticStatus execute_hedged(const std::chrono::seconds& timeout,
+                                        const std::chrono::microseconds& hedge_delay);
+
+  //--------------------------------------------------------------------------
+  //! Evaluate the results of the operation vector. Will throw if no valid
+  //! result can be determined.
+  //!
+  //! @param rmap the frequency of operation results
+  //! @return returns operation status
+  //--------------------------------------------------------------------------
+  kinetic::KineticStatus evaluate(std::map<kinetic::StatusCode, size_t, CompareStatusCode> rmap);
+
+  //--------------------------------------------------------------------------
+  //! See parent class. When executed by execute(), the stripe is decided as
+  //! soon as nData chunks of the same version have been read. Full stripe
+  //! reads and direct use of executeOperationVector() wait for all chunks, as
+  //! required to inspect the versions of all chunks of a stripe.
+  //--------------------------------------------------------------------------
+  bool decided();
+
   //! metadata only get
   bool skip_value;
+  //! the expected size of a chunk
+  std::size_t chunk_size;
+  //! all chunks of the stripe are read
+  bool full_stripe;
+  //! true if the operation may complete as soon as nData chunks have been read
+  bool early_completion;
+  //! indices of operations that have been skipped because of slow drives
+  std::vector<std::size_t> avoided;
+  //! the stages of a read, see complete()
+  enum class Stage {
+    DATA, LOCAL_PARITY, PARITY, HANDOFF_LOOKUP, HANDOFF
+  };
+  //! the stage submitted last by complete()
+  Stage stage;
+  //! the handoff key lookup in flight
+  std::shared_ptr<ClusterRangeOp> handoff_range;
+  //! the point in time the data chunk reads have been submitted
+  std::chrono::system_clock::time_point start_time;
   //! the most frequent version in the operation vector
   VersionCount version;
-  //! the reconstructed value
-  std::shared_ptr<std::string> value;
+  //! the data chunks of the reconstructed stripe
+  std::vector<std::shared_ptr<const std::string>> data_chunks;
+  //! the size of the reconstructed value
+  std::size_t value_size;
 };
 
 
@@ -284,7 +436,16 @@ public:
   //! @param timeout the network timeout
   //--------------------------------------------------------------------------
   kinetic::KineticStatus execute(const std::chrono::seconds& timeout);
-  
+
+  //--------------------------------------------------------------------------
+  //! Check if evaluating the results of the completed operation vector
+  //! requires further drive requests, e.g. to resolve a partial stripe write or
+  //! to place an indicator key.
+  //!
+  //! @return true if execute will block on further drive requests
+  //--------------------------------------------------------------------------
+  bool needsResolution() const;
+
   //--------------------------------------------------------------------------
   //! Only do a targeted repair operation based on the supplied get operation
   //! instead of executing the operation vector set up in the constructor. 
@@ -339,6 +500,15 @@ public:
   //--------------------------------------------------------------------------
   kinetic::KineticStatus execute(const std::chrono::seconds& timeout);
 
+  //--------------------------------------------------------------------------
+  //! Check if evaluating the results of the completed operation vector
+  //! requires further drive requests, e.g. to resolve a partial stripe
+  //! remove or to place an indicator key.
+  //!
+  //! @return true if execute will block on further drive requests
+  //--------------------------------------------------------------------------
+  bool needsResolution() const;
+
   //--------------------------------------------------------------------------
   //! Constructor, sets up the operation vector.
   //!
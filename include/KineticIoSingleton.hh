@@ -26,6 +26,8 @@
 #include "ClusterMap.hh"
 #include "DataCache.hh"
 #include "BackgroundOperationHandler.hh"
+#include "WriteBackHandler.hh"
+#include "BufferPool.hh"
 /*----------------------------------------------------------------------------*/
 
 namespace kio {
@@ -42,6 +44,12 @@ public:
   //! return thread pool 
   BackgroundOperationHandler& threadpool();
 
+  //! return write back handler
+  WriteBackHandler& writeback();
+
+  //! return buffer pool
+  BufferPool& bufferpool();
+
   size_t readaheadWindowSize();
   
   //--------------------------------------------------------------------------
@@ -73,16 +81,37 @@ private:
   struct Configuration{
       //! the maximum size of the data cache in bytes
       size_t stripecache_capacity;
+      //! the replacement policy of the data cache
+      DataCache::Policy cache_policy;
       //! the maximum number of keys prefetched by readahead algorithm
       std::atomic<size_t> readahead_window_size;
       //! the number of threads used for bg io in the data cache, can be 0
       int background_io_threads;
       //! the maximum number of operations queued for bg io, can be 0 
       int background_io_queue_capacity;
+      //! the maximum number of dirty bytes before writers are blocked
+      size_t writeback_limit;
+      //! dirty bytes above which partially written blocks are flushed
+      size_t writeback_high_watermark;
+      //! dirty bytes below which partially written blocks are no longer flushed
+      size_t writeback_low_watermark;
+      //! the number of threads processing drive responses
+      size_t listener_threads;
+      //! true if threads processing drive responses are pinned to one cpu each
+      bool listener_pinning;
+      //! the maximum number of bytes kept for re-use by the buffer pool
+      size_t bufferpool_capacity;
+      //! the number of threads per cluster completing asynchronous operations
+      size_t completion_threads;
+      //! the maximum number of completed asynchronous operations queued per cluster
+      size_t completion_queue_depth;
   };
 
   //! storing the library wide configuration parameters
   Configuration configuration;
+
+  //! buffers for value and parity chunks, declared first as all other components may hold buffers
+  std::shared_ptr<BufferPool> bufferPool;
   
   //! the cluster map 
   ClusterMap clusterMap;
@@ -92,6 +121,9 @@ private:
   
   //! the threadpool for background operations
   BackgroundOperationHandler threadPool;
+
+  //! background flushing of dirty data blocks
+  WriteBackHandler writeBack;
   
   //! concurrency control
   std::mutex mutex;
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+//! @file LatencyStatistics.hh
+//! @author Paul Hermann Lensing
+//! @brief Latency statistics of operations on a single drive.
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#ifndef KINETICIO_LATENCYSTATISTICS_HH
+#define KINETICIO_LATENCYSTATISTICS_HH
+
+/*----------------------------------------------------------------------------*/
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <map>
+/*----------------------------------------------------------------------------*/
+
+namespace kio {
+
+//! Operation types distinguished by latency statistics.
+enum class OperationType {
+  READ, WRITE, OTHER
+};
+
+//! Value sizes distinguished by latency statistics.
+enum class SizeClass {
+  SMALL, LARGE
+};
+
+//! Latency statistics of a single operation type and size class.
+struct LatencyStats {
+  //! the number of recorded operations
+  uint64_t samples;
+  //! exponentially weighted moving average of recent latencies
+  std::chrono::microseconds ewma;
+  //! median of recent latencies
+  std::chrono::microseconds p50;
+  //! 99th percentile of recent latencies
+  std::chrono::microseconds p99;
+};
+
+//------------------------------------------------------------------------------
+//! Records operation latencies of a single drive by operation type and size
+//! class. Percentiles are computed from logarithmically bucketed histograms
+//! that decay over time, so that they reflect recent behavior. Threadsafe.
+//------------------------------------------------------------------------------
+class LatencyStatistics {
+public:
+  //! values of at least this many bytes are of size class LARGE
+  static const size_t large_value_size;
+
+  //! the minimum number of samples for latency based decisions
+  static const uint64_t min_samples;
+
+  //--------------------------------------------------------------------------
+  //! Record the latency of an operation.
+  //!
+  //! @param type the operation type
+  //! @param bytes the value size of the operation
+  //! @param latency the time between submitting the operation and receiving
+  //!   its result
+  //--------------------------------------------------------------------------
+  void record(OperationType type, size_t bytes, std::chrono::microseconds latency);
+
+  //--------------------------------------------------------------------------
+  //! Obtain the statistics of an operation type and size class.
+  //!
+  //! @param type the operation type
+  //! @param size the size class
+  //! @return the latency statistics
+  //--------------------------------------------------------------------------
+  LatencyStats get(OperationType type, SizeClass size);
+
+  //--------------------------------------------------------------------------
+  //! Obtain the statistics of all operation types and size classes that have
+  //! been recorded.
+  //!
+  //! @return the latency statistics
+  //--------------------------------------------------------------------------
+  std::map<std::pair<OperationType, SizeClass>, LatencyStats> get();
+
+  //--------------------------------------------------------------------------
+  //! Compute a percentile of recent latencies.
+  //!
+  //! @param type the operation type
+  //! @param size the size class
+  //! @param percentile the percentile in the range [0,100]
+  //! @return the latency, zero if no latencies have been recorded
+  //--------------------------------------------------------------------------
+  std::chrono::microseconds percentile(OperationType type, SizeClass size, double percentile);
+
+  //--------------------------------------------------------------------------
+  //! Compute an adaptive timeout for an operation type: A multiple of the
+  //! 99th percentile latency of the slowest size class, but no less than a
+  //! second and no more than the supplied maximum.
+  //!
+  //! @param type the operation type
+  //! @param max_timeout the maximum timeout, returned if not enough
+  //!   latencies have been recorded
+  //! @return the timeout
+  //--------------------------------------------------------------------------
+  std::chrono::microseconds timeout(OperationType type, std::chrono::microseconds max_timeout);
+
+  //--------------------------------------------------------------------------
+  //! Constructor.
+  //--------------------------------------------------------------------------
+  explicit LatencyStatistics();
+
+  //--------------------------------------------------------------------------
+  //! No copy constructor.
+  //--------------------------------------------------------------------------
+  LatencyStatistics(LatencyStatistics&) = delete;
+
+  //--------------------------------------------------------------------------
+  //! No copy assignment.
+  //--------------------------------------------------------------------------
+  void operator=(LatencyStatistics&) = delete;
+
+private:
+  struct Histogram {
+    //! the number of recorded operations
+    uint64_t samples;
+    //! exponentially weighted moving average in microseconds
+    double ewma;
+    //! the sum of all bucket counts
+    uint64_t total;
+    //! logarithmically sized latency buckets
+    std::vector<uint32_t> buckets;
+  };
+
+  //--------------------------------------------------------------------------
+  //! Compute a percentile of a histogram. Mutex has to be held.
+  //--------------------------------------------------------------------------
+  static std::chrono::microseconds percentile(const Histogram& h, double percentile);
+
+  //--------------------------------------------------------------------------
+  //! Compute statistics of a histogram. Mutex has to be held.
+  //--------------------------------------------------------------------------
+  static LatencyStats stats(const Histogram& h);
+
+private:
+  //! histograms by operation type and size class
+  std::map<std::pair<OperationType, SizeClass>, Histogram> histograms;
+  //! concurrency control
+  std::mutex mutex;
+};
+
+}
+
+#endif  // KINETICIO_LATENCYSTATISTICS_HH
@@ -27,6 +27,9 @@
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "BufferPool.hh"
 
 namespace kio {
 
@@ -38,6 +41,27 @@ namespace kio {
 //------------------------------------------------------------------------------
 class RedundancyProvider {
 public:
+  //--------------------------------------------------------------------------
+  //! The code used to compute parity blocks if nData > 1, stripes with a
+  //! single data block are always replicated.
+  //--------------------------------------------------------------------------
+  enum class Codec {
+    //! Reed-Solomon code with a Cauchy matrix, recovers any nParity failures
+    CAUCHY_RS,
+    //! Reed-Solomon code with a Vandermonde matrix. Not every square
+    //! submatrix is invertible, so for wider stripes some patterns of up to
+    //! nParity failures cannot be recovered
+    VANDERMONDE_RS,
+    //! single parity block computed as the XOR of all data blocks
+    XOR,
+    //! locally repairable code. Data blocks are split into nLocal groups,
+    //! each protected by a local XOR parity, followed by nParity - nLocal
+    //! global Cauchy parities. A single failed block is repaired from its
+    //! group only. Any nParity - nLocal + 1 failures are recoverable,
+    //! patterns with more failures only if they are spread over groups.
+    LRC
+  };
+
   //--------------------------------------------------------------------------
   //! Compute all missing data and parity blocks in the the stripe. Stripe size
   //! has to equal nData+nParity. Blocks can be arbitrary size, but size has
@@ -48,6 +72,35 @@ public:
   //--------------------------------------------------------------------------
   void compute(std::vector<std::shared_ptr<const std::string> >& stripe);
 
+  //--------------------------------------------------------------------------
+  //! Compute all missing data and parity blocks in the stripe directly into
+  //! buffers supplied by the caller. Nothing is allocated or copied. Function
+  //! will throw on incorrect input.
+  //!
+  //! @param blocks nData+nParity pointers to buffers of block_size bytes,
+  //!   buffers of missing blocks will be overwritten with computed blocks
+  //! @param missing nData+nParity flags, set for blocks that are missing
+  //! @param block_size size of each block in bytes
+  //--------------------------------------------------------------------------
+  void compute(const std::vector<unsigned char*>& blocks, const std::vector<bool>& missing,
+               std::size_t block_size);
+
+  //--------------------------------------------------------------------------
+  //! Update previously computed parity blocks in place after a single data
+  //! block of the stripe changed. Only the old and new content of the
+  //! changed data block is required, the other data blocks are not
+  //! accessed. Function will throw on incorrect input.
+  //!
+  //! @param index stripe index of the changed data block, has to be < nData
+  //! @param old_block the old content of the data block, block_size bytes
+  //! @param new_block the new content of the data block, block_size bytes
+  //! @param parities nParity pointers to the parity blocks of the stripe,
+  //!   block_size bytes each
+  //! @param block_size size of each block in bytes
+  //--------------------------------------------------------------------------
+  void update(std::size_t index, const unsigned char* old_block, const unsigned char* new_block,
+              const std::vector<unsigned char*>& parities, std::size_t block_size);
+
   //--------------------------------------------------------------------------
   //! Get nData
   //!
@@ -62,6 +115,20 @@ public:
   //--------------------------------------------------------------------------
   const std::size_t& numParity() const;
 
+  //--------------------------------------------------------------------------
+  //! Get nLocal. Local parity blocks are stored first, directly following
+  //! the data blocks of a stripe.
+  //!
+  //! @return the number of local parity blocks per stripe, 0 unless the
+  //!         codec is Codec::LRC
+  //--------------------------------------------------------------------------
+  const std::size_t& numLocalParity() const;
+
+  //--------------------------------------------------------------------------
+  //! @return the code used to compute parity blocks
+  //--------------------------------------------------------------------------
+  Codec codec() const;
+
   //--------------------------------------------------------------------------
   //! For convenience only, returns nData+nParity
   //!
@@ -72,12 +139,19 @@ public:
   //--------------------------------------------------------------------------
   //! Constructor.
   //! Stripe parameters (number of data and parity blocks) are constant per
-  //! ErasureEncoding object.
+  //! ErasureEncoding object. The encoding table as well as the decoding
+  //! tables for all single block failures are computed during construction.
+  //! Stripes may contain at most 64 blocks.
   //!
   //! @param nData number of data blocks in stripes to be encoded by this object
   //! @param nParity number of parity blocks in stripes
+  //! @param codec the code used to compute parity blocks
+  //! @param nLocal number of local parity blocks, only used by Codec::LRC
+  //! @param pool buffer pool used for blocks computed by compute(stripe) and
+  //!   temporary buffers, if empty buffers are allocated directly
   //--------------------------------------------------------------------------
-  explicit RedundancyProvider(std::size_t nData, std::size_t nParity);
+  explicit RedundancyProvider(std::size_t nData, std::size_t nParity, Codec codec = Codec::CAUCHY_RS,
+                              std::size_t nLocal = 0, std::shared_ptr<BufferPool> pool = std::shared_ptr<BufferPool>());
 
 private:
   //--------------------------------------------------------------------------
@@ -85,50 +159,148 @@ private:
   //! a known error pattern.
   //--------------------------------------------------------------------------
   struct CodingTable {
+    //! the error pattern this coding table is constructed for
+    uint64_t pattern;
     //! the coding table
     std::vector<unsigned char> table;
-    //! array of nData size, containing stripe indices to input blocks
+    //! stripe indices of the input blocks, nData entries unless the missing
+    //! block can be repaired from its local group
     std::vector<unsigned int> blockIndices;
     //! Number of errors this coding table is constructed for (maximum==nParity)
     int nErrors;
+    //! true if the single missing block is the XOR of the input blocks
+    bool xorOnly;
   };
 
   //--------------------------------------------------------------------------
-  //! Constructs a string of the error pattern / signature. Each missing block
+  //! Constructs a bitmask of the error pattern / signature. Each missing block
   //! in the stripe is counted as an error block, existing blocks are assumed
   //! to be correct (crc integrity checks of blocks should be done previously
   //! to attempting erasure decoding).
   //!
   //! @param stripe vector of nData+nParity blocks, missing (empty) blocks are
   //!        errors
-  //! @return a string of stripe size describing the error pattern
+  //! @return error pattern, bit i is set if block i of the stripe is missing
   //--------------------------------------------------------------------------
-  std::string getErrorPattern(
+  uint64_t getErrorPattern(
       const std::vector<std::shared_ptr<const std::string> >& stripe
   ) const;
 
   //--------------------------------------------------------------------------
-  //! Returns a reference to the coding table for the requested error pattern,
-  //! if possible from the cache. If that particular table has not been
-  //! requested before, it will be constructed.
+  //! Constructs the error pattern / signature from missing block flags.
+  //!
+  //! @param missing nData+nParity flags, set for blocks that are missing
+  //! @return error pattern, bit i is set if block i of the stripe is missing
+  //--------------------------------------------------------------------------
+  uint64_t getErrorPattern(const std::vector<bool>& missing) const;
+
+  //--------------------------------------------------------------------------
+  //! Throws if the supplied buffers do not form a complete stripe.
+  //!
+  //! @param blocks nData+nParity pointers to buffers
+  //--------------------------------------------------------------------------
+  void checkBuffers(const std::vector<unsigned char*>& blocks) const;
+
+  //--------------------------------------------------------------------------
+  //! Compute the missing blocks of an error pattern into the supplied
+  //! buffers.
+  //!
+  //! @param pattern error pattern / signature, may not be 0
+  //! @param blocks nData+nParity pointers to buffers of block_size bytes
+  //! @param block_size size of each block in bytes
+  //--------------------------------------------------------------------------
+  void computeBlocks(uint64_t pattern, unsigned char* const* blocks, std::size_t block_size);
+
+  //--------------------------------------------------------------------------
+  //! Returns a reference to the coding table for the requested error pattern.
+  //! Tables are looked up without locking. If that particular table has not
+  //! been requested before, it will be constructed.
   //!
   //! @param pattern error pattern / signature
   //! @return reference to the coding table for the supplied error pattern
   //--------------------------------------------------------------------------
-  CodingTable& getCodingTable(
-      const std::string& pattern
-  );
+  const CodingTable& getCodingTable(uint64_t pattern);
+
+  //--------------------------------------------------------------------------
+  //! Construct the coding table for the requested error pattern. Throws if
+  //! the pattern cannot be recovered.
+  //!
+  //! @param pattern error pattern / signature
+  //! @return the coding table
+  //--------------------------------------------------------------------------
+  std::unique_ptr<CodingTable> makeCodingTable(uint64_t pattern) const;
+
+  //--------------------------------------------------------------------------
+  //! Construct the coding table repairing a single missing block from the
+  //! other blocks of its local group, if it is part of one.
+  //!
+  //! @param missing stripe index of the missing block
+  //! @return the coding table, or an empty pointer if the block is not part
+  //!         of a local group
+  //--------------------------------------------------------------------------
+  std::unique_ptr<CodingTable> makeLocalCodingTable(std::size_t missing) const;
+
+  //--------------------------------------------------------------------------
+  //! @return the local group of a data block or local parity block, nLocal
+  //!         for blocks that are not part of a local group
+  //--------------------------------------------------------------------------
+  std::size_t localGroup(std::size_t index) const;
+
+  //--------------------------------------------------------------------------
+  //! Construct the coding table for the requested error pattern and make it
+  //! available to lock-free lookups if there is still room in the table
+  //! index. Mutex has to be held.
+  //!
+  //! @param pattern error pattern / signature
+  //! @return reference to the coding table for the supplied error pattern
+  //--------------------------------------------------------------------------
+  const CodingTable& addCodingTable(uint64_t pattern);
+
+  //--------------------------------------------------------------------------
+  //! Look up a coding table in the lock-free table index.
+  //!
+  //! @param pattern error pattern / signature
+  //! @return the coding table if it exists in the index, NULL otherwise
+  //--------------------------------------------------------------------------
+  const CodingTable* findCodingTable(uint64_t pattern) const;
+
+  //--------------------------------------------------------------------------
+  //! Return the preferred index slot of an error pattern.
+  //--------------------------------------------------------------------------
+  size_t slot(uint64_t pattern) const;
+
+  //--------------------------------------------------------------------------
+  //! Obtain a buffer from the buffer pool, or allocate it if there is none.
+  //!
+  //! @param size the buffer size in bytes
+  //! @return the buffer, its content is unspecified
+  //--------------------------------------------------------------------------
+  std::shared_ptr<std::string> allocate(std::size_t size);
 
 private:
   //! number of data blocks in the stripe
   const std::size_t nData;
   //! number of parity blocks in the stripe
   const std::size_t nParity;
+  //! number of local parity blocks in the stripe
+  const std::size_t nLocal;
+  //! the code used to compute parity blocks
+  const Codec code;
+  //! the buffer pool blocks are allocated from, may be empty
+  std::shared_ptr<BufferPool> bufferpool;
   //! the encoding matrix, required to compute any decode matrix
   std::vector<unsigned char> encode_matrix;
-  //! a cache of previously used coding tables
-  std::unordered_map<std::string, CodingTable> cache;
-  //! concurrency control
+  //! error pattern with all parity blocks missing
+  uint64_t encode_pattern;
+  //! open addressing index of coding tables, slots are only ever set once
+  std::unique_ptr<std::atomic<const CodingTable*>[]> index;
+  //! number of index slots, a power of 2
+  std::size_t index_size;
+  //! number of used index slots
+  std::size_t index_used;
+  //! all coding tables, including those that did not fit into the index
+  std::unordered_map<uint64_t, std::unique_ptr<CodingTable>> tables;
+  //! concurrency control for adding coding tables
   std::mutex mutex;
 };
 
@@ -24,28 +24,34 @@
 
 /*----------------------------------------------------------------------------*/
 #include <thread>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 /*----------------------------------------------------------------------------*/
 
 namespace kio{
 
 //! Forward declaraction as AutoConnection includes this class.
-class KineticAutoConnection;
+class PooledConnection;
 
 
 //------------------------------------------------------------------------------
-//! The SocketListener class spawns a background thread which uses epoll to
-//! manage the file descriptors of registered kinetic auto connections.
+//! The SocketListener class spawns background threads which use epoll to
+//! manage the file descriptors of registered pooled connections. Each thread
+//! has its own epoll fd, file descriptors are spread evenly across threads so
+//! that response processing scales with the number of cores.
 //------------------------------------------------------------------------------
 class SocketListener {
 public:
   //----------------------------------------------------------------------------
-  //! Subscribe the supplied KineticAutoConnection to the epoll listening
+  //! Subscribe the supplied pooled connection to an epoll listening
   //! thread. Throws if unsuccessful.
   //!
   //! @parameter fd the file descriptor to add to epoll
   //! @parameter connection the connection associated with the file descriptor
   //----------------------------------------------------------------------------
-  void subscribe(int fd, KineticAutoConnection* connection);
+  void subscribe(int fd, PooledConnection* connection);
   
   //----------------------------------------------------------------------------
   //! Remove the fd from the epoll listening thread. Never throws, if the fd
@@ -56,10 +62,36 @@ public:
   //----------------------------------------------------------------------------
   void unsubscribe(int fd);
 
+  //----------------------------------------------------------------------------
+  //! Request the listening thread of the fd to send queued commands. Re-arms
+  //! write readiness of the fd, the listening thread will run the connection
+  //! as soon as the socket accepts data.
+  //!
+  //! @parameter fd the subscribed file descriptor
+  //! @parameter connection the connection associated with the file descriptor
+  //! @return true if the fd is subscribed and has been re-armed, false
+  //!   otherwise
+  //----------------------------------------------------------------------------
+  bool notify(int fd, PooledConnection* connection);
+
+  //----------------------------------------------------------------------------
+  //! Change configuration during runtime. File descriptors stay with the
+  //! thread they have been subscribed to, threads are only shut down on
+  //! destruction. Reducing the number of threads therefore only affects
+  //! subsequent subscriptions.
+  //!
+  //! @param threads the number of listener threads
+  //! @param pinning if true, listener threads are pinned to one cpu each
+  //----------------------------------------------------------------------------
+  void changeConfiguration(size_t threads, bool pinning);
+
   //----------------------------------------------------------------------------
   //! Constructor.
+  //!
+  //! @param threads the number of listener threads
+  //! @param pinning if true, listener threads are pinned to one cpu each
   //----------------------------------------------------------------------------
-  explicit SocketListener();
+  explicit SocketListener(size_t threads = 1, bool pinning = false);
 
   //----------------------------------------------------------------------------
   //! Destructor.
@@ -67,14 +99,39 @@ public:
   ~SocketListener();
 
 private:
-  //! thread object for listener thread
-  std::thread listener;
+  //----------------------------------------------------------------------------
+  //! Create an epoll / kqueue fd and spawn a listener thread for it. Throws
+  //! if unsuccessful. Mutex has to be held.
+  //----------------------------------------------------------------------------
+  void addListener();
+
+  //----------------------------------------------------------------------------
+  //! Set the cpu affinity of all listener threads according to the pinning
+  //! configuration. Mutex has to be held.
+  //----------------------------------------------------------------------------
+  void setAffinity();
+
+private:
+  //! thread objects for listener threads
+  std::vector<std::thread> listeners;
+
+  //! the epoll or kqueue fd of each listener thread
+  std::vector<int> listener_fds;
+
+  //! the number of listener threads new file descriptors are spread across
+  size_t active;
+
+  //! true if listener threads are pinned to one cpu each
+  bool pinned;
+
+  //! the epoll or kqueue fd each subscribed fd has been added to
+  std::unordered_map<int, int> subscriptions;
 
-  //! indicate to the listener thread to shut down
-  bool shutdown;
+  //! indicate to the listener threads to shut down
+  std::atomic<bool> shutdown;
 
-  //! the epoll or kqueue fd
-  int listener_fd;
+  //! concurrency control
+  std::mutex mutex;
 
   //! uncopyable
   SocketListener (const SocketListener&) = delete;
@@ -25,6 +25,8 @@
 /*----------------------------------------------------------------------------*/
 #include <string>
 #include <sstream>
+#include <vector>
+#include <sys/select.h>
 #include <kinetic/kinetic.h>
 
 namespace kio { namespace utility {
@@ -159,6 +161,29 @@ namespace kio { namespace utility {
   //--------------------------------------------------------------------------
   std::ostream& operator<<(std::ostream& os, const std::chrono::seconds& s);
 
+  //--------------------------------------------------------------------------
+  //! Storage for the fd_set arguments of
+  //! ThreadsafeNonblockingKineticConnection::Run(), which marks the fd of
+  //! the connection in the supplied sets. Sized to the fd limit of the
+  //! process, as fds exceed FD_SETSIZE on hosts with many drives.
+  //--------------------------------------------------------------------------
+  class FdSet{
+  public:
+      //--------------------------------------------------------------------------
+      //! @return pointer to the storage, valid for the lifetime of the object
+      //--------------------------------------------------------------------------
+      fd_set* get();
+
+      //--------------------------------------------------------------------------
+      //! Constructor.
+      //--------------------------------------------------------------------------
+      explicit FdSet();
+
+  private:
+      //! the storage, long aligned like an fd_set
+      std::vector<long> bits;
+  };
+
   //--------------------------------------------------------------------------
   //! Anything-to-string conversion, the only reason to put this in its own
   //! class is to keep the stringstream parsing methods out of the public
@@ -0,0 +1,227 @@
+//------------------------------------------------------------------------------
+//! @file WriteBackHandler.hh
+//! @author Paul Hermann Lensing
+//! @brief Background flushing of dirty data blocks.
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#ifndef KINETICIO_WRITEBACKHANDLER_HH
+#define KINETICIO_WRITEBACKHANDLER_HH
+
+/*----------------------------------------------------------------------------*/
+#include "DataBlock.hh"
+#include <condition_variable>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <list>
+#include <functional>
+/*----------------------------------------------------------------------------*/
+
+namespace kio {
+
+//! forward declare FileIo since FileIo includes the write back handler.
+class FileIo;
+
+//------------------------------------------------------------------------------
+//! Flushes dirty data blocks in the background. Blocks written up to their
+//! capacity are flushed first, partially written blocks once they have been
+//! dirty for some time or when dirty bytes exceed the high watermark, in
+//! which case the oldest blocks are flushed until dirty bytes drop below the
+//! low watermark. Writers are only blocked when registering a new dirty
+//! block would exceed the dirty limit. Threadsafe.
+//------------------------------------------------------------------------------
+class WriteBackHandler {
+public:
+  //! partially written blocks are flushed after having been dirty this long
+  static const std::chrono::seconds expiration_time;
+
+  //--------------------------------------------------------------------------
+  //! Register a block that has been written to. Registering an already
+  //! registered block only updates its completeness. If registering a new
+  //! block would exceed the dirty limit, the calling thread will be blocked
+  //! until enough blocks have been flushed.
+  //!
+  //! @param owner the kio::FileIo object that wrote to the block
+  //! @param block the dirty block
+  //! @param complete true if the block has been written up to its capacity
+  //--------------------------------------------------------------------------
+  void add(kio::FileIo* owner, const std::shared_ptr<kio::DataBlock>& block, bool complete);
+
+  //--------------------------------------------------------------------------
+  //! Discard all registered blocks of the owner without flushing them and
+  //! wait for flushes of the owner's blocks that are already in progress to
+  //! complete. Discarded blocks stay dirty in the data cache.
+  //!
+  //! @param owner a pointer to the kio::FileIo object the blocks belong to
+  //--------------------------------------------------------------------------
+  void drop(kio::FileIo* owner);
+
+  //--------------------------------------------------------------------------
+  //! Non-blocking counterpart of drop(): Discard all registered blocks of
+  //! the owner without flushing them. The supplied function is called once
+  //! flushes of the owner's blocks that are already in progress completed,
+  //! by the thread completing the last of them. If none are in progress, it
+  //! is called by the calling thread.
+  //!
+  //! @param owner a pointer to the kio::FileIo object the blocks belong to
+  //! @param callback called once no flush of the owner's blocks is in progress
+  //--------------------------------------------------------------------------
+  void dropAsync(kio::FileIo* owner, std::function<void()> callback);
+
+  //--------------------------------------------------------------------------
+  //! @return the number of bytes of registered dirty blocks, including
+  //!         blocks that are currently being flushed
+  //--------------------------------------------------------------------------
+  size_t dirtyBytes();
+
+  //--------------------------------------------------------------------------
+  //! Change configuration during runtime.
+  //!
+  //! @param dirty_limit maximum number of dirty bytes before writers block
+  //! @param high_watermark dirty bytes triggering flushes of partial blocks
+  //! @param low_watermark dirty bytes at which flushing partial blocks stops
+  //! @param worker_threads number of flushing threads, if set to zero blocks
+  //!   are flushed by the writing threads
+  //--------------------------------------------------------------------------
+  void changeConfiguration(size_t dirty_limit, size_t high_watermark, size_t low_watermark,
+                           size_t worker_threads);
+
+  //--------------------------------------------------------------------------
+  //! Constructor.
+  //!
+  //! @param dirty_limit maximum number of dirty bytes before writers block
+  //! @param high_watermark dirty bytes triggering flushes of partial blocks
+  //! @param low_watermark dirty bytes at which flushing partial blocks stops
+  //! @param worker_threads number of flushing threads, if set to zero blocks
+  //!   are flushed by the writing threads
+  //--------------------------------------------------------------------------
+  explicit WriteBackHandler(size_t dirty_limit, size_t high_watermark, size_t low_watermark,
+                            size_t worker_threads);
+
+  //--------------------------------------------------------------------------
+  //! Destructor. Waits for flushes in progress, blocks that have not yet
+  //! been flushed are left to the data cache.
+  //--------------------------------------------------------------------------
+  ~WriteBackHandler();
+
+  //--------------------------------------------------------------------------
+  //! No copy constructor.
+  //--------------------------------------------------------------------------
+  WriteBackHandler(WriteBackHandler&) = delete;
+
+  //--------------------------------------------------------------------------
+  //! No copy assignment.
+  //--------------------------------------------------------------------------
+  void operator=(WriteBackHandler&) = delete;
+
+private:
+  struct Entry {
+    //! the dirty block
+    std::shared_ptr<kio::DataBlock> block;
+    //! the kio::FileIo object that registered the block
+    kio::FileIo* owner;
+    //! time the block was registered
+    std::chrono::system_clock::time_point dirty_since;
+    //! true if the block has been written up to its capacity
+    bool complete;
+  };
+
+  typedef std::list<Entry>::iterator entry_iterator;
+
+  //--------------------------------------------------------------------------
+  //! Flush registered blocks until shutdown.
+  //--------------------------------------------------------------------------
+  void worker_thread();
+
+  //--------------------------------------------------------------------------
+  //! Stop all worker threads and start the requested number of new ones.
+  //! Mutex may not be held.
+  //!
+  //! @param worker_threads the number of worker threads
+  //--------------------------------------------------------------------------
+  void restart_workers(size_t worker_threads);
+
+  //--------------------------------------------------------------------------
+  //! Take the next block that should be flushed out of the queues and mark
+  //! it as being flushed. Mutex has to be held.
+  //!
+  //! @param entry set to the entry of the block on success
+  //! @param force if true, return the oldest block even if no flush is due
+  //! @return true if a block has been taken, false otherwise
+  //--------------------------------------------------------------------------
+  bool take(Entry& entry, bool force);
+
+  //--------------------------------------------------------------------------
+  //! Flush a block previously obtained by take, releasing the mutex while
+  //! flushing.
+  //!
+  //! @param lock the lock holding the mutex
+  //! @param entry the entry of the block
+  //--------------------------------------------------------------------------
+  void flush(std::unique_lock<std::mutex>& lock, const Entry& entry);
+
+  //--------------------------------------------------------------------------
+  //! Discard all registered blocks of the owner. Mutex has to be held.
+  //!
+  //! @param owner the kio::FileIo object the blocks belong to
+  //--------------------------------------------------------------------------
+  void discard(kio::FileIo* owner);
+
+private:
+  //! maximum number of dirty bytes
+  size_t limit;
+  //! dirty bytes above which partial blocks are flushed
+  size_t high;
+  //! dirty bytes below which partial blocks are no longer flushed
+  size_t low;
+  //! bytes of registered blocks, including blocks being flushed
+  size_t dirty_bytes;
+  //! bytes of blocks being flushed
+  size_t flushing_bytes;
+  //! true while partial blocks are flushed due to the high watermark or blocked writers
+  bool draining;
+  //! number of writers blocked because registering their block would exceed the dirty limit
+  size_t waiting;
+  //! blocks written up to their capacity, oldest first
+  std::list<Entry> complete;
+  //! partially written blocks, oldest first
+  std::list<Entry> partial;
+  //! lookup table for registered blocks
+  std::unordered_map<const kio::DataBlock*, entry_iterator> lookup;
+  //! number of blocks currently being flushed for each owner
+  std::unordered_map<const kio::FileIo*, size_t> flushing;
+  //! functions called once no block of the owner is being flushed, see dropAsync()
+  std::unordered_map<const kio::FileIo*, std::vector<std::function<void()>>> drained;
+  //! the worker threads
+  std::vector<std::thread> workers;
+  //! signal worker threads to shutdown
+  bool shutdown;
+  //! concurrency control
+  std::mutex mutex;
+  //! workers block until a flush is due
+  std::condition_variable work;
+  //! triggered whenever a flush completes
+  std::condition_variable progress;
+};
+
+}
+
+#endif  // KINETICIO_WRITEBACKHANDLER_HH
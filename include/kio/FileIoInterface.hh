@@ -24,6 +24,10 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <future>
+#include <system_error>
 #ifdef __APPLE__
 #include <sys/mount.h>
 #else
@@ -37,6 +41,47 @@
 
 namespace kio {
 
+//------------------------------------------------------------------------------
+//! A single element of a vectored read request.
+//------------------------------------------------------------------------------
+struct IoChunk {
+  //! offset in file
+  long long offset;
+  //! buffer to read into
+  char* buffer;
+  //! number of bytes to read
+  int length;
+};
+
+//------------------------------------------------------------------------------
+//! A single element of a vectored write request.
+//------------------------------------------------------------------------------
+struct IoWriteChunk {
+  //! offset in file
+  long long offset;
+  //! buffer to write from
+  const char* buffer;
+  //! number of bytes to write
+  int length;
+};
+
+//------------------------------------------------------------------------------
+//! The result of an asynchronous request.
+//------------------------------------------------------------------------------
+struct IoResult {
+  //! number of bytes read / written
+  int64_t bytes;
+  //! set if the request failed, bytes is 0 in this case
+  std::error_code error;
+
+  IoResult() : bytes(0), error()
+  { }
+};
+
+//------------------------------------------------------------------------------
+//! Called with the result once an asynchronous request completed.
+//------------------------------------------------------------------------------
+typedef std::function<void(const IoResult&)> IoCallback;
 
 class FileIoInterface {
 public:
@@ -153,6 +198,169 @@ public:
   //---------------------------------------------------------------------------
   virtual ~FileIoInterface()
   { };
+
+  //---------------------------------------------------------------------------
+  //! Functions added after the destructor. They are declared last so that the
+  //! vtable layout of the functions above stays compatible with plugins built
+  //! against earlier versions of this interface.
+  //---------------------------------------------------------------------------
+
+  //---------------------------------------------------------------------------
+  //! Vectored read from file. Chunks may be supplied in any order, reads past
+  //! the end of the file are handled the same way as for Read. The default
+  //! implementation reads the chunks one by one.
+  //!
+  //! @param chunks list of offset, buffer and length triplets
+  //! @param timeout timeout value
+  //! @return total number of bytes read over all chunks
+  //---------------------------------------------------------------------------
+  virtual int64_t ReadV(const std::vector<IoChunk>& chunks, uint16_t timeout = 0)
+  {
+    int64_t total = 0;
+    for (auto it = chunks.cbegin(); it != chunks.cend(); it++) {
+      total += Read(it->offset, it->buffer, it->length, timeout);
+    }
+    return total;
+  }
+
+  //---------------------------------------------------------------------------
+  //! Vectored write to file. Chunks are written in the supplied order. The
+  //! default implementation writes the chunks one by one.
+  //!
+  //! @param chunks list of offset, buffer and length triplets
+  //! @param timeout timeout value
+  //! @return total number of bytes written over all chunks
+  //---------------------------------------------------------------------------
+  virtual int64_t WriteV(const std::vector<IoWriteChunk>& chunks, uint16_t timeout = 0)
+  {
+    int64_t total = 0;
+    for (auto it = chunks.cbegin(); it != chunks.cend(); it++) {
+      total += Write(it->offset, it->buffer, it->length, timeout);
+    }
+    return total;
+  }
+
+  //---------------------------------------------------------------------------
+  //! Asynchronous requests: Read, Write and Sync have counterparts that return
+  //! right away and call the supplied callback with the result once the
+  //! request completed. Buffers have to stay valid until then. The callback
+  //! may be called by the calling thread or by a library thread, it should
+  //! not block on other asynchronous requests. Any number of requests may be
+  //! outstanding, the object waits for them before it is closed or destructed.
+  //! The default implementations execute the synchronous operation and call
+  //! the callback from the calling thread. Overloads without callback return
+  //! a future instead, which throws std::system_error on failure.
+  //---------------------------------------------------------------------------
+
+  //---------------------------------------------------------------------------
+  //! Read from file asynchronously
+  //!
+  //! @param offset offset in file
+  //! @param buffer where the data is read
+  //! @param length read length
+  //! @param callback called with the number of bytes read
+  //! @param timeout timeout value
+  //---------------------------------------------------------------------------
+  virtual void ReadAsync(long long offset, char* buffer, int length, IoCallback callback, uint16_t timeout = 0)
+  {
+    IoResult result;
+    try {
+      result.bytes = Read(offset, buffer, length, timeout);
+    }
+    catch (const std::system_error& e) {
+      result.error = e.code();
+    }
+    callback(result);
+  }
+
+  std::future<int64_t> ReadAsync(long long offset, char* buffer, int length, uint16_t timeout = 0)
+  {
+    auto promise = std::make_shared<std::promise<int64_t>>();
+    auto future = promise->get_future();
+    ReadAsync(offset, buffer, length, std::bind(&FileIoInterface::fulfill, promise, std::placeholders::_1), timeout);
+    return future;
+  }
+
+  //---------------------------------------------------------------------------
+  //! Write to file asynchronously
+  //!
+  //! @param offset offset
+  //! @param buffer data to be written
+  //! @param length length
+  //! @param callback called with the number of bytes written
+  //! @param timeout timeout value
+  //---------------------------------------------------------------------------
+  virtual void WriteAsync(long long offset, const char* buffer, int length, IoCallback callback,
+                          uint16_t timeout = 0)
+  {
+    IoResult result;
+    try {
+      result.bytes = Write(offset, buffer, length, timeout);
+    }
+    catch (const std::system_error& e) {
+      result.error = e.code();
+    }
+    callback(result);
+  }
+
+  std::future<int64_t> WriteAsync(long long offset, const char* buffer, int length, uint16_t timeout = 0)
+  {
+    auto promise = std::make_shared<std::promise<int64_t>>();
+    auto future = promise->get_future();
+    WriteAsync(offset, buffer, length, std::bind(&FileIoInterface::fulfill, promise, std::placeholders::_1), timeout);
+    return future;
+  }
+
+  //---------------------------------------------------------------------------
+  //! Sync file to disk asynchronously. Covers all writes that completed
+  //! before the call.
+  //!
+  //! @param callback called once the file has been synced
+  //! @param timeout timeout value
+  //---------------------------------------------------------------------------
+  virtual void SyncAsync(IoCallback callback, uint16_t timeout = 0)
+  {
+    IoResult result;
+    try {
+      Sync(timeout);
+    }
+    catch (const std::system_error& e) {
+      result.error = e.code();
+    }
+    callback(result);
+  }
+
+  std::future<void> SyncAsync(uint16_t timeout = 0)
+  {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    SyncAsync(std::bind(&FileIoInterface::fulfillVoid, promise, std::placeholders::_1), timeout);
+    return future;
+  }
+
+private:
+  //---------------------------------------------------------------------------
+  //! Callbacks of asynchronous requests returning a future.
+  //---------------------------------------------------------------------------
+  static void fulfill(std::shared_ptr<std::promise<int64_t>> promise, const IoResult& result)
+  {
+    if (result.error) {
+      promise->set_exception(std::make_exception_ptr(std::system_error(result.error)));
+    }
+    else {
+      promise->set_value(result.bytes);
+    }
+  }
+
+  static void fulfillVoid(std::shared_ptr<std::promise<void>> promise, const IoResult& result)
+  {
+    if (result.error) {
+      promise->set_exception(std::make_exception_ptr(std::system_error(result.error)));
+    }
+    else {
+      promise->set_value();
+    }
+  }
 };
 
 }
@@ -0,0 +1,120 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "BufferPool.hh"
+
+using std::string;
+using namespace kio;
+
+BufferPool::BufferPool(std::size_t max_cached, const std::set<std::size_t>& sizes) :
+    capacity(max_cached), pooled_sizes(sizes), cached_bytes(0), in_use(0), free_buffers(), mutex()
+{
+}
+
+BufferPool::~BufferPool()
+{
+  for (auto it = free_buffers.cbegin(); it != free_buffers.cend(); it++) {
+    for (auto b = it->second.cbegin(); b != it->second.cend(); b++) {
+      delete *b;
+    }
+  }
+}
+
+std::shared_ptr<std::string> BufferPool::get(std::size_t size)
+{
+  string* buffer = NULL;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    in_use++;
+
+    auto it = free_buffers.find(size);
+    if (it != free_buffers.end() && !it->second.empty()) {
+      buffer = it->second.back();
+      it->second.pop_back();
+      cached_bytes -= size;
+    }
+  }
+
+  if (!buffer) {
+    try {
+      buffer = new string(size, '\0');
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      in_use--;
+      throw;
+    }
+  }
+  return std::shared_ptr<string>(buffer, Recycler{shared_from_this()});
+}
+
+void BufferPool::Recycler::operator()(std::string* buffer) const
+{
+  pool->recycle(buffer);
+}
+
+void BufferPool::recycle(std::string* buffer)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    in_use--;
+
+    /* Buffers may have been resized by their user, they are pooled by their current size. */
+    if (pooled_sizes.count(buffer->size()) && cached_bytes + buffer->size() <= capacity) {
+      cached_bytes += buffer->size();
+      free_buffers[buffer->size()].push_back(buffer);
+      return;
+    }
+  }
+  delete buffer;
+}
+
+std::size_t BufferPool::inUse() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return in_use;
+}
+
+std::size_t BufferPool::cached() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return cached_bytes;
+}
+
+void BufferPool::changeConfiguration(std::size_t new_capacity, const std::set<std::size_t>& sizes)
+{
+  std::vector<string*> release;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = new_capacity;
+    pooled_sizes = sizes;
+    for (auto it = free_buffers.begin(); it != free_buffers.end(); it++) {
+      if (!pooled_sizes.count(it->first)) {
+        cached_bytes -= it->first * it->second.size();
+        release.insert(release.end(), it->second.begin(), it->second.end());
+        it->second.clear();
+      }
+    }
+    for (auto it = free_buffers.begin(); it != free_buffers.end() && cached_bytes > capacity; it++) {
+      while (!it->second.empty() && cached_bytes > capacity) {
+        release.push_back(it->second.back());
+        it->second.pop_back();
+        cached_bytes -= it->first;
+      }
+    }
+  }
+  for (auto it = release.cbegin(); it != release.cend(); it++) {
+    delete *it;
+  }
+}
@@ -0,0 +1,231 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "ChunkedValue.hh"
+#include "Utility.hh"
+#include "KineticIoSingleton.hh"
+#include <stdexcept>
+#include <cstring>
+
+using std::string;
+using std::shared_ptr;
+using std::make_shared;
+using namespace kio;
+
+ChunkedValue::ChunkedValue(std::size_t chunk_capacity) :
+    capacity(chunk_capacity), value_size(0), data(), owned(), generation(1), last_encoding()
+{
+  if (!capacity) {
+    throw std::invalid_argument("ChunkedValue: chunk capacity has to be > 0");
+  }
+}
+
+ChunkedValue::ChunkedValue(std::size_t chunk_capacity, const std::string& value) :
+    capacity(chunk_capacity), value_size(0), data(), owned(), generation(1), last_encoding()
+{
+  if (!capacity) {
+    throw std::invalid_argument("ChunkedValue: chunk capacity has to be > 0");
+  }
+  write(value.data(), 0, value.size());
+}
+
+ChunkedValue::ChunkedValue(std::size_t chunk_capacity,
+                           std::vector<std::shared_ptr<const std::string>> chunks,
+                           std::size_t size) :
+    capacity(chunk_capacity), value_size(size), data(std::move(chunks)), owned(data.size(), 0), generation(1),
+    last_encoding()
+{
+  if (!capacity) {
+    throw std::invalid_argument("ChunkedValue: chunk capacity has to be > 0");
+  }
+  for (auto it = data.cbegin(); it != data.cend(); it++) {
+    if (*it && (*it)->size() > capacity) {
+      throw std::invalid_argument(utility::Convert::toString(
+          "ChunkedValue: Chunk of ", (*it)->size(), " bytes exceeds chunk capacity of ", capacity, " bytes."
+      ));
+    }
+  }
+}
+
+ChunkedValue::ChunkedValue(const ChunkedValue& other) :
+    capacity(other.capacity), value_size(other.value_size), data(other.chunks()), owned(data.size(), 0),
+    generation(1), last_encoding(other.encoding())
+{
+}
+
+ChunkedValue& ChunkedValue::operator=(const ChunkedValue& other)
+{
+  if (this != &other) {
+    capacity = other.capacity;
+    value_size = other.value_size;
+    data = other.chunks();
+    owned.assign(data.size(), 0);
+    setEncoding(other.encoding());
+  }
+  return *this;
+}
+
+std::size_t ChunkedValue::size() const
+{
+  return value_size;
+}
+
+std::size_t ChunkedValue::chunkCapacity() const
+{
+  return capacity;
+}
+
+const std::vector<std::shared_ptr<const std::string>>& ChunkedValue::chunks() const
+{
+  generation++;
+  return data;
+}
+
+std::shared_ptr<const ChunkedValue::Encoding> ChunkedValue::encoding() const
+{
+  return std::atomic_load(&last_encoding);
+}
+
+void ChunkedValue::setEncoding(std::shared_ptr<const Encoding> encoding) const
+{
+  std::atomic_store(&last_encoding, std::move(encoding));
+}
+
+void ChunkedValue::read(char* buffer, std::size_t offset, std::size_t length) const
+{
+  size_t done = 0;
+  while (done < length) {
+    size_t index = (offset + done) / capacity;
+    size_t chunk_offset = (offset + done) - index * capacity;
+    size_t chunk_length = std::min(length - done, capacity - chunk_offset);
+
+    /* Only copy what exists in the chunk and is inside the value size, everything else reads as 0s. */
+    size_t available = 0;
+    if (offset + done < value_size && index < data.size() && data[index] && data[index]->size() > chunk_offset) {
+      available = std::min(chunk_length, data[index]->size() - chunk_offset);
+      available = std::min(available, value_size - (offset + done));
+      memcpy(buffer + done, data[index]->data() + chunk_offset, available);
+    }
+    if (available < chunk_length) {
+      memset(buffer + done + available, 0, chunk_length - available);
+    }
+    done += chunk_length;
+  }
+}
+
+char* ChunkedValue::writableChunk(std::size_t index)
+{
+  if (index >= data.size()) {
+    data.resize(index + 1);
+    owned.resize(index + 1, 0);
+  }
+
+  /* Chunks that may have been handed out are copied, even if nobody else holds them anymore. */
+  auto& chunk = data[index];
+  if (!chunk || owned[index] != generation) {
+    auto copy = kio().bufferpool().get(capacity);
+    size_t existing = chunk ? chunk->size() : 0;
+    if (existing) {
+      memcpy(&(*copy)[0], chunk->data(), existing);
+    }
+    memset(&(*copy)[existing], 0, capacity - existing);
+    chunk = copy;
+    owned[index] = generation;
+  }
+  else if (chunk->size() < capacity) {
+    const_cast<string&>(*chunk).resize(capacity, '\0');
+  }
+
+  /* Chunks owned by this object are always constructed non-const, modifying them is safe. */
+  return &const_cast<string&>(*chunk)[0];
+}
+
+void ChunkedValue::zero(std::size_t offset, std::size_t length)
+{
+  size_t done = 0;
+  while (done < length) {
+    size_t index = (offset + done) / capacity;
+    size_t chunk_offset = (offset + done) - index * capacity;
+    size_t chunk_length = std::min(length - done, capacity - chunk_offset);
+
+    if (index < data.size() && data[index] && data[index]->size() > chunk_offset) {
+      memset(writableChunk(index) + chunk_offset, 0, chunk_length);
+    }
+    done += chunk_length;
+  }
+}
+
+void ChunkedValue::write(const char* buffer, std::size_t offset, std::size_t length)
+{
+  if (offset > value_size) {
+    zero(value_size, offset - value_size);
+  }
+
+  size_t done = 0;
+  while (done < length) {
+    size_t index = (offset + done) / capacity;
+    size_t chunk_offset = (offset + done) - index * capacity;
+    size_t chunk_length = std::min(length - done, capacity - chunk_offset);
+
+    memcpy(writableChunk(index) + chunk_offset, buffer + done, chunk_length);
+    done += chunk_length;
+  }
+  value_size = std::max(value_size, offset + length);
+}
+
+void ChunkedValue::write(const ChunkedValue& source, std::size_t offset, std::size_t length)
+{
+  if (offset > value_size) {
+    zero(value_size, offset - value_size);
+  }
+
+  size_t done = 0;
+  while (done < length) {
+    size_t index = (offset + done) / capacity;
+    size_t chunk_offset = (offset + done) - index * capacity;
+    size_t chunk_length = std::min(length - done, capacity - chunk_offset);
+
+    source.read(writableChunk(index) + chunk_offset, offset + done, chunk_length);
+    done += chunk_length;
+  }
+  value_size = std::max(value_size, offset + length);
+}
+
+void ChunkedValue::resize(std::size_t size)
+{
+  if (size > value_size) {
+    zero(value_size, size - value_size);
+  }
+  else {
+    size_t num_chunks = (size + capacity - 1) / capacity;
+    if (data.size() > num_chunks) {
+      data.resize(num_chunks);
+      owned.resize(num_chunks);
+    }
+    /* Chunks are written in full, data past the new size in the last chunk would otherwise reach the drives. */
+    zero(size, num_chunks * capacity - size);
+  }
+  value_size = size;
+}
+
+std::shared_ptr<const std::string> ChunkedValue::toString() const
+{
+  if (!value_size) {
+    return make_shared<const string>();
+  }
+  auto value = kio().bufferpool().get(value_size);
+  read(&(*value)[0], 0, value_size);
+  return value;
+}
@@ -24,10 +24,24 @@ using namespace kio;
 
 
 /* Printing errors initializing static global object to stderr.*/
-ClusterMap::ClusterMap() : listener(new SocketListener())
+ClusterMap::ClusterMap(std::shared_ptr<BufferPool> pool) :
+    listener(new SocketListener()), rpCache(), bufferPool(std::move(pool)), completion_threads(4),
+    completion_queue_depth(1024)
 {
 }
 
+void ClusterMap::changeListenerConfiguration(size_t threads, bool pinning)
+{
+  listener->changeConfiguration(threads, pinning);
+}
+
+void ClusterMap::changeCompletionConfiguration(size_t threads, size_t queue_depth)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  completion_threads = threads;
+  completion_queue_depth = queue_depth;
+}
+
 void ClusterMap::reset(
     std::unordered_map<std::string, ClusterInformation> clusterInfo,
     std::unordered_map<std::string, std::pair<kinetic::ConnectionOptions, kinetic::ConnectionOptions> > driveInfo
@@ -67,7 +81,8 @@ std::shared_ptr<ClusterInterface> ClusterMap::getCluster(const std::string& id)
       throw std::system_error(std::make_error_code(std::errc::no_such_device));
     }
     std::unique_ptr<KineticAutoConnection> autocon(
-        new KineticAutoConnection(*listener, driveInfoMap.at(*wwn), ki.min_reconnect_interval)
+        new KineticAutoConnection(*listener, driveInfoMap.at(*wwn), ki.min_reconnect_interval, ki.batch_window,
+                                  ki.connections_per_drive, ki.connection_selection)
     );
     connections.push_back(std::move(autocon));
   }
@@ -77,15 +92,24 @@ std::shared_ptr<ClusterInterface> ClusterMap::getCluster(const std::string& id)
     kio_warning("#data chunks must be > #parity chunks. Configured: (", ki.numData, "-", ki.numParity, ")");
     throw std::system_error(std::make_error_code(std::errc::invalid_argument));
   }
-  auto rpName = utility::Convert::toString(ki.numData, "-", ki.numParity);
+  auto rpName = utility::Convert::toString(ki.numData, "-", ki.numParity, "-", static_cast<int>(ki.codec), "-",
+                                           ki.numLocalParity);
   if (!rpCache.count(rpName)) {
-    rpCache.insert(std::make_pair(rpName, std::make_shared<RedundancyProvider>(ki.numData, ki.numParity)));
+    try {
+      rpCache.insert(std::make_pair(rpName, std::make_shared<RedundancyProvider>(
+          ki.numData, ki.numParity, ki.codec, ki.numLocalParity, bufferPool
+      )));
+    } catch (const std::invalid_argument& e) {
+      kio_warning("Invalid redundancy configuration for cluster ", id, ": ", e.what());
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+    }
   }
 
   clusterCache.insert(
       std::make_pair(id,
                      std::make_shared<KineticAdminCluster>(
-                         id, ki.blockSize, ki.operation_timeout, std::move(connections), rpCache.at(rpName)
+                         id, ki.blockSize, ki.operation_timeout, std::move(connections), rpCache.at(rpName),
+                         ki.readHedgePercentile, completion_threads, completion_queue_depth
                      ))
   );
 
@@ -0,0 +1,236 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "CompletionQueue.hh"
+#include <condition_variable>
+#include <stdexcept>
+#include <mutex>
+#include <deque>
+#include <list>
+#include <vector>
+
+using namespace kio;
+using std::chrono::system_clock;
+
+struct CompletionQueue::Entry {
+  //! the cluster operation, empty for scheduled functions
+  std::shared_ptr<KineticClusterOperation> operation;
+  //! the point of time all operations time out
+  system_clock::time_point timeout_time;
+  //! the point of time the completion function is executed regardless
+  system_clock::time_point deadline;
+  //! the point of time the operation has to be polled again, only accessed by the poller
+  system_clock::time_point wakeup;
+  //! the completion function
+  std::function<void()> complete;
+  //! set when the operation received results since it has last been polled
+  bool signaled;
+};
+
+struct CompletionQueue::State {
+  //! queued operations
+  std::list<std::shared_ptr<Entry>> entries;
+  //! completion functions that could not be queued for the workers yet
+  std::deque<std::function<void()>> pending;
+  //! the number of completion functions started by the workers
+  uint64_t started;
+  //! set when any entry has been signaled or added
+  bool signaled;
+  //! set on destruction
+  bool shutdown;
+  //! concurrency control
+  std::mutex mutex;
+  //! wakes up the poller
+  std::condition_variable cv;
+};
+
+CompletionQueue::CompletionQueue(size_t worker_threads, size_t queue_depth) :
+    state(std::make_shared<State>()), workers(worker_threads, queue_depth), offloaded(worker_threads, 0), poller()
+{
+  if (!worker_threads || !queue_depth) {
+    throw std::invalid_argument("CompletionQueue: worker threads and queue depth have to be > 0");
+  }
+  state->started = 0;
+  state->signaled = false;
+  state->shutdown = false;
+  poller = std::thread(&CompletionQueue::run, this);
+}
+
+CompletionQueue::~CompletionQueue()
+{
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->shutdown = true;
+  }
+  state->cv.notify_one();
+  poller.join();
+}
+
+void CompletionQueue::add(const std::shared_ptr<KineticClusterOperation>& operation,
+                          const system_clock::time_point& timeout_time,
+                          const system_clock::time_point& deadline,
+                          std::function<void()> complete)
+{
+  auto entry = std::make_shared<Entry>();
+  entry->operation = operation;
+  entry->timeout_time = timeout_time;
+  entry->deadline = deadline;
+  entry->wakeup = timeout_time;
+  entry->complete = std::move(complete);
+  entry->signaled = true;
+
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->shutdown) {
+      operation->setListener(std::bind(&CompletionQueue::signal, state, std::weak_ptr<Entry>(entry)));
+      state->entries.push_back(entry);
+      state->signaled = true;
+      state->cv.notify_one();
+      return;
+    }
+  }
+  entry->complete();
+}
+
+void CompletionQueue::schedule(const system_clock::time_point& when, std::function<void()> function)
+{
+  auto entry = std::make_shared<Entry>();
+  entry->timeout_time = when;
+  entry->deadline = when;
+  entry->wakeup = when;
+  entry->complete = std::move(function);
+  entry->signaled = false;
+
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->shutdown) {
+      state->entries.push_back(entry);
+      state->signaled = true;
+      state->cv.notify_one();
+      return;
+    }
+  }
+  entry->complete();
+}
+
+void CompletionQueue::offload(std::function<void()> function)
+{
+  offloaded.run(std::move(function));
+}
+
+void CompletionQueue::execute(std::shared_ptr<State> state, std::function<void()> function)
+{
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->started++;
+    if (!state->pending.empty()) {
+      state->signaled = true;
+      state->cv.notify_one();
+    }
+  }
+  function();
+}
+
+void CompletionQueue::signal(std::shared_ptr<State> state, std::weak_ptr<Entry> entry)
+{
+  auto e = entry.lock();
+  if (!e) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(state->mutex);
+  e->signaled = true;
+  state->signaled = true;
+  state->cv.notify_one();
+}
+
+void CompletionQueue::run()
+{
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (true) {
+    /* Only operations that received results or reached their wakeup time need to be polled. */
+    auto now = system_clock::now();
+    auto shutdown = state->shutdown;
+    std::vector<std::shared_ptr<Entry>> candidates;
+    for (auto it = state->entries.begin(); it != state->entries.end(); it++) {
+      if (shutdown || (*it)->signaled || (*it)->wakeup <= now) {
+        (*it)->signaled = false;
+        candidates.push_back(*it);
+      }
+    }
+    state->signaled = false;
+
+    /* Polling may time out operations, which calls the listener. It therefore has to be done without holding the
+     * mutex. */
+    lock.unlock();
+    std::vector<std::shared_ptr<Entry>> ready;
+    for (auto it = candidates.begin(); it != candidates.end(); it++) {
+      auto& e = *it;
+      if (shutdown || now >= e->deadline || (e->operation && e->operation->poll(e->timeout_time, e->wakeup))) {
+        if (e->operation) {
+          e->operation->setListener(std::function<void()>());
+        }
+        ready.push_back(e);
+      }
+      else if (e->deadline < e->wakeup) {
+        e->wakeup = e->deadline;
+      }
+    }
+    lock.lock();
+    for (auto it = ready.begin(); it != ready.end(); it++) {
+      state->entries.remove(*it);
+      state->pending.push_back(std::move((*it)->complete));
+    }
+
+    /* Completion functions are handed to the workers in order without blocking. If the worker queue is full, the
+     * remaining ones are held back until a worker starts executing the next function. On shutdown they are executed
+     * right away instead. */
+    if (!state->pending.empty()) {
+      auto started = state->started;
+      std::deque<std::function<void()>> handoff;
+      handoff.swap(state->pending);
+      lock.unlock();
+      while (!handoff.empty()) {
+        if (!workers.try_run(std::bind(&CompletionQueue::execute, state, handoff.front()))) {
+          if (!shutdown) {
+            break;
+          }
+          handoff.front()();
+        }
+        handoff.pop_front();
+      }
+      lock.lock();
+      state->pending.insert(state->pending.begin(), handoff.begin(), handoff.end());
+      if (!handoff.empty() && state->started != started) {
+        state->signaled = true;
+      }
+    }
+    if (shutdown) {
+      break;
+    }
+
+    if (!state->signaled && !state->shutdown) {
+      if (state->entries.empty()) {
+        state->cv.wait(lock);
+      }
+      else {
+        auto next = state->entries.front()->wakeup;
+        for (auto it = state->entries.cbegin(); it != state->entries.cend(); it++) {
+          next = std::min(next, (*it)->wakeup);
+        }
+        state->cv.wait_until(lock, next);
+      }
+    }
+  }
+}
@@ -31,7 +31,7 @@ const std::chrono::milliseconds DataBlock::expiration_time(1000);
 
 DataBlock::DataBlock(std::shared_ptr<ClusterInterface> c, const std::shared_ptr<const std::string> k, Mode m) :
     mode(m), cluster(c), key(k), version(), remote_value(), local_value(), value_size(0), updates(),
-    timestamp(), mutex()
+    written(), timestamp(), mutex()
 {
   if (!cluster){
     kio_error("no cluster supplied");
@@ -61,10 +61,10 @@ void DataBlock::reassign(std::shared_ptr<ClusterInterface> c, std::shared_ptr<co
   value_size = 0;
   version.reset();
   updates.clear();
+  written.clear();
   timestamp = system_clock::time_point();
-  if (local_value) {
-    local_value->assign(capacity(), '0');
-  }
+  local_value.reset();
+  remote_value.reset();
 }
 
 std::string DataBlock::getIdentity()
@@ -72,6 +72,11 @@ std::string DataBlock::getIdentity()
   return *key + cluster->instanceId();
 }
 
+const std::shared_ptr<const std::string>& DataBlock::getKey() const
+{
+  return key;
+}
+
 bool DataBlock::validateVersion()
 {
   /* See if check is unnecessary based on expiration. */
@@ -103,8 +108,6 @@ bool DataBlock::validateVersion()
   return false;
 }
 
-/* This function is written a lot more complex than it should be at first glance. It all is
- * to avoid / minimize memory allocations and copies as much as possible */
 void DataBlock::getRemoteValue()
 {
   auto status = cluster->get(key, version, remote_value);
@@ -113,7 +116,74 @@ void DataBlock::getRemoteValue()
     kio_error("Attempting to read key '", *key, "' from cluster returned error ", status);
     throw std::system_error(std::make_error_code(std::errc::io_error));
   }
+  mergeRemoteValue(status);
+}
 
+bool DataBlock::requiresRemoteValue()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return needsRemoteValue();
+}
+
+bool DataBlock::needsRemoteValue() const
+{
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  return !version && mode == Mode::STANDARD &&
+         duration_cast<milliseconds>(system_clock::now() - timestamp) >= expiration_time;
+}
+
+bool DataBlock::flushRequiresRemoteValue()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return !version && mode == Mode::STANDARD && !overwritesRemoteValue();
+}
+
+bool DataBlock::overwritesRemoteValue() const
+{
+  /* As regions are merged, the whole value is covered only if the first region spans the full capacity. Without
+   * a truncate the value size might depend on the remote value unless the whole capacity has been written. */
+  return !written.empty() && written.begin()->first == 0 && written.begin()->second >= capacity();
+}
+
+void DataBlock::addWrittenRegion(size_t start, size_t end)
+{
+  if (start >= end) {
+    return;
+  }
+  auto it = written.upper_bound(start);
+  if (it != written.begin() && std::prev(it)->second >= start) {
+    --it;
+    start = it->first;
+  }
+  while (it != written.end() && it->first <= end) {
+    end = std::max(end, it->second);
+    it = written.erase(it);
+  }
+  written[start] = end;
+}
+
+void DataBlock::setRemoteValue(const kinetic::KineticStatus& status,
+                               const std::shared_ptr<const std::string>& remote_version,
+                               const std::shared_ptr<const ChunkedValue>& value)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  /* Errors are not reported here, the block will simply attempt to read in the value itself on next access. */
+  if (!needsRemoteValue() || (!status.ok() && status.statusCode() != StatusCode::REMOTE_NOT_FOUND)) {
+    return;
+  }
+  if (status.ok()) {
+    version = remote_version;
+    remote_value = value;
+  }
+  mergeRemoteValue(status);
+}
+
+/* This function is written a lot more complex than it should be at first glance. It all is
+ * to avoid / minimize memory allocations and copies as much as possible */
+void DataBlock::mergeRemoteValue(const kinetic::KineticStatus& status)
+{
   /* If remote is not available, reset version. */
   if (status.statusCode() == StatusCode::REMOTE_NOT_FOUND) {
     version.reset();
@@ -138,25 +208,20 @@ void DataBlock::getRemoteValue()
     return;
   }
 
-  /* Due to getting a <const string> returned from the cluster, we will have to create yet another string
-   * variable to merge the local changes. */
-  auto merged_value = make_shared<string>(*remote_value);
+  /* The merged value shares the chunks of the remote value, only chunks touched by local changes are copied. */
+  auto merged_value = copyRemoteValue();
 
   /* Merge all updates done on the local data copy (value) into the freshly read-in data copy. */
-  if (merged_value->size() < capacity()) {
-    merged_value->resize(capacity());
-  }
-
   for (auto it = updates.cbegin(); it != updates.cend(); ++it) {
     auto update = *it;
     if (!update.second) {
-      value_size = update.first;
+      merged_value->resize(update.first);
     }
     else {
-      value_size = std::max(update.first + update.second, value_size);
-      merged_value->replace(update.first, update.second, *local_value, update.first, update.second);
+      merged_value->write(*local_value, update.first, update.second);
     }
   }
+  value_size = merged_value->size();
   remote_value.reset();
   local_value = std::move(merged_value);
 }
@@ -182,42 +247,139 @@ void DataBlock::read(char* const buffer, size_t offset, size_t length)
   if (value_size > offset) {
     size_t copy_length = std::min(length, value_size - offset);
     if (local_value) {
-      local_value->copy(buffer, copy_length, offset);
+      local_value->read(buffer, offset, copy_length);
     } else {
-      remote_value->copy(buffer, copy_length, offset);
+      remote_value->read(buffer, offset, copy_length);
     }
   }
 }
 
-void DataBlock::write(const char* const buffer, size_t offset, size_t length)
+bool DataBlock::readResident(char* const buffer, size_t offset, size_t length, size_t& size)
 {
   std::lock_guard<std::mutex> lock(mutex);
   if (buffer == NULL || offset + length > cluster->limits().max_value_size){
-    kio_warning("Invalid argument. ", buffer ? "" : "No buffer supplied!"," offset=", offset, " length=", length);
+    kio_warning("Invalid argument. buffer=",buffer, " offset=", offset, " length=", length);
     throw std::system_error(std::make_error_code(std::errc::invalid_argument));
   }
 
-  /* Set new entry size. */
-  value_size = std::max(offset + length, value_size);
+  /* The timestamp is set whenever the value has been read in, flushed or the block has been created. Before that,
+   * regions that have not been written locally are only known to the backend. */
+  if (timestamp == system_clock::time_point()) {
+    return false;
+  }
 
-  /* Ensure that the value string exists and is big enough to store the write request. If necessary,
-   * we will allocate straight to capacity size to prevent multiple resize operations making
-   * a mess of heap allocation (that's why we are storing value_size separately in the first
-   * place). */
-  if (!local_value) {
-    local_value = std::make_shared<string>(capacity(), '0');
-    if (remote_value) {
-      local_value->replace(0, string::npos, *remote_value);
-      remote_value.reset();
+  if (offset + length > value_size) {
+    memset(buffer, 0, length);
+  }
+
+  if (value_size > offset) {
+    size_t copy_length = std::min(length, value_size - offset);
+    if (local_value) {
+      local_value->read(buffer, offset, copy_length);
+    } else if (remote_value) {
+      remote_value->read(buffer, offset, copy_length);
+    }
+  }
+  size = value_size;
+  return true;
+}
+
+void DataBlock::refreshAsync(FlushCallback callback)
+{
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (duration_cast<milliseconds>(system_clock::now() - timestamp) < expiration_time) {
+    lock.unlock();
+    callback(std::error_code());
+    return;
+  }
+
+  /* As in validateVersion, a block that has never been read in skips version validation. */
+  auto k = key;
+  auto c = cluster;
+  auto expected_version = version;
+  auto skip_validation = !version && mode == Mode::STANDARD;
+  lock.unlock();
+
+  if (skip_validation) {
+    c->getAsync(k, false, std::bind(&DataBlock::refreshValue, shared_from_this(), expected_version, callback,
+                                    std::placeholders::_1));
+    return;
+  }
+  c->getAsync(k, true, std::bind(&DataBlock::refreshVersion, shared_from_this(), expected_version, callback,
+                                 std::placeholders::_1));
+}
+
+void DataBlock::refreshVersion(std::shared_ptr<const std::string> expected_version, FlushCallback callback,
+                               const AsyncResult& result)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  /* If the block has been read in or flushed since the get was issued, it is up to date already. */
+  auto current = version != expected_version;
+  if (!current && ((!version && result.status.statusCode() == StatusCode::REMOTE_NOT_FOUND) ||
+                   (result.status.ok() && result.version && version && *version == *result.version))) {
+    /* In memory version equals remote version. Remember the time. */
+    timestamp = system_clock::now();
+    current = true;
+  }
+  auto k = key;
+  auto c = cluster;
+  lock.unlock();
+
+  if (current) {
+    callback(std::error_code());
+    return;
+  }
+  c->getAsync(k, false, std::bind(&DataBlock::refreshValue, shared_from_this(), expected_version, callback,
+                                  std::placeholders::_1));
+}
+
+void DataBlock::refreshValue(std::shared_ptr<const std::string> expected_version, FlushCallback callback,
+                             const AsyncResult& result)
+{
+  if (!result.status.ok() && result.status.statusCode() != StatusCode::REMOTE_NOT_FOUND) {
+    kio_error("Attempting to read key '", *key, "' from cluster returned error ", result.status);
+    callback(std::make_error_code(std::errc::io_error));
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    /* The remote value might have been read in or flushed by someone else in the meantime. */
+    if (version == expected_version) {
+      if (result.status.ok()) {
+        version = result.version;
+        remote_value = result.value;
+      }
+      mergeRemoteValue(result.status);
     }
   }
-  if (value_size > local_value->size()) {
-    local_value->resize(capacity());
+  callback(std::error_code());
+}
+
+void DataBlock::write(const char* const buffer, size_t offset, size_t length)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (buffer == NULL || offset + length > cluster->limits().max_value_size){
+    kio_warning("Invalid argument. ", buffer ? "" : "No buffer supplied!"," offset=", offset, " length=", length);
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+  }
+
+  /* Ensure that the local value exists. Chunks are allocated at chunk capacity on first write, so that the
+   * stripe can later be built from them without copying. */
+  if (!local_value) {
+    local_value = copyRemoteValue();
+    remote_value.reset();
+    local_value->resize(value_size);
   }
 
-  /* Copy data and remember write access. */
-  local_value->replace(offset, length, buffer, length);
+  /* Copy data, set new entry size and remember write access. */
+  local_value->write(buffer, offset, length);
+  value_size = local_value->size();
   updates.push_back(std::pair<size_t, size_t>(offset, length));
+  addWrittenRegion(offset, offset + length);
 }
 
 void DataBlock::truncate(size_t offset)
@@ -229,7 +391,12 @@ void DataBlock::truncate(size_t offset)
   }
 
   value_size = offset;
+  if (local_value) {
+    local_value->resize(offset);
+  }
   updates.push_back(std::make_pair(offset, 0));
+  /* Everything past the offset no longer depends on the remote value. */
+  addWrittenRegion(offset, capacity());
 }
 
 void DataBlock::flush()
@@ -237,21 +404,30 @@ void DataBlock::flush()
   std::lock_guard<std::mutex> lock(mutex);
   KineticStatus status(StatusCode::CLIENT_INTERNAL_ERROR, "invalid");
   do {
+    /* If the local changes replace the complete value, merging them into the remote value would result in the
+     * local value. Instead of reading the remote value, the local value is written unconditionally. */
+    bool overwrite = false;
     if (status.statusCode() == StatusCode::REMOTE_VERSION_MISMATCH || (!version && mode == Mode::STANDARD)) {
-      getRemoteValue();
+      if (overwritesRemoteValue()) {
+        overwrite = true;
+      }
+      else {
+        getRemoteValue();
+      }
     }
 
-    if (local_value) {
-      if (value_size != local_value->size()) {
-        local_value->resize(value_size);
+    std::shared_ptr<const ChunkedValue> value = local_value;
+    if (!value) {
+      if (!remote_value) {
+        remote_value = std::make_shared<const ChunkedValue>(chunkCapacity());
       }
-      status = cluster->put(key, version, local_value, version);
+      value = remote_value;
+    }
+    if (overwrite) {
+      status = cluster->put(key, value, version);
     }
     else {
-      if (!remote_value) {
-        remote_value = std::make_shared<const string>();
-      }
-      status = cluster->put(key, version, remote_value, version);
+      status = cluster->put(key, version, value, version);
     }
   } while (status.statusCode() == StatusCode::REMOTE_VERSION_MISMATCH);
 
@@ -263,9 +439,124 @@ void DataBlock::flush()
   /* Success... we can forget about in-memory changes and set timestamp
      to current time. */
   updates.clear();
+  written.clear();
   timestamp = system_clock::now();
 }
 
+void DataBlock::flushAsync(FlushCallback callback)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!version && mode == Mode::STANDARD) {
+    flushRemote(lock, callback);
+    return;
+  }
+  flushPut(lock, false, callback);
+}
+
+void DataBlock::flushRemote(std::unique_lock<std::mutex>& lock, FlushCallback callback)
+{
+  /* As in flush, local changes replacing the complete value are written unconditionally. Otherwise they have
+   * to be merged into the remote value first, which is read asynchronously as well. */
+  if (overwritesRemoteValue()) {
+    flushPut(lock, true, callback);
+    return;
+  }
+  auto k = key;
+  auto c = cluster;
+  auto expected_version = version;
+  lock.unlock();
+  c->getAsync(k, false, std::bind(&DataBlock::flushMerge, shared_from_this(), expected_version, callback,
+                                  std::placeholders::_1));
+}
+
+void DataBlock::flushMerge(std::shared_ptr<const std::string> expected_version, FlushCallback callback,
+                           const AsyncResult& result)
+{
+  if (!result.status.ok() && result.status.statusCode() != StatusCode::REMOTE_NOT_FOUND) {
+    kio_error("Attempting to read key '", *key, "' from cluster returned error ", result.status);
+    callback(std::make_error_code(std::errc::io_error));
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  /* The remote value might have been read in or flushed by someone else in the meantime. */
+  if (version == expected_version) {
+    if (result.status.ok()) {
+      version = result.version;
+      remote_value = result.value;
+    }
+    mergeRemoteValue(result.status);
+  }
+  flushPut(lock, false, callback);
+}
+
+void DataBlock::flushPut(std::unique_lock<std::mutex>& lock, bool overwrite, FlushCallback callback)
+{
+  /* The snapshot shares its chunks with the local value, chunks written to while the put is outstanding will be
+   * copied by the local value. */
+  std::shared_ptr<const ChunkedValue> value;
+  if (local_value) {
+    value = make_shared<const ChunkedValue>(*local_value);
+  }
+  else {
+    if (!remote_value) {
+      remote_value = make_shared<const ChunkedValue>(chunkCapacity());
+    }
+    value = remote_value;
+  }
+  auto expected_version = version;
+  auto flushed_updates = updates.size();
+  auto k = key;
+  auto c = cluster;
+  lock.unlock();
+
+  auto complete = std::bind(&DataBlock::flushComplete, shared_from_this(), value, expected_version, flushed_updates,
+                            callback, std::placeholders::_1);
+  if (overwrite) {
+    c->putAsync(k, value, complete);
+  }
+  else {
+    c->putAsync(k, expected_version, value, complete);
+  }
+}
+
+void DataBlock::flushComplete(std::shared_ptr<const ChunkedValue> value,
+                              std::shared_ptr<const std::string> expected_version, size_t flushed_updates,
+                              FlushCallback callback, const AsyncResult& result)
+{
+  /* The key has been written by someone else, as in flush it is read in again and local changes are merged in. */
+  if (result.status.statusCode() == StatusCode::REMOTE_VERSION_MISMATCH) {
+    std::unique_lock<std::mutex> lock(mutex);
+    flushRemote(lock, callback);
+    return;
+  }
+
+  if (!result.status.ok()) {
+    kio_error("Attempting to write key '", *key, "' from cluster returned error ", result.status);
+    callback(std::make_error_code(std::errc::io_error));
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    /* If the block has been flushed or read in since the put was issued, its version is more recent. If it has been
+     * written to, it stays dirty. Updates are merged in order, so flushing them again is harmless. */
+    if (version == expected_version) {
+      version = result.version;
+      /* The encoding stays valid for the local value, chunks changed since are identified by comparing them. */
+      if (local_value) {
+        local_value->setEncoding(value->encoding());
+      }
+      if (updates.size() == flushed_updates) {
+        updates.clear();
+        written.clear();
+        timestamp = system_clock::now();
+      }
+    }
+  }
+  callback(std::error_code());
+}
+
 bool DataBlock::dirty() const
 {
   std::lock_guard<std::mutex> lock(mutex);
@@ -287,6 +578,29 @@ size_t DataBlock::capacity() const
   return cluster->limits().max_value_size;
 }
 
+size_t DataBlock::footprint() const
+{
+  return cluster->limits().max_value_size + cluster->limits().parity_size;
+}
+
+size_t DataBlock::chunkCapacity() const
+{
+  return cluster->limits().chunk_size ? cluster->limits().chunk_size : capacity();
+}
+
+std::shared_ptr<ChunkedValue> DataBlock::copyRemoteValue() const
+{
+  if (!remote_value) {
+    return make_shared<ChunkedValue>(chunkCapacity());
+  }
+  if (remote_value->chunkCapacity() == chunkCapacity()) {
+    return make_shared<ChunkedValue>(*remote_value);
+  }
+  auto value = make_shared<ChunkedValue>(chunkCapacity());
+  value->write(*remote_value, 0, remote_value->size());
+  return value;
+}
+
 size_t DataBlock::size()
 {
   std::lock_guard<std::mutex> lock(mutex);
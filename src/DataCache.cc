@@ -23,46 +23,137 @@
 using namespace kio;
 
 
-DataCache::DataCache(size_t capacity) :
-    capacity(capacity), current_size(0), unused_size(0)
+DataCache::DataCache(size_t capacity, size_t num_shards, Policy policy) :
+    capacity(capacity), current_size(0), policy(policy), next_shrink_shard(0), hits(0), misses(0), evictions(0),
+    ghost_hits(0), shards(), file_ids(), file_names(), next_file_id(1)
 {
+  for (size_t i = 0; i < std::max(num_shards, (size_t) 1); i++) {
+    shards.push_back(std::unique_ptr<Shard>(new Shard(policy)));
+  }
 }
 
-void DataCache::changeConfiguration(size_t cap)
+void DataCache::changeConfiguration(size_t cap, Policy p)
 {
   capacity = cap;
+  if (policy.exchange(p) == p) {
+    return;
+  }
+
+  for (auto sit = shards.begin(); sit != shards.end(); sit++) {
+    Shard& shard = **sit;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.policy = p;
+    /* LRU only uses the main queue, probation items are moved there in order. */
+    if (p == Policy::LRU) {
+      for (auto it = shard.probation.begin(); it != shard.probation.end(); it++) {
+        it->probation = false;
+      }
+      shard.cache.splice(shard.cache.end(), shard.probation);
+      while (!shard.ghosts.empty()) {
+        shard.ghost_lookup.erase(shard.ghosts.back().first, shard.ghosts.back().second);
+        shard.ghosts.pop_back();
+      }
+    }
+  }
+
+  hits = 0;
+  misses = 0;
+  evictions = 0;
+  ghost_hits = 0;
+  kio_notice("Cache replacement policy set to ", p == Policy::LRU ? "LRU" : "2Q");
+}
+
+DataCache::Statistics DataCache::statistics()
+{
+  return Statistics{policy, hits, misses, evictions, ghost_hits};
+}
+
+DataCache::Shard& DataCache::shard(uint64_t file_id, int blocknumber)
+{
+  /* Consecutive blocks of a file are spread over shards, so concurrent access to a single file is distributed as
+   * well as access to different files. */
+  uint64_t hash = file_id * 0x9e3779b97f4a7c15ULL ^ static_cast<uint32_t>(blocknumber);
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return *shards[hash % shards.size()];
+}
+
+uint64_t DataCache::acquireFileId(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(file_id_mutex);
+  auto it = file_ids.find(name);
+  if (it == file_ids.end()) {
+    it = file_ids.insert(std::make_pair(name, FileIdEntry{next_file_id++, 0})).first;
+    file_names.insert(std::make_pair(it->second.id, name));
+  }
+  it->second.references++;
+  return it->second.id;
+}
+
+void DataCache::retainFileId(uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(file_id_mutex);
+  auto name = file_names.find(id);
+  if (name != file_names.end()) {
+    file_ids[name->second].references++;
+  }
+}
+
+void DataCache::releaseFileId(uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(file_id_mutex);
+  auto name = file_names.find(id);
+  if (name == file_names.end()) {
+    return;
+  }
+  auto it = file_ids.find(name->second);
+  if (--it->second.references == 0) {
+    file_ids.erase(it);
+    file_names.erase(name);
+  }
 }
 
 void DataCache::drop(kio::FileIo* owner, bool force)
 {
-  std::lock_guard<std::mutex> lock(cache_mutex);
-  if (owner_tables.count(owner)) {
-    for (auto owit = owner_tables[owner].cbegin(); owit != owner_tables[owner].cend(); owit++) {
-      cache_iterator it = *owit;
-      it->owners.erase(owner);
-      /* Because some clients apparently like re-opening files, we will no longer automatically remove orphaned 
-       * data keys (unless force is set)... they will only be removed when cache pressure indicates.  */
-      if (force) {
-        remove_item(it);
+  for (auto sit = shards.begin(); sit != shards.end(); sit++) {
+    Shard& shard = **sit;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.owner_tables.count(owner)) {
+      for (auto owit = shard.owner_tables[owner].cbegin(); owit != shard.owner_tables[owner].cend(); owit++) {
+        cache_iterator it = *owit;
+        it->owners.erase(owner);
+        /* Because some clients apparently like re-opening files, we will no longer automatically remove orphaned
+         * data keys (unless force is set)... they will only be removed when cache pressure indicates.  */
+        if (force) {
+          remove_item(shard, it);
+        }
       }
     }
+    shard.owner_tables.erase(owner);
   }
-  owner_tables.erase(owner);
 }
 
-void DataCache::flush(kio::FileIo* owner)
+std::vector<std::shared_ptr<kio::DataBlock>> DataCache::owner_blocks(kio::FileIo* owner)
 {
-  /* build a vector of blocks, so we can flush without holding cache_mutex */
   std::vector<std::shared_ptr<kio::DataBlock> > blocks;
-  {
-    std::lock_guard<std::mutex> lock(cache_mutex);
-    if (owner_tables.count(owner)) {
-      for (auto item = owner_tables[owner].cbegin(); item != owner_tables[owner].cend(); item++) {
+  for (auto sit = shards.begin(); sit != shards.end(); sit++) {
+    Shard& shard = **sit;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.owner_tables.count(owner)) {
+      for (auto item = shard.owner_tables[owner].cbegin(); item != shard.owner_tables[owner].cend(); item++) {
         cache_iterator it = *item;
         blocks.push_back(it->data);
       }
     }
   }
+  return blocks;
+}
+
+void DataCache::flush(kio::FileIo* owner)
+{
+  /* build a vector of blocks, so we can flush without holding any shard mutex */
+  auto blocks = owner_blocks(owner);
 
   for (auto it = blocks.begin(); it != blocks.end(); it++) {
     auto& block = *it;
@@ -72,140 +163,321 @@ void DataCache::flush(kio::FileIo* owner)
   }
 }
 
-DataCache::cache_iterator DataCache::remove_item(const cache_iterator& it)
+namespace {
+/* Collects the results of concurrently flushed blocks. */
+struct FlushCollector {
+  std::mutex mutex;
+  size_t outstanding;
+  std::error_code error;
+  DataBlock::FlushCallback callback;
+};
+
+void collect_flush(std::shared_ptr<FlushCollector> collector, const std::error_code& error)
+{
+  {
+    std::lock_guard<std::mutex> lock(collector->mutex);
+    if (error && !collector->error) {
+      collector->error = error;
+    }
+    if (--collector->outstanding) {
+      return;
+    }
+  }
+  collector->callback(collector->error);
+}
+}
+
+void DataCache::flushAsync(kio::FileIo* owner, DataBlock::FlushCallback callback)
+{
+  auto blocks = owner_blocks(owner);
+
+  /* The collector starts out with an additional outstanding result, so that it can't complete while blocks are
+   * still being submitted. */
+  auto collector = std::make_shared<FlushCollector>();
+  collector->outstanding = 1;
+  collector->callback = std::move(callback);
+
+  for (auto it = blocks.begin(); it != blocks.end(); it++) {
+    auto& block = *it;
+    if (block->dirty()) {
+      {
+        std::lock_guard<std::mutex> lock(collector->mutex);
+        collector->outstanding++;
+      }
+      block->flushAsync(std::bind(collect_flush, collector, std::placeholders::_1));
+    }
+  }
+  collect_flush(collector, std::error_code());
+}
+
+DataCache::cache_iterator DataCache::remove_item(Shard& shard, const cache_iterator& it)
 {
   for (auto o = it->owners.cbegin(); o != it->owners.cend(); o++) {
-    owner_tables[*o].erase(it);
+    shard.owner_tables[*o].erase(it);
   }
 
-  lookup.erase(it->data->getIdentity());
-  current_size -= it->data->capacity();
+  shard.lookup.erase(it->file_id, it->blocknumber);
+  releaseFileId(it->file_id);
+  shard.current_size -= it->data->footprint();
+  current_size -= it->data->footprint();
+
+  auto& queue = it->probation ? shard.probation : shard.cache;
+  it->probation = false;
 
   /* We don't want to keep too many unused cache items around... */
-  if (unused_size > 0.1 * capacity) {
+  if (shard.unused_size > 0.1 * capacity / shards.size()) {
     kio_debug("Deleting cache key ", it->data->getIdentity(), " from cache.");
-    return cache.erase(it);
+    return queue.erase(it);
   }
 
   kio_debug("Transferring cache key ", it->data->getIdentity(), " from cache to unused items pool.");
   auto next_it = std::next(it);
-  unused_size += it->data->capacity();
-  unused_items.splice(unused_items.begin(), cache, it);
+  shard.unused_size += it->data->footprint();
+  shard.unused_items.splice(shard.unused_items.begin(), queue, it);
   return next_it;
 }
 
-namespace {
-  void doFlush(std::shared_ptr<kio::DataBlock> data)
-  {
-    if (data->dirty()) {
-      data->flush();
-    }
+void DataCache::add_ghost(Shard& shard, uint64_t file_id, int blocknumber)
+{
+  if (shard.ghost_lookup.find(file_id, blocknumber)) {
+    return;
+  }
+  shard.ghosts.push_front(std::make_pair(file_id, blocknumber));
+  shard.ghost_lookup.insert(file_id, blocknumber, shard.ghosts.begin());
+
+  /* Remember about as many evicted blocks as half the number of blocks cached in the shard. */
+  auto max_ghosts = std::max((shard.cache.size() + shard.probation.size()) / 2, (size_t) 16);
+  while (shard.ghosts.size() > max_ghosts) {
+    shard.ghost_lookup.erase(shard.ghosts.back().first, shard.ghosts.back().second);
+    shard.ghosts.pop_back();
   }
 }
 
-void DataCache::try_shrink()
+void DataCache::shrink_expired(Shard& shard, std::list<CacheItem>& queue)
 {
   using namespace std::chrono;
+  if (queue.empty()) {
+    return;
+  }
   auto expired = system_clock::now() - seconds(5);
-  auto num_items = (current_size / cache.back().data->capacity()) * 0.1;
+  auto num_items = (queue.size()) * 0.1;
   auto count_items = 0;
 
-  for (auto it = --cache.end(); num_items > count_items && it != cache.begin(); it--, count_items++) {
+  for (auto it = --queue.end(); num_items > count_items && it != queue.begin(); it--, count_items++) {
     if ((it->owners.empty() || it->last_access < expired) && !it->data->dirty() && it->data.unique()) {
-      it = remove_item(it);
+      if (it->probation) {
+        add_ghost(shard, it->file_id, it->blocknumber);
+      }
+      it = remove_item(shard, it);
+      evictions++;
     }
-    else if(it->data->dirty() && it->last_access < expired){
-      kio_debug("Attempting background flush of dirty expired data chunk: ", it->data->getIdentity());
-      kio().threadpool().try_run(std::bind(&doFlush, it->data));
+  }
+}
+
+void DataCache::evict(Shard& shard, std::list<CacheItem>& queue,
+                      std::vector<std::shared_ptr<kio::DataBlock>>* dirty)
+{
+  using namespace std::chrono;
+  if (queue.empty()) {
+    return;
+  }
+
+  size_t collected = 0;
+  for (auto it = --queue.end(); capacity < current_size && it != queue.begin(); it--) {
+    if (!it->data.unique()) {
+      continue;
+    }
+    /* Flushing is a network operation, it must not be done while holding the shard mutex. */
+    if (it->data->dirty()) {
+      if (dirty && collected + capacity < current_size) {
+        dirty->push_back(it->data);
+        collected += it->data->footprint();
+      }
+      continue;
     }
+    kio_debug("Cache key ", it->data->getIdentity(), " identified for removal. It is in cache position ",
+              std::distance(queue.begin(), it), " out of ", queue.size(),
+              " and has last been accessed ", duration_cast<seconds>(system_clock::now() - it->last_access), " ago");
+    if (it->probation) {
+      add_ghost(shard, it->file_id, it->blocknumber);
+    }
+    it = remove_item(shard, it);
+    evictions++;
+  }
+}
+
+void DataCache::shrink_round_robin()
+{
+  /* The accessed shard alone might not be able to give up enough items, e.g. if it holds only few blocks. Shards are
+   * shrunk in turn until the cache is within capacity again, so that idle shards give up their items as well. Shard
+   * mutexes are acquired one at a time. */
+  std::vector<std::shared_ptr<kio::DataBlock>> dirty;
+  for (size_t i = 0; i < shards.size() && capacity < current_size; i++) {
+    Shard& shard = *shards[next_shrink_shard++ % shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    try_shrink(shard, &dirty);
+  }
+  if (dirty.empty()) {
+    return;
+  }
+
+  /* There were not enough clean unused items to drop. Flush dirty ones without holding any shard mutex, they can
+   * be evicted as clean items afterwards. */
+  for (auto it = dirty.begin(); it != dirty.end(); it++) {
+    try {
+      (*it)->flush();
+      kio_notice("Cache key ", (*it)->getIdentity(), " identified for FORCE REMOVAL as there were no clean unique "
+          "keys in the cache to drop.");
+    }
+    catch (const std::exception& e) {
+      kio_warning("Failed flushing cache item ", (*it)->getIdentity(), "  Reason: ", e.what());
+    }
+  }
+  dirty.clear();
+
+  for (size_t i = 0; i < shards.size() && capacity < current_size; i++) {
+    Shard& shard = *shards[next_shrink_shard++ % shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    try_shrink(shard, NULL);
+  }
+}
+
+void DataCache::try_shrink(Shard& shard, std::vector<std::shared_ptr<kio::DataBlock>>* dirty)
+{
+  /* 2Q evicts from the probation queue as long as it holds more than a quarter of the items in the shard, LRU
+   * only uses the main queue. */
+  std::list<CacheItem>* queues[] = {&shard.cache, &shard.probation};
+  if (shard.policy == Policy::TWO_Q && shard.probation.size() > (shard.cache.size() + shard.probation.size()) / 4) {
+    std::swap(queues[0], queues[1]);
+  }
+
+  for (auto q = std::begin(queues); q != std::end(queues); q++) {
+    shrink_expired(shard, **q);
   }
 
   /* If cache size exceeds capacity, we have to force remove data keys. */
   if (capacity < current_size) {
     kio_debug("Cache capacity reached.");
-
-    for (auto it = --cache.end(); capacity < current_size && it != cache.begin(); it--) {
-      if (it->data.unique() && !it->data->dirty()) {
-        kio_debug("Cache key ", it->data->getIdentity(), " identified for removal. It is in cache position ",
-                  std::distance(cache.begin(), it), " out of ", std::distance(cache.begin(), cache.end()),
-                  " and has last been accessed ", duration_cast<seconds>(system_clock::now() - it->last_access), " ago");
-        remove_item(it);
-      }
+    for (auto q = std::begin(queues); q != std::end(queues); q++) {
+      evict(shard, **q, NULL);
     }
-
-    /* Second try.. can't find an ideal candidate, we will flush. */
-    for (auto it = --cache.end(); capacity < current_size && it != cache.begin(); it--) {
-      if (it->data.unique()) {
-        if (it->data->dirty()) {
-          try {
-            it->data->flush();
-          }
-          catch (const std::exception& e) {
-            kio_warning("Failed flushing cache item ", it->data->getIdentity(), "  Reason: ", e.what());
-            continue;
-          }
-        }
-        kio_notice("Cache key ", it->data->getIdentity(), " identified for FORCE REMOVAL as there were no clean unique"
-            "keys in the cache to drop.");
-        remove_item(it);
+    /* Second try.. can't find an ideal candidate, dirty items have to be flushed by the caller. */
+    if (dirty) {
+      for (auto q = std::begin(queues); q != std::end(queues); q++) {
+        evict(shard, **q, dirty);
       }
     }
   }
 }
 
-std::shared_ptr<kio::DataBlock> DataCache::getDataKey(kio::FileIo* owner, int blocknumber, DataBlock::Mode mode)
+std::shared_ptr<kio::DataBlock> DataCache::lookup_item(Shard& shard, kio::FileIo* owner, int blocknumber)
 {
-  /* We cannot use the block key directly for cache lookups, as reloading the configuration will create
-     different cluster objects and we have to avoid FileIo objects being associated with multiple clusters */
-  auto data_key = utility::makeDataKey(owner->cluster->id(), owner->path, blocknumber);
-  std::string cache_key = *data_key + owner->cluster->instanceId();
+  auto item = shard.lookup.find(owner->file_id, blocknumber);
+  if (!item) {
+    return std::shared_ptr<kio::DataBlock>();
+  }
+  kio_debug("Serving block ", blocknumber, " of file ", owner->path, " for owner ", owner, " from cache.");
 
-  std::lock_guard<std::mutex> cachelock(cache_mutex);
-  /* If the requested block is already cached, we can return it without IO. */
-  if (lookup.count(cache_key)) {
-    kio_debug("Serving data key ", *data_key, " for owner ", owner, " from cache.");
+  /* Splicing the element into the front of the list will keep iterators valid. Hits in the 2Q probation queue
+   * do not change the queue order. */
+  auto it = *item;
+  if (!it->probation) {
+    shard.cache.splice(shard.cache.begin(), shard.cache, it);
+  }
 
-    /* Splicing the element into the front of the list will keep iterators valid. */
-    cache.splice(cache.begin(), cache, lookup[cache_key]);
+  /* set owner<->cache_item relationship. Since we have std::sets there's no need to test for existence */
+  shard.owner_tables[owner].insert(it);
+  it->owners.insert(owner);
 
-    /* set owner<->cache_item relationship. Since we have std::sets there's no need to test for existence */
-    owner_tables[owner].insert(cache.begin());
-    cache.front().owners.insert(owner);
+  /* Update access timestamp */
+  it->last_access = std::chrono::system_clock::now();
+  hits++;
+  return it->data;
+}
 
-    /* Update access timestamp */
-    cache.front().last_access = std::chrono::system_clock::now();
-    return cache.front().data;
+std::shared_ptr<kio::DataBlock> DataCache::getDataKey(kio::FileIo* owner, int blocknumber, DataBlock::Mode mode)
+{
+  Shard& shard = this->shard(owner->file_id, blocknumber);
+
+  /* If the requested block is already cached, we can return it without IO or memory allocation. */
+  {
+    std::lock_guard<std::mutex> cachelock(shard.mutex);
+    auto data = lookup_item(shard, owner, blocknumber);
+    if (data) {
+      return data;
+    }
+  }
+
+  /* The cache is keyed by file id, which identifies path and cluster instance. Reloading the configuration will
+   * create different cluster objects, so FileIo objects will never be associated with multiple clusters. */
+  auto data_key = utility::makeDataKey(owner->cluster->id(), owner->path, blocknumber);
+
+  std::unique_lock<std::mutex> cachelock(shard.mutex);
+  /* Another thread might have added the block while the lock was released. */
+  auto data = lookup_item(shard, owner, blocknumber);
+  if (data) {
+    return data;
   }
 
   /* Attempt to shrink cache size by releasing unused items */
   if (current_size > capacity * 0.7) {
-    try_shrink();
+    try_shrink(shard, NULL);
   }
 
+  /* With 2Q, new blocks are put on probation unless they have recently been evicted from probation. */
+  bool probation = false;
+  if (shard.policy == Policy::TWO_Q) {
+    auto ghost = shard.ghost_lookup.find(owner->file_id, blocknumber);
+    if (ghost) {
+      shard.ghosts.erase(*ghost);
+      shard.ghost_lookup.erase(owner->file_id, blocknumber);
+      ghost_hits++;
+    }
+    else {
+      probation = true;
+    }
+  }
+  auto& queue = probation ? shard.probation : shard.cache;
+
   /* Re-use an existing data key object if possible, if none exists create a new one. */
-  if (unused_items.begin() != unused_items.end()) {
-    auto it = unused_items.begin();
-    unused_size -= it->data->capacity();
+  if (shard.unused_items.begin() != shard.unused_items.end()) {
+    auto it = shard.unused_items.begin();
+    shard.unused_size -= it->data->footprint();
     it->owners.clear();
     it->owners.insert(owner);
     it->data->reassign(owner->cluster, data_key, mode);
     it->last_access = std::chrono::system_clock::now();
-    cache.splice(cache.begin(), unused_items, it);
+    it->file_id = owner->file_id;
+    it->blocknumber = blocknumber;
+    it->probation = probation;
+    queue.splice(queue.begin(), shard.unused_items, it);
     kio_debug("Added reused data key ", *data_key, " to the cache for owner ", owner);
   }
   else {
-    cache.push_front(
+    queue.push_front(
         CacheItem{std::set<kio::FileIo*>{owner},
                   std::make_shared<DataBlock>(owner->cluster, data_key, mode),
-                  std::chrono::system_clock::now()
+                  std::chrono::system_clock::now(),
+                  owner->file_id,
+                  blocknumber,
+                  probation
         }
     );
     kio_debug("Added new data key ", *data_key, " to the cache for owner ", owner);
   }
-  current_size += cache.front().data->capacity();
-  lookup[cache_key] = cache.begin();
-  owner_tables[owner].insert(cache.begin());
-  return cache.front().data;;
+  misses++;
+  retainFileId(owner->file_id);
+  shard.current_size += queue.front().data->footprint();
+  current_size += queue.front().data->footprint();
+  shard.lookup.insert(owner->file_id, blocknumber, queue.begin());
+  shard.owner_tables[owner].insert(queue.begin());
+  data = queue.front().data;
+  cachelock.unlock();
+
+  if (capacity < current_size) {
+    shrink_round_robin();
+  }
+  return data;
 }
 
 double DataCache::utilization()
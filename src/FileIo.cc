@@ -29,7 +29,8 @@ using namespace kio;
 
 
 FileIo::FileIo(const std::string& url) :
-    cluster(), prefetchOracle(kio().readaheadWindowSize()), opened(false)
+    cluster(), prefetchOracle(kio().readaheadWindowSize()), eof_blocknumber(0), opened(false), path(), file_id(0),
+    async_outstanding(0)
 {
   if (url.compare(0, strlen("kinetic://"), "kinetic://") != 0) {
     kio_error("Invalid url supplied. Required format: kinetic://clusterId/path, supplied: ", url);
@@ -40,13 +41,18 @@ FileIo::FileIo(const std::string& url) :
   cluster = kio().cmap().getCluster(
       utility::urlToClusterId(url)
   );
+  file_id = kio().cache().acquireFileId(cluster->instanceId() + path);
 }
 
 FileIo::~FileIo()
 {
+  waitAsync();
+
   /* In case fileIo object is destroyed without having been closed, throw cache data out the window. If
    * object has been closed, cache will have already been dropped. */
+  kio().writeback().drop(this);
   kio().cache().drop(this, true);
+  kio().cache().releaseFileId(file_id);
 }
 
 void FileIo::Open(int flags, mode_t mode, const std::string& opaque, uint16_t timeout)
@@ -63,6 +69,7 @@ void FileIo::Open(int flags, mode_t mode, const std::string& opaque, uint16_t ti
         version);
 
     if (status.ok()) {
+      std::lock_guard<std::mutex> lock(eof_mutex);
       eof_blocknumber = 0;
       eof_verification_time = std::chrono::system_clock::now();
     }
@@ -78,6 +85,7 @@ void FileIo::Open(int flags, mode_t mode, const std::string& opaque, uint16_t ti
         version
     );
     if (status.ok()) {
+      std::lock_guard<std::mutex> lock(eof_mutex);
       eof_blocknumber = 0;
       eof_verification_time = std::chrono::system_clock::time_point();
     }
@@ -96,7 +104,11 @@ void FileIo::Open(int flags, mode_t mode, const std::string& opaque, uint16_t ti
 
 void FileIo::Close(uint16_t timeout)
 {
-  eof_blocknumber = 0;
+  waitAsync();
+  {
+    std::lock_guard<std::mutex> lock(eof_mutex);
+    eof_blocknumber = 0;
+  }
   opened = false;
 
   Sync(timeout);
@@ -105,6 +117,8 @@ void FileIo::Close(uint16_t timeout)
 
 void FileIo::Sync(uint16_t timeout)
 {
+  /* Pending background flushes are cancelled, the cache flushes all dirty blocks of this object. */
+  kio().writeback().drop(this);
   kio().cache().flush(this);
   cluster->flush();
 }
@@ -117,8 +131,6 @@ void do_readahead(std::shared_ptr<kio::DataBlock> data)
 
 void FileIo::scheduleReadahead(int blocknumber)
 {
-  prefetchOracle.add(blocknumber);
-
   /* Adjust to cache utilization. Full force to 0.75 usage, decreasing until 0.95, then disabled. */
   size_t readahead_length = kio().readaheadWindowSize();
   auto cache_utilization = kio().cache().utilization();
@@ -130,19 +142,52 @@ void FileIo::scheduleReadahead(int blocknumber)
     readahead_length *= ((1.0 - cache_utilization) / 0.25);
   }
 
-  if (readahead_length) {
-    auto prediction = prefetchOracle.predict(readahead_length, PrefetchOracle::PredictionType::CONTINUE);
-    for (auto it = prediction.cbegin(); it != prediction.cend(); it++) {
-      if (*it < eof_blocknumber) {
-        auto data = kio().cache().getDataKey(this, *it, DataBlock::Mode::STANDARD);
-        auto scheduled = kio().threadpool().try_run(std::bind(do_readahead, data));
-        if (scheduled)
-          kio_debug("Readahead of data block #", *it);
-      }
+  /* Only the oracle is accessed under the lock, blocks are read ahead without holding it. */
+  std::list<int> prediction;
+  {
+    std::lock_guard<std::mutex> lock(readahead_mutex);
+    prefetchOracle.add(blocknumber);
+    if (readahead_length) {
+      prediction = prefetchOracle.predict(readahead_length, PrefetchOracle::PredictionType::CONTINUE);
+    }
+  }
+
+  for (auto it = prediction.cbegin(); it != prediction.cend(); it++) {
+    if (*it < eof_blocknumber) {
+      auto data = kio().cache().getDataKey(this, *it, DataBlock::Mode::STANDARD);
+      auto scheduled = kio().threadpool().try_run(std::bind(do_readahead, data));
+      if (scheduled)
+        kio_debug("Readahead of data block #", *it);
     }
   }
 }
 
+void FileIo::fetchBlocks(const std::set<int>& blocknumbers)
+{
+  std::vector<std::shared_ptr<kio::DataBlock>> blocks;
+  std::vector<std::shared_ptr<const string>> keys;
+  for (auto it = blocknumbers.cbegin(); it != blocknumbers.cend(); it++) {
+    auto data = kio().cache().getDataKey(this, *it, DataBlock::Mode::STANDARD);
+    if (data->requiresRemoteValue()) {
+      blocks.push_back(data);
+      keys.push_back(data->getKey());
+    }
+  }
+
+  /* A single block will be read in on access, no need to do anything special. */
+  if (blocks.size() < 2) {
+    return;
+  }
+
+  std::vector<std::shared_ptr<const string>> versions;
+  std::vector<std::shared_ptr<const ChunkedValue>> values;
+  auto status = cluster->multiGet(keys, versions, values);
+  for (size_t i = 0; i < blocks.size(); i++) {
+    blocks[i]->setRemoteValue(status[i], versions[i], values[i]);
+  }
+  kio_debug("Fetched ", blocks.size(), " data blocks of ", path, " concurrently.");
+}
+
 void FileIo::doFlush(std::shared_ptr<kio::DataBlock> data)
 {
   if (data->dirty()) {
@@ -157,25 +202,20 @@ void FileIo::doFlush(std::shared_ptr<kio::DataBlock> data)
   }
 }
 
-void FileIo::scheduleFlush(std::shared_ptr<kio::DataBlock> data)
-{
-  kio().threadpool().run(std::bind(&FileIo::doFlush, this, data));
-}
-
 
-int64_t FileIo::ReadWrite(long long off, char* buffer,
-                          int length, FileIo::rw mode, uint16_t timeout)
+void FileIo::throwFlushException()
 {
-  {
-    std::lock_guard<std::mutex> lock(exception_mutex);
-    if (!exceptions.empty()) {
-      auto e = exceptions.front();
-      exceptions.pop();
-      kio_warning("Re-throwing exception caught in previous async flush operation: ", e.what());
-      throw e;
-    }
+  std::lock_guard<std::mutex> lock(exception_mutex);
+  if (!exceptions.empty()) {
+    auto e = exceptions.front();
+    exceptions.pop();
+    kio_warning("Re-throwing exception caught in previous async flush operation: ", e.what());
+    throw e;
   }
+}
 
+int64_t FileIo::writeCache(long long off, const char* buffer, int length)
+{
   const size_t block_capacity = cluster->limits().max_value_size;
   size_t length_todo = static_cast<size_t>(length);
   size_t off_done = 0;
@@ -187,40 +227,80 @@ int64_t FileIo::ReadWrite(long long off, char* buffer,
 
     /* Increase last block number if we write past currently known file size...*/
     DataBlock::Mode cm = DataBlock::Mode::STANDARD;
-    if (mode == rw::WRITE && block_number > eof_blocknumber) {
-      eof_blocknumber = block_number;
+    int eof = eof_blocknumber;
+    while (block_number > eof && !eof_blocknumber.compare_exchange_weak(eof, block_number)) {
+    }
+    if (block_number > eof) {
       cm = DataBlock::Mode::CREATE;
     }
 
     auto data = kio().cache().getDataKey(this, block_number, cm);
     scheduleReadahead(block_number);
+    data->write(buffer + off_done, block_offset, block_length);
+
+    /* Blocks written to capacity are flushed in background right away, partial blocks once they expire or
+     * the amount of dirty data grows too large. Blocks that would have to be merged with the remote value are
+     * treated as partial, giving the rest of the block a chance to be written before it is flushed. */
+    bool complete = block_offset + block_length == block_capacity && !data->flushRequiresRemoteValue();
+    kio().writeback().add(this, data, complete);
+
+    length_todo -= block_length;
+    off_done += block_length;
+  }
+  return length;
+}
+
+int64_t FileIo::ReadWrite(long long off, char* buffer,
+                          int length, FileIo::rw mode, uint16_t timeout)
+{
+  throwFlushException();
+  if (mode == rw::WRITE) {
+    return writeCache(off, buffer, length);
+  }
 
-    if (mode == rw::WRITE) {
-      data->write(buffer + off_done, block_offset, block_length);
+  const size_t block_capacity = cluster->limits().max_value_size;
+  size_t length_todo = static_cast<size_t>(length);
+  size_t off_done = 0;
 
-      /* Flush data in background if writing to block capacity.*/
-      if (block_offset + block_length == block_capacity) {
-        scheduleFlush(data);
+  /* Reads spanning multiple blocks get all blocks at once, unless the cache is already under pressure. */
+  if (length > 0 && kio().cache().utilization() < 0.75) {
+    int first = static_cast<int>(off / block_capacity);
+    int last = static_cast<int>((off + length - 1) / block_capacity);
+    if (last > first) {
+      if (last > eof_blocknumber) {
+        verify_eof();
+      }
+      std::set<int> blocknumbers;
+      for (int block_number = first; block_number <= std::min(last, eof_blocknumber.load()); block_number++) {
+        blocknumbers.insert(block_number);
       }
+      fetchBlocks(blocknumbers);
     }
-    else if (mode == rw::READ) {
-      data->read(buffer + off_done, block_offset, block_length);
+  }
 
-      /* If it looks like we are reading the last block (or past it) */
-      if (block_number >= eof_blocknumber) {
+  while (length_todo) {
+    int block_number = static_cast<int>((off + off_done) / block_capacity);
+    size_t block_offset = (off + off_done) - block_number * block_capacity;
+    size_t block_length = std::min(length_todo, block_capacity - block_offset);
 
-        /* First verify that the stored last block number is still up to date. */
-        verify_eof();
-        if (block_number < eof_blocknumber) {
-          continue;
-        }
-
-        /* make sure length doesn't indicate that we read past file size. */
-        if (data->size() > block_offset) {
-          length_todo -= std::min(block_length, data->size() - block_offset);
-        }
-        break;
+    auto data = kio().cache().getDataKey(this, block_number, DataBlock::Mode::STANDARD);
+    scheduleReadahead(block_number);
+    data->read(buffer + off_done, block_offset, block_length);
+
+    /* If it looks like we are reading the last block (or past it) */
+    if (block_number >= eof_blocknumber) {
+
+      /* First verify that the stored last block number is still up to date. */
+      verify_eof();
+      if (block_number < eof_blocknumber) {
+        continue;
       }
+
+      /* make sure length doesn't indicate that we read past file size. */
+      if (data->size() > block_offset) {
+        length_todo -= std::min(block_length, data->size() - block_offset);
+      }
+      break;
     }
     length_todo -= block_length;
     off_done += block_length;
@@ -252,6 +332,263 @@ int64_t FileIo::Write(long long offset, const char* buffer,
                    FileIo::rw::WRITE, timeout);
 }
 
+int64_t FileIo::ReadV(const std::vector<IoChunk>& chunks, uint16_t timeout)
+{
+  if (!opened) {
+    kio_error("ReadV operation not permitted on non-opened object.");
+    throw std::system_error(std::make_error_code(std::errc::operation_not_permitted));
+  }
+
+  /* Group the requested chunks by data block. Blocks past the known end of the file are skipped, reading
+   * them (if they still don't exist after eof verification) will just return 0 bytes. As for multi-block reads,
+   * blocks are only fetched at once if the cache is not already under pressure. */
+  if (kio().cache().utilization() < 0.75) {
+    const size_t block_capacity = cluster->limits().max_value_size;
+    std::set<int> blocknumbers;
+    verify_eof();
+    for (auto it = chunks.cbegin(); it != chunks.cend(); it++) {
+      if (it->length <= 0) {
+        continue;
+      }
+      int first = static_cast<int>(it->offset / block_capacity);
+      int last = static_cast<int>((it->offset + it->length - 1) / block_capacity);
+      for (int block_number = first; block_number <= std::min(last, eof_blocknumber.load()); block_number++) {
+        blocknumbers.insert(block_number);
+      }
+    }
+
+    /* Fetch all blocks of the request at once, the copy pass will then be served from the cache. */
+    fetchBlocks(blocknumbers);
+  }
+
+  int64_t total = 0;
+  for (auto it = chunks.cbegin(); it != chunks.cend(); it++) {
+    total += ReadWrite(it->offset, it->buffer, it->length, FileIo::rw::READ, timeout);
+  }
+  return total;
+}
+
+int64_t FileIo::WriteV(const std::vector<IoWriteChunk>& chunks, uint16_t timeout)
+{
+  if (!opened) {
+    kio_error("WriteV operation not permitted on non-opened object.");
+    throw std::system_error(std::make_error_code(std::errc::operation_not_permitted));
+  }
+
+  int64_t total = 0;
+  for (auto it = chunks.cbegin(); it != chunks.cend(); it++) {
+    total += ReadWrite(it->offset, const_cast<char*>(it->buffer), it->length, FileIo::rw::WRITE, timeout);
+  }
+  return total;
+}
+
+struct FileIo::ReadRequest {
+  long long offset;
+  char* buffer;
+  int length;
+  uint16_t timeout;
+  IoCallback callback;
+  //! the data blocks covered by the request up to the end of the file, starting with the block containing offset
+  std::vector<std::shared_ptr<kio::DataBlock>> blocks;
+  //! true if the last covered block is the last block of the file
+  bool eof;
+  //! number of data blocks still being refreshed, plus one while blocks are being requested
+  std::atomic<int> outstanding;
+  //! set if any data block could not be refreshed
+  std::atomic<bool> failed;
+
+  ReadRequest(long long offset, char* buffer, int length, uint16_t timeout, IoCallback callback) :
+      offset(offset), buffer(buffer), length(length), timeout(timeout), callback(std::move(callback)), blocks(),
+      eof(false), outstanding(1), failed(false)
+  { }
+};
+
+void FileIo::ReadAsync(long long offset, char* buffer, int length, IoCallback callback, uint16_t timeout)
+{
+  if (!opened) {
+    kio_error("Read operation not permitted on non-opened object.");
+    IoResult result;
+    result.error = std::make_error_code(std::errc::operation_not_permitted);
+    callback(result);
+    return;
+  }
+
+  auto request = make_shared<ReadRequest>(offset, buffer, length, timeout, std::move(callback));
+
+  /* The end of the file is verified up front, so that the copy can be done from the data blocks alone. */
+  if (length > 0) {
+    const size_t block_capacity = cluster->limits().max_value_size;
+    int first = static_cast<int>(offset / block_capacity);
+    int last = static_cast<int>((offset + length - 1) / block_capacity);
+    try {
+      throwFlushException();
+      if (last >= eof_blocknumber) {
+        verify_eof();
+      }
+      int eof = eof_blocknumber;
+      request->eof = last >= eof;
+      for (int block_number = first; block_number <= std::min(last, eof); block_number++) {
+        request->blocks.push_back(kio().cache().getDataKey(this, block_number, DataBlock::Mode::STANDARD));
+      }
+    }
+    catch (const std::system_error& e) {
+      IoResult result;
+      result.error = e.code();
+      request->callback(result);
+      return;
+    }
+  }
+
+  /* Refresh all blocks at once. Blocks that are up to date complete right away, expired blocks validate their
+   * version and blocks that have never been read in are read from the backend. */
+  beginAsync();
+  for (auto it = request->blocks.cbegin(); it != request->blocks.cend(); it++) {
+    request->outstanding++;
+    (*it)->refreshAsync(std::bind(&FileIo::completeBlockRead, this, request, *it, std::placeholders::_1));
+  }
+
+  if (--request->outstanding == 0) {
+    completeRead(request);
+  }
+}
+
+void FileIo::completeBlockRead(std::shared_ptr<ReadRequest> request, std::shared_ptr<kio::DataBlock> data,
+                               const std::error_code& error)
+{
+  if (error) {
+    kio_warning("Data block ", data->getIdentity(), " could not be refreshed asynchronously: ", error.message());
+    request->failed = true;
+  }
+  if (--request->outstanding == 0) {
+    completeRead(request);
+  }
+}
+
+void FileIo::completeRead(std::shared_ptr<ReadRequest> request)
+{
+  const size_t block_capacity = cluster->limits().max_value_size;
+  size_t length_todo = static_cast<size_t>(std::max(request->length, 0));
+  size_t off_done = 0;
+
+  IoResult result;
+  if (request->failed) {
+    result.error = std::make_error_code(std::errc::io_error);
+  }
+  for (size_t i = 0; !result.error && i < request->blocks.size(); i++) {
+    size_t block_offset = (request->offset + off_done) % block_capacity;
+    size_t block_length = std::min(length_todo, block_capacity - block_offset);
+    size_t size = 0;
+    try {
+      if (!request->blocks[i]->readResident(request->buffer + off_done, block_offset, block_length, size)) {
+        kio_warning("Data block ", request->blocks[i]->getIdentity(), " could not be read asynchronously.");
+        result.error = std::make_error_code(std::errc::io_error);
+        break;
+      }
+    }
+    catch (const std::system_error& e) {
+      result.error = e.code();
+      break;
+    }
+
+    /* make sure length doesn't indicate that we read past file size. */
+    if (request->eof && i + 1 == request->blocks.size()) {
+      if (size > block_offset) {
+        off_done += std::min(block_length, size - block_offset);
+      }
+      break;
+    }
+    length_todo -= block_length;
+    off_done += block_length;
+  }
+  if (!result.error) {
+    result.bytes = off_done;
+  }
+  finishAsync(std::move(request->callback), result);
+}
+
+void FileIo::WriteAsync(long long offset, const char* buffer, int length, IoCallback callback, uint16_t timeout)
+{
+  if (!opened) {
+    kio_error("Write operation not permitted on non-opened object.");
+    IoResult result;
+    result.error = std::make_error_code(std::errc::operation_not_permitted);
+    callback(result);
+    return;
+  }
+
+  /* Written data is absorbed by the cache and flushed in background, the request completes once the data is
+   * in the cache. */
+  IoResult result;
+  try {
+    throwFlushException();
+    result.bytes = writeCache(offset, buffer, length);
+  }
+  catch (const std::system_error& e) {
+    result.error = e.code();
+  }
+  callback(result);
+}
+
+void FileIo::SyncAsync(IoCallback callback, uint16_t timeout)
+{
+  beginAsync();
+
+  /* Pending background flushes are cancelled. Flushes already in progress are not waited for, the cache is
+   * flushed once they completed. */
+  kio().writeback().dropAsync(this, std::bind(&FileIo::startCacheFlush, this, std::move(callback)));
+}
+
+void FileIo::startCacheFlush(IoCallback callback)
+{
+  /* The cache flushes all dirty blocks of this object concurrently. */
+  kio().cache().flushAsync(this, std::bind(&FileIo::completeCacheFlush, this, std::move(callback),
+                                           std::placeholders::_1));
+}
+
+void FileIo::completeCacheFlush(IoCallback callback, const std::error_code& error)
+{
+  if (error) {
+    IoResult result;
+    result.error = error;
+    finishAsync(std::move(callback), result);
+    return;
+  }
+  cluster->flushAsync(std::bind(&FileIo::completeSync, this, std::move(callback), std::placeholders::_1));
+}
+
+void FileIo::completeSync(IoCallback callback, const AsyncResult& result)
+{
+  /* As for Sync, a failed cluster flush is not reported, all data has been written at this point. */
+  if (!result.status.ok()) {
+    kio_warning("Flushing cluster for ", path, " failed: ", result.status);
+  }
+  finishAsync(std::move(callback), IoResult());
+}
+
+void FileIo::beginAsync()
+{
+  std::lock_guard<std::mutex> lock(async_mutex);
+  async_outstanding++;
+}
+
+void FileIo::finishAsync(IoCallback callback, const IoResult& result)
+{
+  {
+    std::lock_guard<std::mutex> lock(async_mutex);
+    async_outstanding--;
+    async_cv.notify_all();
+  }
+  callback(result);
+}
+
+void FileIo::waitAsync()
+{
+  std::unique_lock<std::mutex> lock(async_mutex);
+  while (async_outstanding) {
+    async_cv.wait(lock);
+  }
+}
+
 void FileIo::Truncate(long long offset, uint16_t timeout)
 {
   if (!opened) {
@@ -263,6 +600,9 @@ void FileIo::Truncate(long long offset, uint16_t timeout)
   int block_number = static_cast<int>(offset / block_capacity);
   size_t block_offset = offset - block_number * block_capacity;
 
+  /* Background flushes of blocks that are about to be dropped would race with removing them from the backend. */
+  kio().writeback().drop(this);
+
   if (offset > 0) {
     /* Step 1) truncate the block containing the offset. */
     kio().cache().getDataKey(this, block_number, DataBlock::Mode::STANDARD)->truncate(block_offset);
@@ -296,7 +636,8 @@ void FileIo::Truncate(long long offset, uint16_t timeout)
     }
   } while (keys->size() == cluster->limits().max_range_elements);
 
-  /* Set last block number */
+  /* Set last block number. Truncating replaces the file size, concurrent writes are not expected. */
+  std::lock_guard<std::mutex> lock(eof_mutex);
   eof_blocknumber = block_number;
 }
 
@@ -361,23 +702,28 @@ int FileIo::get_eof_backend()
 void FileIo::verify_eof()
 {
   using namespace std::chrono;
+  std::lock_guard<std::mutex> lock(eof_mutex);
   if (duration_cast<milliseconds>(system_clock::now() - eof_verification_time) > DataBlock::expiration_time) {
 
     eof_verification_time = std::chrono::system_clock::now();
 
+    /* Writes raise eof_blocknumber without holding the lock, it is only changed by compare and swap. */
+    int eof = eof_blocknumber;
     int backend = get_eof_backend();
-    if (backend >= eof_blocknumber) {
-      eof_blocknumber = backend;
+    while (backend > eof && !eof_blocknumber.compare_exchange_weak(eof, backend)) {
+    }
+    if (backend >= eof) {
       return;
     }
-    auto last_block = kio().cache().getDataKey(this, eof_blocknumber, DataBlock::Mode::STANDARD);
+    auto last_block = kio().cache().getDataKey(this, eof, DataBlock::Mode::STANDARD);
 
     /* un-flushed writes mean that eof_blocknumber is correct */
     if (last_block->dirty()) {
       return;
     }
     /* No un-flushed changes... re-get the block number from backend to ensure that there was no race condition */
-    eof_blocknumber = get_eof_backend();
+    backend = get_eof_backend();
+    eof_blocknumber.compare_exchange_strong(eof, backend);
   }
 }
 
@@ -410,6 +756,7 @@ std::string FileIo::attrGet(std::string name)
   /* Client may be requesting io stats instead of normal attributes */
   if (name == "sys.iostats") {
     auto stats = cluster->stats();
+    auto cache = kio().cache().statistics();
     using namespace std::chrono;
     double time = duration_cast<seconds>(stats.io_end - stats.io_start).count();
     double MB = 1024 * 1024;
@@ -421,7 +768,14 @@ std::string FileIo::attrGet(std::string name)
         ",read-mb-second=", (stats.read_bytes_period / time) / MB,
         ",read-ops-second=", stats.read_ops_period / time,
         ",write-mb-second=", (stats.write_bytes_period / time) / MB,
-        ",write-ops-second=", stats.write_ops_period / time
+        ",write-ops-second=", stats.write_ops_period / time,
+        ",bufferpool-in-use=", kio().bufferpool().inUse(),
+        ",bufferpool-cached-mb=", kio().bufferpool().cached() / MB,
+        ",cache-policy=", cache.policy == DataCache::Policy::TWO_Q ? "2Q" : "LRU",
+        ",cache-hits=", cache.hits,
+        ",cache-misses=", cache.misses,
+        ",cache-evictions=", cache.evictions,
+        ",cache-ghost-hits=", cache.ghost_hits
     );
     kio_debug(stringstats);
     return stringstats;
@@ -36,8 +36,8 @@ int finish_timed_operation(
     std::shared_ptr<kio::KineticCallback> cb
 )
 {
-  fd_set x;  int y;
-  con->Run(&x, &x, &y);
+  utility::FdSet x;  int y;
+  con->Run(x.get(), x.get(), &y);
   std::chrono::system_clock::time_point timeout_time = run_start + std::chrono::seconds(10);
   sync->wait_until(timeout_time);
   auto run_end = std::chrono::system_clock::now();
@@ -188,7 +188,7 @@ bool KineticAdminCluster::removeIndicatorKey(const std::shared_ptr<const string>
 
 bool KineticAdminCluster::scanKey(const std::shared_ptr<const string>& key, KeyCountsInternal& key_counts)
 {
-  StripeOperation_GET getV(key, true, connections, redundancy, true);
+  StripeOperation_GET getV(key, true, 0, connections, redundancy, true);
   auto rmap = getV.executeOperationVector(operation_timeout);
   auto valid_results = rmap[StatusCode::OK] + rmap[StatusCode::REMOTE_NOT_FOUND];
   auto target_version = getV.mostFrequentVersion();
@@ -221,11 +221,11 @@ bool KineticAdminCluster::scanKey(const std::shared_ptr<const string>& key, KeyC
 
 void KineticAdminCluster::repairKey(const std::shared_ptr<const string>& key, KeyCountsInternal& key_counts)
 {
-  StripeOperation_GET getOperation(key, false, connections, redundancy, true);
+  StripeOperation_GET getOperation(key, false, chunkCapacity, connections, redundancy, true);
   auto getStatus = getOperation.execute(operation_timeout);
     
   if(getStatus.ok()) { 
-    auto value = getOperation.getValue(); 
+    auto value = getOperation.getValue(chunkCapacity);
     auto version = getOperation.getVersion();
     auto stripe = this->valueToStripe(*value);
     
@@ -16,62 +16,231 @@
 #include "KineticAutoConnection.hh"
 #include "KineticIoSingleton.hh"
 #include <sstream>
+#include <algorithm>
+#include <poll.h>
 #include <Logging.hh>
 
 using namespace kinetic;
 using namespace kio;
 
-KineticAutoConnection::KineticAutoConnection(
+PooledConnection::PooledConnection(
     SocketListener& sw,
     std::pair<kinetic::ConnectionOptions, kinetic::ConnectionOptions> o,
-    std::chrono::seconds r) :
-    options(o), ratelimit(r), connection(), healthy(false), fd(0), timestamp(std::chrono::system_clock::now()),
-    mutex(), sockwatch(sw), mt(), bg(1, 0)
+    std::chrono::seconds r,
+    std::string name,
+    int p) :
+    options(o), ratelimit(r), preference(p), connection(), healthy(false), fd(0), logstring(name),
+    timestamp(std::chrono::system_clock::now()), inflight(), inflight_prune(64), mutex(), sockwatch(sw), mt(), bg(1, 0)
 {
   std::random_device rd;
   mt.seed(rd());
-  logstring = utility::Convert::toString(
-      "(", options.first.host, ":", options.first.port, " / ", options.second.host, ":", options.second.port, ")"
-  );
 }
 
-KineticAutoConnection::~KineticAutoConnection()
+PooledConnection::~PooledConnection()
 {
   if (fd) {
     sockwatch.unsubscribe(fd);
   }
 }
 
-const std::string& KineticAutoConnection::getName() const
+const std::string& PooledConnection::getName() const
 {
   return logstring;
 }
 
-void KineticAutoConnection::setError(
-    std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& errorConnection)
+void PooledConnection::prune()
+{
+  auto end = inflight.begin();
+  for (auto it = inflight.begin(); it != inflight.end(); it++) {
+    auto cb = it->lock();
+    if (cb && !cb->finished()) {
+      *end++ = *it;
+    }
+  }
+  inflight.erase(end, inflight.end());
+  inflight_prune = std::max(inflight.size() * 2, static_cast<size_t>(64));
+}
+
+void PooledConnection::track(const std::shared_ptr<KineticCallback>& callback)
 {
   std::lock_guard<std::mutex> lock(mutex);
-  if (!healthy) {
-    return;
+  inflight.push_back(callback);
+
+  /* Commands are tracked regardless of the selection policy, so that they can be failed if the connection fails.
+   * Completed commands are removed once the number of tracked commands doubled, keeping tracking amortized O(1)
+   * even if outstanding() is never called. */
+  if (inflight.size() >= inflight_prune) {
+    prune();
+  }
+}
+
+size_t PooledConnection::outstanding()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  prune();
+  return inflight.size();
+}
+
+bool PooledConnection::notify(const std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& con)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (connection != con || !healthy || !fd) {
+    return false;
+  }
+  return sockwatch.notify(fd, this);
+}
+
+bool PooledConnection::owns(const std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& con)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return connection == con;
+}
+
+KineticAutoConnection::KineticAutoConnection(
+    SocketListener& sw,
+    std::pair<kinetic::ConnectionOptions, kinetic::ConnectionOptions> o,
+    std::chrono::seconds r,
+    std::chrono::microseconds w,
+    size_t pool_size,
+    Selection s) :
+    pool(), selection(s), next(0), latency_statistics(), slow(false), batch_window(w), batch(), flushing(false),
+    batch_mutex()
+{
+  logstring = utility::Convert::toString(
+      "(", o.first.host, ":", o.first.port, " / ", o.second.host, ":", o.second.port, ")"
+  );
+
+  /* A single connection chooses the interface to prioritize at random. A pool alternates between the interfaces,
+   * so that both are used at the same time. */
+  pool_size = std::max(pool_size, static_cast<size_t>(1));
+  for (size_t i = 0; i < pool_size; i++) {
+    std::unique_ptr<PooledConnection> con(new PooledConnection(
+        sw, o, r, pool_size > 1 ? utility::Convert::toString(logstring, " #", i) : logstring,
+        pool_size > 1 ? static_cast<int>(i % 2) : -1
+    ));
+    pool.push_back(std::move(con));
+  }
+}
+
+KineticAutoConnection::~KineticAutoConnection()
+{
+}
+
+const std::string& KineticAutoConnection::getName() const
+{
+  return logstring;
+}
+
+LatencyStatistics& KineticAutoConnection::latency()
+{
+  return latency_statistics;
+}
+
+bool KineticAutoConnection::isSlow() const
+{
+  return slow;
+}
+
+void KineticAutoConnection::setSlow(bool s)
+{
+  slow = s;
+}
+
+std::chrono::microseconds KineticAutoConnection::batchWindow() const
+{
+  return batch_window;
+}
+
+void KineticAutoConnection::enqueue(const std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& con,
+                                    const std::shared_ptr<KineticCallback>& callback)
+{
+  for (auto it = pool.begin(); it != pool.end(); it++) {
+    if ((*it)->owns(con)) {
+      (*it)->track(callback);
+      break;
+    }
   }
+  std::lock_guard<std::mutex> lock(batch_mutex);
+  batch.push_back(std::make_pair(con, callback));
+}
 
-  if (connection != errorConnection) {
-    kio_debug("Disregarding setError on ", getName(), " as underlying connection does not match the connection that "
-        "showed an error. This indicates that a reconnect attempt has been succesffully completed in the meantime.");
+void KineticAutoConnection::flush()
+{
+  std::unique_lock<std::mutex> lock(batch_mutex);
+  if (flushing) {
     return;
   }
+  flushing = true;
 
-  if (fd) {
-    sockwatch.unsubscribe(fd);
-    fd = 0;
+  /* Commands queued while notifying are picked up by the next iteration. Usually all commands have been issued on the
+   * same underlying connection, they only differ if a reconnect happened in between or a pool is used. */
+  while (!batch.empty()) {
+    decltype(batch) commands;
+    commands.swap(batch);
+    lock.unlock();
+
+    std::vector<std::shared_ptr<ThreadsafeNonblockingKineticConnection>> cons;
+    for (auto it = commands.cbegin(); it != commands.cend(); it++) {
+      if (std::find(cons.begin(), cons.end(), it->first) == cons.end()) {
+        cons.push_back(it->first);
+      }
+    }
+
+    for (auto con = cons.begin(); con != cons.end(); con++) {
+      auto notified = false;
+      for (auto it = pool.begin(); it != pool.end() && !notified; it++) {
+        notified = (*it)->notify(*con);
+      }
+      if (!notified) {
+        for (auto it = commands.cbegin(); it != commands.cend(); it++) {
+          if (it->first == *con) {
+            it->second->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Connection not available."));
+          }
+        }
+        setError(*con);
+        kio_notice("Failed executing async operation for connection ", logstring);
+      }
+    }
+    lock.lock();
   }
-  kio_notice("Setting connection ", getName(), " into error state.");
-  healthy = false;
+  flushing = false;
 }
 
-std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> KineticAutoConnection::get()
+bool PooledConnection::setError(
+    std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& errorConnection)
 {
-  std::call_once(intial_connect, &KineticAutoConnection::connect, this);
+  std::vector<std::weak_ptr<KineticCallback>> failed;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (connection != errorConnection) {
+      return false;
+    }
+    if (!healthy) {
+      return true;
+    }
+
+    if (fd) {
+      sockwatch.unsubscribe(fd);
+      fd = 0;
+    }
+    kio_notice("Setting connection ", getName(), " into error state.");
+    healthy = false;
+    failed.swap(inflight);
+  }
+
+  /* Responses to commands in flight will not arrive, there is no reason to wait for them to time out. */
+  for (auto it = failed.begin(); it != failed.end(); it++) {
+    auto cb = it->lock();
+    if (cb) {
+      cb->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Connection failed."));
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> PooledConnection::get()
+{
+  std::call_once(intial_connect, &PooledConnection::connect, this);
 
   std::lock_guard<std::mutex> lock(mutex);
   if (healthy) {
@@ -82,7 +251,7 @@ std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> KineticAutoConn
   using namespace std::chrono;
   auto duration = duration_cast<seconds>(std::chrono::system_clock::now() - timestamp);
   if (duration > ratelimit) {
-    if (bg.try_run(std::bind(&KineticAutoConnection::connect, this))) {
+    if (bg.try_run(std::bind(&PooledConnection::connect, this))) {
       timestamp = std::chrono::system_clock::now();
       kio_debug(logstring, " Scheduled background reconnect. Last reconnect attempt has been scheduled ",
                 duration, " ago. ratelimit is ", ratelimit);
@@ -95,6 +264,58 @@ std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> KineticAutoConn
   throw std::system_error(std::make_error_code(std::errc::not_connected));
 }
 
+void KineticAutoConnection::setError(
+    std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>& errorConnection)
+{
+  for (auto it = pool.begin(); it != pool.end(); it++) {
+    if ((*it)->setError(errorConnection)) {
+      return;
+    }
+  }
+  kio_debug("Disregarding setError on ", getName(), " as no underlying connection matches the connection that "
+      "showed an error. This indicates that a reconnect attempt has been succesffully completed in the meantime.");
+}
+
+namespace {
+/* Order pool members by load only, equally loaded members keep their round robin order. */
+struct CompareLoad {
+  bool operator()(const std::pair<size_t, size_t>& lhs, const std::pair<size_t, size_t>& rhs) const
+  {
+    return lhs.first < rhs.first;
+  }
+};
+}
+
+std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> KineticAutoConnection::get()
+{
+  /* Pool members are attempted in order of preference, members that are not usable schedule a reconnect. */
+  std::vector<size_t> order;
+  auto start = next++;
+  for (size_t i = 0; i < pool.size(); i++) {
+    order.push_back((start + i) % pool.size());
+  }
+  if (selection == Selection::LEAST_OUTSTANDING && pool.size() > 1) {
+    std::vector<std::pair<size_t, size_t>> load;
+    for (auto it = order.cbegin(); it != order.cend(); it++) {
+      load.push_back(std::make_pair(pool[*it]->outstanding(), *it));
+    }
+    std::stable_sort(load.begin(), load.end(), CompareLoad());
+    for (size_t i = 0; i < load.size(); i++) {
+      order[i] = load[i].second;
+    }
+  }
+
+  for (auto it = order.cbegin(); it != order.cend(); it++) {
+    try {
+      return pool[*it]->get();
+    }
+    catch (const std::system_error& e) {
+      continue;
+    }
+  }
+  throw std::system_error(std::make_error_code(std::errc::not_connected));
+}
+
 namespace {
   class ConnectCallback : public kinetic::SimpleCallbackInterface {
   public:
@@ -122,14 +343,14 @@ namespace {
   };
 }
 
-void KineticAutoConnection::connect()
+void PooledConnection::connect()
 {
   kio_debug("Starting connection attempt", logstring);
 
-  /* Choose connection to prioritize at random. */
-  auto r = mt() % 2;
-  auto& primary = r ? options.first : options.second;
-  auto& secondary = r ? options.second : options.first;
+  /* Choose connection to prioritize at random unless configured. */
+  auto first = preference == 0 || (preference != 1 && mt() % 2);
+  auto& primary = first ? options.first : options.second;
+  auto& secondary = first ? options.second : options.first;
 
   auto tmpfd = 0;
   std::shared_ptr<ThreadsafeNonblockingKineticConnection> tmpcon;
@@ -141,20 +362,21 @@ void KineticAutoConnection::connect()
     /* Get the fd:
      * If Run() returns true but does not set tmpfd, another thread is still listening to the same fd and removed
      * the message. I do not quite understand how this can happen. A fix is to simply re-issue the noop request
-     * to obtain the fd. */
-    fd_set x;
+     * to obtain the fd. The fd_set is only filled in by Run(), it is sized so that fds above FD_SETSIZE fit. */
+    utility::FdSet a;
+    auto x = a.get();
     std::shared_ptr<ConnectCallback> cb;
     do {
       cb = std::make_shared<ConnectCallback>();
       tmpcon->NoOp(cb);
-    } while (tmpcon->Run(&x, &x, &tmpfd) && tmpfd == 0);
+    } while (tmpcon->Run(x, x, &tmpfd) && tmpfd == 0);
 
     /* wait on noop result to validate the connection... we don't want to add drives where the connection succeeds
      * but requests don't (e.g. drive is in locked state or has an error) */
     int y;
-    while (tmpcon->Run(&x, &x, &y) && !cb->done()) {
-      struct timeval tv{5, 0};
-      if (select(tmpfd, &x, &x, NULL, &tv) <= 0) {
+    while (tmpfd && tmpcon->Run(x, x, &y) && !cb->done()) {
+      struct pollfd pfd{tmpfd - 1, POLLIN, 0};
+      if (poll(&pfd, 1, 5000) <= 0) {
         break;
       }
     }
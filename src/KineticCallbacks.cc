@@ -14,12 +14,14 @@
  ************************************************************************/
 
 #include <KineticCallbacks.hh>
+#include <algorithm>
 
 using namespace kio;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-CallbackSynchronization::CallbackSynchronization() : outstanding(0), cv(), mutex()
+CallbackSynchronization::CallbackSynchronization() :
+    outstanding(0), received(0), cv(), listener(), versions(), version_frequency(0), mutex()
 { }
 
 CallbackSynchronization::~CallbackSynchronization()
@@ -33,6 +35,45 @@ void CallbackSynchronization::wait_until(std::chrono::system_clock::time_point t
   }
 }
 
+size_t CallbackSynchronization::wait_until(std::chrono::system_clock::time_point timeout_time, size_t last_received)
+{
+  std::unique_lock<std::mutex> lck(mutex);
+  while (outstanding && received <= last_received && std::chrono::system_clock::now() < timeout_time) {
+    cv.wait_until(lck, timeout_time);
+  }
+  return received;
+}
+
+void CallbackSynchronization::setListener(std::function<void()> l)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  listener = std::move(l);
+}
+
+size_t CallbackSynchronization::versionFrequency()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return version_frequency;
+}
+
+void CallbackSynchronization::tally(const std::string& version, bool add)
+{
+  if (add) {
+    version_frequency = std::max(version_frequency, ++versions[version]);
+    return;
+  }
+
+  /* Results are only discarded when operations are retried, so it's fine to recompute the maximum here. */
+  auto it = versions.find(version);
+  if (it != versions.end() && !--it->second) {
+    versions.erase(it);
+  }
+  version_frequency = 0;
+  for (it = versions.begin(); it != versions.end(); it++) {
+    version_frequency = std::max(version_frequency, it->second);
+  }
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -45,20 +86,46 @@ KineticCallback::KineticCallback(std::shared_ptr<CallbackSynchronization> s) :
 }
 
 KineticCallback::~KineticCallback()
-{ }
+{
+  if (counted_version) {
+    std::lock_guard<std::mutex> lock(sync->mutex);
+    sync->tally(*counted_version, false);
+  }
+}
 
 void KineticCallback::OnResult(kinetic::KineticStatus result)
+{
+  setResult(std::move(result), NULL);
+}
+
+void KineticCallback::OnResult(kinetic::KineticStatus result, const std::string& version)
+{
+  setResult(std::move(result), &version);
+}
+
+void KineticCallback::setResult(kinetic::KineticStatus result, const std::string* version)
 {
   std::unique_lock<std::mutex> lock(sync->mutex);
   if (done) {
     return;
   }
 
+  if (version && result.ok()) {
+    counted_version.reset(new std::string(*version));
+    sync->tally(*version, true);
+  }
+
   status = result;
   done = true;
+  completion_time = std::chrono::system_clock::now();
   sync->outstanding--;
-  if (!sync->outstanding) {
-    sync->cv.notify_one();
+  sync->received++;
+  sync->cv.notify_one();
+
+  if (sync->listener) {
+    auto listener = sync->listener;
+    lock.unlock();
+    listener();
   }
 }
 
@@ -74,11 +141,39 @@ bool KineticCallback::finished()
   return done;
 }
 
+std::chrono::system_clock::time_point KineticCallback::completionTime()
+{
+  std::lock_guard<std::mutex> lock(sync->mutex);
+  return completion_time;
+}
+
+OperationType KineticCallback::type()
+{
+  return OperationType::OTHER;
+}
+
+size_t KineticCallback::bytes()
+{
+  return 0;
+}
+
+size_t KineticCallback::expectedBytes()
+{
+  return bytes();
+}
+
 void KineticCallback::reset()
 {
   std::lock_guard<std::mutex> lock(sync->mutex);
+  if (!done) {
+    return;
+  }
   done = false;
   status = kinetic::KineticStatus(kinetic::StatusCode::CLIENT_INTERNAL_ERROR, "no result");
+  if (counted_version) {
+    sync->tally(*counted_version, false);
+    counted_version.reset();
+  }
   sync->outstanding++;
 }
 
@@ -86,7 +181,8 @@ void KineticCallback::reset()
 
 using namespace kinetic;
 
-GetCallback::GetCallback(std::shared_ptr<CallbackSynchronization> s) : KineticCallback(std::move(s))
+GetCallback::GetCallback(std::shared_ptr<CallbackSynchronization> s, size_t expected_size) :
+    KineticCallback(std::move(s)), record(), expected_size(expected_size)
 { }
 
 GetCallback::~GetCallback()
@@ -95,7 +191,7 @@ GetCallback::~GetCallback()
 void GetCallback::Success(const std::string& key, std::unique_ptr<kinetic::KineticRecord> r)
 {
   record = std::move(r);
-  OnResult(KineticStatus(StatusCode::OK, ""));
+  OnResult(KineticStatus(StatusCode::OK, ""), record && record->version() ? *record->version() : std::string());
 }
 
 void GetCallback::Failure(KineticStatus error)
@@ -108,6 +204,21 @@ std::shared_ptr<KineticRecord>& GetCallback::getRecord()
   return record;
 }
 
+OperationType GetCallback::type()
+{
+  return OperationType::READ;
+}
+
+size_t GetCallback::bytes()
+{
+  return record && record->value() ? record->value()->size() : 0;
+}
+
+size_t GetCallback::expectedBytes()
+{
+  return expected_size;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 GetVersionCallback::GetVersionCallback(std::shared_ptr<CallbackSynchronization> s) : KineticCallback(std::move(s))
@@ -119,7 +230,7 @@ GetVersionCallback::~GetVersionCallback()
 void GetVersionCallback::Success(const std::string& v)
 {
   version = v;
-  OnResult(KineticStatus(StatusCode::OK, ""));
+  OnResult(KineticStatus(StatusCode::OK, ""), version);
 }
 
 void GetVersionCallback::Failure(KineticStatus error)
@@ -132,6 +243,11 @@ const std::string& GetVersionCallback::getVersion()
   return version;
 }
 
+OperationType GetVersionCallback::type()
+{
+  return OperationType::READ;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 GetLogCallback::GetLogCallback(std::shared_ptr<CallbackSynchronization> s) : KineticCallback(std::move(s))
@@ -158,7 +274,8 @@ shared_ptr<DriveLog>& GetLogCallback::getLog()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-PutCallback::PutCallback(std::shared_ptr<CallbackSynchronization> s) : KineticCallback(std::move(s))
+PutCallback::PutCallback(std::shared_ptr<CallbackSynchronization> s, size_t value_size) :
+    KineticCallback(std::move(s)), value_size(value_size)
 { }
 
 PutCallback::~PutCallback()
@@ -174,6 +291,16 @@ void PutCallback::Failure(KineticStatus error)
   OnResult(error);
 }
 
+OperationType PutCallback::type()
+{
+  return OperationType::WRITE;
+}
+
+size_t PutCallback::bytes()
+{
+  return value_size;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 BasicCallback::BasicCallback(std::shared_ptr<CallbackSynchronization> s) : KineticCallback(std::move(s))
@@ -192,6 +319,11 @@ void BasicCallback::Failure(KineticStatus error)
   OnResult(error);
 }
 
+OperationType BasicCallback::type()
+{
+  return OperationType::WRITE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 RangeCallback::RangeCallback(std::shared_ptr<CallbackSynchronization> s) : KineticCallback(std::move(s))
@@ -16,6 +16,8 @@
 #include "KineticCluster.hh"
 #include "Utility.hh"
 #include <set>
+#include <algorithm>
+#include <cstring>
 #include <unistd.h>
 #include "Logging.hh"
 #include "KineticIoSingleton.hh"
@@ -26,12 +28,60 @@ using std::string;
 using namespace kinetic;
 using namespace kio;
 
+namespace {
+/* Interval in which the stripe version is checked for concurrent writes if a get operation read a mix of chunks. */
+const std::chrono::milliseconds concurrency_check_interval(200);
+}
+
+struct KineticCluster::GetRequest {
+  std::shared_ptr<const std::string> key;
+  bool skip_value;
+  StripeOperation_GET op;
+  std::chrono::system_clock::time_point timeout_time;
+
+  GetRequest(const std::shared_ptr<const std::string>& k, bool skip, std::size_t chunk_size,
+             std::vector<std::unique_ptr<KineticAutoConnection>>& connections,
+             std::shared_ptr<RedundancyProvider>& redundancy) :
+      key(k), skip_value(skip), op(key, skip, chunk_size, connections, redundancy), timeout_time()
+  { }
+};
+
+struct KineticCluster::PutRequest {
+  std::shared_ptr<const std::string> key;
+  std::shared_ptr<const std::string> version_new;
+  std::vector<std::shared_ptr<const std::string>> stripe;
+  StripeOperation_PUT op;
+
+  PutRequest(const std::shared_ptr<const std::string>& k, const std::shared_ptr<const std::string>& v_new,
+             const std::shared_ptr<const std::string>& v_old, std::vector<std::shared_ptr<const std::string>> s,
+             WriteMode mode, std::vector<std::unique_ptr<KineticAutoConnection>>& connections,
+             std::shared_ptr<RedundancyProvider>& redundancy) :
+      key(k), version_new(v_new), stripe(std::move(s)), op(key, version_new, v_old, stripe, mode, connections, redundancy)
+  { }
+};
+
+struct KineticCluster::RemoveRequest {
+  std::shared_ptr<const std::string> key;
+  std::shared_ptr<const std::string> version;
+  StripeOperation_DEL op;
+
+  RemoveRequest(const std::shared_ptr<const std::string>& k, const std::shared_ptr<const std::string>& v,
+                WriteMode mode, std::vector<std::unique_ptr<KineticAutoConnection>>& connections,
+                std::shared_ptr<RedundancyProvider>& redundancy) :
+      key(k), version(v), op(key, version, mode, connections, redundancy, redundancy->size())
+  { }
+};
+
 KineticCluster::KineticCluster(
     std::string id, std::size_t block_size, std::chrono::seconds op_timeout,
     std::vector<std::unique_ptr<KineticAutoConnection>> cons,
-    std::shared_ptr<RedundancyProvider> rp
+    std::shared_ptr<RedundancyProvider> rp,
+    std::size_t hedge_percentile, std::size_t completion_threads, std::size_t completion_queue_depth
 ) : identity(id), instanceIdentity(utility::uuidGenerateString()), chunkCapacity(block_size),
-    operation_timeout(op_timeout), connections(std::move(cons)), redundancy(rp), dmutex(std::make_shared<DestructionMutex>())
+    zeroChunk(std::make_shared<const string>(block_size, '\0')), operation_timeout(op_timeout), connections(std::move(cons)), redundancy(rp),
+    hedge_percentile(std::min(hedge_percentile, static_cast<std::size_t>(100))),
+    hedge_delay(std::chrono::microseconds::zero()), latencies_updated(), dmutex(std::make_shared<DestructionMutex>()),
+    completions(completion_threads, completion_queue_depth)
 {
 
   /* Attempt to get cluster limits from _any_ drive in the cluster */
@@ -50,6 +100,8 @@ KineticCluster::KineticCluster(
       cluster_limits.max_key_size = l.max_key_size;
       cluster_limits.max_version_size = l.max_version_size;
       cluster_limits.max_value_size = block_size * redundancy->numData();
+      cluster_limits.chunk_size = block_size;
+      cluster_limits.parity_size = redundancy->numData() > 1 ? block_size * redundancy->numParity() : 0;
       break;
     }
     if (off == connections.size()) {
@@ -96,17 +148,46 @@ ClusterStats KineticCluster::stats()
     statistics_scheduled = system_clock::now();
     kio_debug("Scheduled statistics update for cluster ", id());
   }
-  return statistics_snapshot;
+
+  /* Latency statistics are kept up to date by the connections and do not require a background update. */
+  auto stats = statistics_snapshot;
+  stats.drive_latency.clear();
+  for (auto it = connections.cbegin(); it != connections.cend(); it++) {
+    stats.drive_latency.push_back(ClusterStats::DriveLatency{
+        (*it)->getName(), (*it)->isSlow(), (*it)->latency().get()
+    });
+  }
+  stats.hedge_delay = hedge_delay;
+  return stats;
 }
 
-KineticStatus KineticCluster::flush()
+KineticStatus KineticCluster::executeFlush(ClusterFlushOp& flushop)
 {
-  ClusterFlushOp flushOp(connections);
-  auto status = flushOp.execute(operation_timeout, connections.size() - redundancy->numParity());
+  auto status = flushop.execute(operation_timeout, connections.size() - redundancy->numParity());
   kio_debug("Flush request for cluster ", id(), "completed with status ", status);
   return status;
 }
 
+KineticStatus KineticCluster::flush()
+{
+  ClusterFlushOp flushOp(connections);
+  return executeFlush(flushOp);
+}
+
+void KineticCluster::flushAsync(AsyncCallback callback)
+{
+  auto flushop = std::make_shared<ClusterFlushOp>(connections);
+  flushop->submit(connections.size() - redundancy->numParity());
+  completions.add(flushop, std::chrono::system_clock::now() + operation_timeout,
+                  std::chrono::system_clock::time_point::max(),
+                  std::bind(&KineticCluster::completeFlush, this, flushop, callback));
+}
+
+void KineticCluster::completeFlush(std::shared_ptr<ClusterFlushOp> flushop, AsyncCallback callback)
+{
+  callback(AsyncResult(executeFlush(*flushop)));
+}
+
 KineticStatus KineticCluster::range(const std::shared_ptr<const std::string>& start_key,
                                     const std::shared_ptr<const std::string>& end_key,
                                     std::unique_ptr<std::vector<std::string>>& keys, size_t max_elements)
@@ -120,15 +201,49 @@ KineticStatus KineticCluster::range(const std::shared_ptr<const std::string>& st
   }
 
   ClusterRangeOp rangeop(start_key, end_key, max_elements, connections);
+  auto status = executeRange(rangeop, keys);
+  kio_debug("Range request from key ", *start_key, " to ", *end_key, " completed with status: ", status);
+  return status;
+}
 
+KineticStatus KineticCluster::executeRange(ClusterRangeOp& rangeop, std::unique_ptr<std::vector<std::string>>& keys)
+{
   auto status = rangeop.execute(operation_timeout, connections.size() - redundancy->numParity());
   if (status.ok()) {
     rangeop.getKeys(keys);
   }
-  kio_debug("Range request from key ", *start_key, " to ", *end_key, " completed with status: ", status);
   return status;
 }
 
+void KineticCluster::rangeAsync(const std::shared_ptr<const std::string>& start_key,
+                                const std::shared_ptr<const std::string>& end_key,
+                                std::size_t max_elements, AsyncCallback callback)
+{
+  if (!start_key || !end_key) {
+    callback(AsyncResult(KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.")));
+    return;
+  }
+
+  if (!max_elements) {
+    max_elements = cluster_limits.max_range_elements;
+  }
+
+  auto rangeop = std::make_shared<ClusterRangeOp>(start_key, end_key, max_elements, connections);
+  rangeop->submitOperationVector();
+  completions.add(rangeop, std::chrono::system_clock::now() + operation_timeout,
+                  std::chrono::system_clock::time_point::max(),
+                  std::bind(&KineticCluster::completeRange, this, rangeop, callback));
+}
+
+void KineticCluster::completeRange(std::shared_ptr<ClusterRangeOp> rangeop, AsyncCallback callback)
+{
+  std::unique_ptr<std::vector<std::string>> keys;
+  AsyncResult result(executeRange(*rangeop, keys));
+  result.keys = std::move(keys);
+  kio_debug("Asynchronous range request completed with status: ", result.status);
+  callback(result);
+}
+
 KineticStatus KineticCluster::do_remove(const std::shared_ptr<const std::string>& key,
                                         const std::shared_ptr<const std::string>& version,
                                         WriteMode wmode)
@@ -137,15 +252,65 @@ KineticStatus KineticCluster::do_remove(const std::shared_ptr<const std::string>
     return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.");
   }
 
-  StripeOperation_DEL delOp(key, version, wmode, connections, redundancy, redundancy->size());
-  auto status = delOp.execute(operation_timeout);
-  if (delOp.needsIndicator()) {
-    delOp.putIndicatorKey();
+  RemoveRequest request(key, version, wmode, connections, redundancy);
+  return executeRemove(request);
+}
+
+KineticStatus KineticCluster::executeRemove(RemoveRequest& request)
+{
+  auto status = request.op.execute(operation_timeout);
+  if (request.op.needsIndicator()) {
+    request.op.putIndicatorKey();
   }
-  kio_debug("Remove request of key ", *key, " completed with status: ", status);
+  kio_debug("Remove request of key ", *request.key, " completed with status: ", status);
   return status;
 }
 
+void KineticCluster::do_removeAsync(const std::shared_ptr<const std::string>& key,
+                                    const std::shared_ptr<const std::string>& version,
+                                    WriteMode wmode, AsyncCallback callback)
+{
+  if (!key || !version) {
+    callback(AsyncResult(KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.")));
+    return;
+  }
+
+  auto request = std::make_shared<RemoveRequest>(key, version, wmode, connections, redundancy);
+  request->op.deferFlush(std::bind(&CompletionQueue::schedule, &completions, std::placeholders::_1,
+                                   std::placeholders::_2));
+  request->op.submitOperationVector();
+  completions.add(std::shared_ptr<KineticClusterOperation>(request, &request->op),
+                  std::chrono::system_clock::now() + operation_timeout,
+                  std::chrono::system_clock::time_point::max(),
+                  std::bind(&KineticCluster::completeRemove, this, request, callback));
+}
+
+void KineticCluster::completeRemove(std::shared_ptr<RemoveRequest> request, AsyncCallback callback)
+{
+  if (request->op.needsResolution()) {
+    completions.offload(std::bind(&KineticCluster::finishRemove, this, request, callback));
+    return;
+  }
+  finishRemove(request, callback);
+}
+
+void KineticCluster::finishRemove(std::shared_ptr<RemoveRequest> request, AsyncCallback callback)
+{
+  callback(AsyncResult(executeRemove(*request)));
+}
+
+void KineticCluster::removeAsync(const std::shared_ptr<const std::string>& key, AsyncCallback callback)
+{
+  do_removeAsync(key, make_shared<const string>(), WriteMode::IGNORE_VERSION, callback);
+}
+
+void KineticCluster::removeAsync(const std::shared_ptr<const std::string>& key,
+                                 const std::shared_ptr<const std::string>& version,
+                                 AsyncCallback callback)
+{
+  do_removeAsync(key, version, WriteMode::REQUIRE_SAME_VERSION, callback);
+}
+
 KineticStatus KineticCluster::remove(const std::shared_ptr<const std::string>& key)
 {
   return do_remove(key, make_shared<const string>(), WriteMode::IGNORE_VERSION);
@@ -159,39 +324,106 @@ KineticStatus KineticCluster::remove(const std::shared_ptr<const std::string>& k
 
 std::vector<std::shared_ptr<const std::string>> KineticCluster::valueToStripe(const std::string& value)
 {
-  if (!value.length()) {
+  return valueToStripe(ChunkedValue(chunkCapacity, value));
+}
+
+std::vector<std::shared_ptr<const std::string>> KineticCluster::valueToStripe(const ChunkedValue& value)
+{
+  if (!value.size()) {
     return std::vector<std::shared_ptr<const string>>(redundancy->size(), std::make_shared<const string>());
   }
 
   std::vector<std::shared_ptr<const string>> stripe;
+  const auto& chunks = value.chunks();
+  const auto chunkSize = value.size() < chunkCapacity ? value.size() : chunkCapacity;
+  const auto numChunks = (value.size() + chunkSize - 1) / chunkSize;
+  const auto numData = redundancy->numData();
+  const auto numParity = redundancy->numParity();
+
+  /* Use value chunks as data chunks of the stripe if they are laid out as required, copy them otherwise. */
+  bool shared = true;
+  for (size_t i = 0; i < numChunks; i++) {
+    if (value.chunkCapacity() == chunkCapacity && i < chunks.size() && chunks[i] && chunks[i]->size() == chunkSize) {
+      stripe.push_back(chunks[i]);
+    }
+    else {
+      auto chunk = kio().bufferpool().get(chunkSize);
+      value.read(&(*chunk)[0], i * chunkSize, std::min(chunkSize, value.size() - i * chunkSize));
+      stripe.push_back(chunk);
+      shared = false;
+    }
+  }
 
-  auto chunkSize = value.length() < chunkCapacity ? value.length() : chunkCapacity;
-  std::shared_ptr<std::string> zero;
+  /* If value < stripe size, fill in with 0ed chunks. */
+  auto zero = chunkSize == chunkCapacity ? zeroChunk : std::make_shared<const string>(chunkSize, '\0');
+  for (size_t i = numChunks; i < numData; i++) {
+    stripe.push_back(zero);
+  }
 
-  /* Set data chunks of the stripe. If value < stripe size, fill in with 0ed strings. */
-  for (size_t i = 0; i < redundancy->numData(); i++) {
-    if (i * chunkSize < value.length()) {
-      auto chunk = std::make_shared<string>(value.substr(i * chunkSize, chunkSize));
-      chunk->resize(chunkSize);
-      stripe.push_back(chunk);
+  /* Compute redundancy. Replicas share the data chunk, parities are encoded straight into pooled buffers. */
+  if (numData == 1) {
+    for (size_t i = 0; i < numParity; i++) {
+      stripe.push_back(stripe.front());
     }
-    else {
-      if (!zero) {
-        zero = make_shared<string>();
-        zero->resize(chunkSize);
+    return stripe;
+  }
+
+  /* Data chunks that differ from the ones the value has last been written with have been modified since. */
+  auto previous = value.encoding();
+  std::vector<size_t> changed;
+  if (previous && previous->data.size() == numData && previous->parity.size() == numParity &&
+      numParity && previous->parity.front()->size() == chunkSize) {
+    for (size_t i = 0; i < numData; i++) {
+      if (stripe[i] != previous->data[i]) {
+        changed.push_back(i);
       }
-      stripe.push_back(zero);
     }
   }
-  /* Set empty strings for parities */
-  for (size_t i = 0; i < redundancy->numParity(); i++) {
-    stripe.push_back(std::make_shared<const string>());
+  else {
+    previous.reset();
+  }
+
+  std::vector<unsigned char*> blocks;
+  std::vector<bool> missing(redundancy->size(), false);
+  for (auto it = stripe.cbegin(); it != stripe.cend(); it++) {
+    blocks.push_back((unsigned char*) (*it)->data());
+  }
+  for (size_t i = 0; i < numParity; i++) {
+    auto parity = kio().bufferpool().get(chunkSize);
+    blocks.push_back(reinterpret_cast<unsigned char*>(&(*parity)[0]));
+    missing[numData + i] = true;
+    stripe.push_back(parity);
+  }
+
+  /* A small overwrite only modifies few data chunks. Updating the previous parities with the difference of each
+   * modified chunk then is a lot cheaper than encoding the complete stripe again. */
+  if (previous && 2 * changed.size() < numData) {
+    std::vector<unsigned char*> parities(blocks.begin() + numData, blocks.end());
+    for (size_t i = 0; i < numParity; i++) {
+      memcpy(parities[i], previous->parity[i]->data(), chunkSize);
+    }
+    for (auto it = changed.cbegin(); it != changed.cend(); it++) {
+      redundancy->update(*it, (const unsigned char*) previous->data[*it]->data(), blocks[*it], parities, chunkSize);
+    }
+  }
+  else {
+    redundancy->compute(blocks, missing, chunkSize);
+  }
+
+  /* Remember the encoding if the data chunks are shared with the value, so that they will still be identical
+   * on the next write if they are not modified in the meantime. */
+  if (shared && numParity) {
+    auto encoding = std::make_shared<ChunkedValue::Encoding>();
+    encoding->data.assign(stripe.begin(), stripe.begin() + numData);
+    encoding->parity.assign(stripe.begin() + numData, stripe.end());
+    value.setEncoding(encoding);
+  }
+  else {
+    value.setEncoding(std::shared_ptr<const ChunkedValue::Encoding>());
   }
-  /* Compute redundancy */
-  redundancy->compute(stripe);
 
   /* We don't actually want to write the 0ed data chunks used for redundancy computation. So get rid of them. */
-  for (size_t index = (value.size() + chunkSize - 1) / chunkSize; index < redundancy->numData(); index++) {
+  for (size_t index = numChunks; index < numData; index++) {
     stripe[index] = std::make_shared<const string>();
   }
 
@@ -199,62 +431,178 @@ std::vector<std::shared_ptr<const std::string>> KineticCluster::valueToStripe(co
 }
 
 
-KineticStatus KineticCluster::do_put(const std::shared_ptr<const std::string>& key,
-                                     const std::shared_ptr<const std::string>& version,
-                                     const std::shared_ptr<const std::string>& value,
-                                     std::shared_ptr<const std::string>& version_out,
-                                     kinetic::WriteMode mode)
+KineticStatus KineticCluster::preparePut(const std::shared_ptr<const std::string>& key,
+                                         const std::shared_ptr<const std::string>& version,
+                                         const ChunkedValue& value,
+                                         kinetic::WriteMode mode,
+                                         std::shared_ptr<PutRequest>& request)
 {
-  if (!key || !version || !value) {
+  if (!key || !version) {
     return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.");
   }
 
   /* Compute Stripe */
   std::vector<std::shared_ptr<const string>> stripe;
   try {
-    stripe = valueToStripe(*value);
+    stripe = valueToStripe(value);
   } catch (const std::exception& e) {
     kio_error("Failed building data stripe for key ", *key, ": ", e.what());
     return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, e.what());
   }
 
-  /* Do not use version_out variable directly in case the client uses the same pointer for version and version_out. */
-  auto version_new = utility::uuidGenerateEncodeSize(value->size());
-
-  StripeOperation_PUT putOp(key, version_new, version, stripe, mode, connections, redundancy);
+  /* The new version is kept in the request rather than the version_out variable in case the client uses the same
+   * pointer for version and version_out. */
+  request = std::make_shared<PutRequest>(key, utility::uuidGenerateEncodeSize(value.size()), version,
+                                         std::move(stripe), mode, connections, redundancy);
+  return KineticStatus(StatusCode::OK, "");
+}
 
-  auto status = putOp.execute(operation_timeout);
-  if (putOp.needsIndicator()) {
-    putOp.putIndicatorKey();
-    putOp.putHandoffKeys();
+KineticStatus KineticCluster::executePut(PutRequest& request, std::shared_ptr<const std::string>& version_out)
+{
+  auto status = request.op.execute(operation_timeout);
+  if (request.op.needsIndicator()) {
+    request.op.putIndicatorKey();
+    request.op.putHandoffKeys();
   }
   if (status.ok()) {
-    version_out = version_new;
+    version_out = request.version_new;
   }
   return status;
 }
 
+KineticStatus KineticCluster::do_put(const std::shared_ptr<const std::string>& key,
+                                     const std::shared_ptr<const std::string>& version,
+                                     const ChunkedValue& value,
+                                     std::shared_ptr<const std::string>& version_out,
+                                     kinetic::WriteMode mode)
+{
+  std::shared_ptr<PutRequest> request;
+  auto status = preparePut(key, version, value, mode, request);
+  if (!status.ok()) {
+    return status;
+  }
+  return executePut(*request, version_out);
+}
+
+void KineticCluster::do_putAsync(const std::shared_ptr<const std::string>& key,
+                                 const std::shared_ptr<const std::string>& version,
+                                 const ChunkedValue& value,
+                                 kinetic::WriteMode mode,
+                                 AsyncCallback callback)
+{
+  std::shared_ptr<PutRequest> request;
+  auto status = preparePut(key, version, value, mode, request);
+  if (!status.ok()) {
+    callback(AsyncResult(status));
+    return;
+  }
+  request->op.deferFlush(std::bind(&CompletionQueue::schedule, &completions, std::placeholders::_1,
+                                   std::placeholders::_2));
+  request->op.submitOperationVector();
+  completions.add(std::shared_ptr<KineticClusterOperation>(request, &request->op),
+                  std::chrono::system_clock::now() + operation_timeout,
+                  std::chrono::system_clock::time_point::max(),
+                  std::bind(&KineticCluster::completePut, this, request, callback));
+}
+
+void KineticCluster::completePut(std::shared_ptr<PutRequest> request, AsyncCallback callback)
+{
+  /* Resolving a partial write or placing indicator and handoff keys blocks, which must not hold up completions. */
+  if (request->op.needsResolution()) {
+    completions.offload(std::bind(&KineticCluster::finishPut, this, request, callback));
+    return;
+  }
+  finishPut(request, callback);
+}
+
+void KineticCluster::finishPut(std::shared_ptr<PutRequest> request, AsyncCallback callback)
+{
+  std::shared_ptr<const std::string> version_out;
+  AsyncResult result(executePut(*request, version_out));
+  result.version = version_out;
+  kio_debug("Asynchronous put request for key ", *request->key, " completed with status: ", result.status);
+  callback(result);
+}
+
+void KineticCluster::putAsync(const std::shared_ptr<const std::string>& key,
+                              const std::shared_ptr<const ChunkedValue>& value,
+                              AsyncCallback callback)
+{
+  if (!value) {
+    callback(AsyncResult(KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.")));
+    return;
+  }
+  do_putAsync(key, make_shared<const string>(), *value, WriteMode::IGNORE_VERSION, callback);
+}
+
+void KineticCluster::putAsync(const std::shared_ptr<const std::string>& key,
+                              const std::shared_ptr<const std::string>& version,
+                              const std::shared_ptr<const ChunkedValue>& value,
+                              AsyncCallback callback)
+{
+  if (!value) {
+    callback(AsyncResult(KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.")));
+    return;
+  }
+  do_putAsync(key, version ? version : make_shared<const string>(), *value, WriteMode::REQUIRE_SAME_VERSION,
+              callback);
+}
+
 kinetic::KineticStatus KineticCluster::put(const std::shared_ptr<const std::string>& key,
                                            const std::shared_ptr<const std::string>& value,
                                            std::shared_ptr<const std::string>& version_out)
 {
-  auto status = do_put(key, make_shared<const string>(), value, version_out, WriteMode::IGNORE_VERSION);
+  if (!value) {
+    return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.");
+  }
+  auto status = do_put(key, make_shared<const string>(), ChunkedValue(chunkCapacity, *value), version_out,
+                       WriteMode::IGNORE_VERSION);
   kio_debug("Forced put request for key ", *key, " completed with status: ", status);
   return status;
 }
 
+kinetic::KineticStatus KineticCluster::put(const std::shared_ptr<const std::string>& key,
+                                           const std::shared_ptr<const ChunkedValue>& value,
+                                           std::shared_ptr<const std::string>& version_out)
+{
+  if (!value) {
+    return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.");
+  }
+  auto status = do_put(key, make_shared<const string>(), *value, version_out, WriteMode::IGNORE_VERSION);
+  kio_debug("Forced chunked put request for key ", *key, " completed with status: ", status);
+  return status;
+}
+
 kinetic::KineticStatus KineticCluster::put(const std::shared_ptr<const std::string>& key,
                                            const std::shared_ptr<const std::string>& version,
                                            const std::shared_ptr<const std::string>& value,
                                            std::shared_ptr<const std::string>& version_out)
 {
+  if (!value) {
+    return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.");
+  }
   auto status = do_put(key, version ? version : make_shared<const string>(), 
-          value, version_out, WriteMode::REQUIRE_SAME_VERSION);
+          ChunkedValue(chunkCapacity, *value), version_out, WriteMode::REQUIRE_SAME_VERSION);
   
   kio_debug("Versioned put request for key ", *key, " completed with status: ", status);
   return status;
 }
 
+kinetic::KineticStatus KineticCluster::put(const std::shared_ptr<const std::string>& key,
+                                           const std::shared_ptr<const std::string>& version,
+                                           const std::shared_ptr<const ChunkedValue>& value,
+                                           std::shared_ptr<const std::string>& version_out)
+{
+  if (!value) {
+    return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input.");
+  }
+  auto status = do_put(key, version ? version : make_shared<const string>(),
+                       *value, version_out, WriteMode::REQUIRE_SAME_VERSION);
+
+  kio_debug("Versioned chunked put request for key ", *key, " completed with status: ", status);
+  return status;
+}
+
 bool operator==(const StripeOperation_GET::VersionCount& lhs, const StripeOperation_GET::VersionCount& rhs)
 {
   if (lhs.frequency != rhs.frequency)
@@ -276,14 +624,76 @@ bool operator!=(const StripeOperation_GET::VersionCount& lhs, const StripeOperat
 
 kinetic::KineticStatus KineticCluster::do_get(const std::shared_ptr<const std::string>& key,
                                               std::shared_ptr<const std::string>& version,
-                                              std::shared_ptr<const std::string>& value, bool skip_value)
+                                              std::shared_ptr<const ChunkedValue>& value, bool skip_value)
 {
   if (!key) {
     return KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input, key has to be supplied.");;
   }
-  StripeOperation_GET getop(key, skip_value, connections, redundancy);
+  StripeOperation_GET getop(key, skip_value, chunkCapacity, connections, redundancy);
+  return do_get(getop, key, version, value, skip_value);
+}
+
+void KineticCluster::updateLatencies()
+{
+  /* A drive is considered slow if its average read latency exceeds the cluster median by this factor. */
+  const int slow_factor = 4;
+
+  auto size = chunkCapacity >= LatencyStatistics::large_value_size ? SizeClass::LARGE : SizeClass::SMALL;
+  std::vector<std::chrono::microseconds> percentiles;
+  std::vector<std::chrono::microseconds> averages;
+  for (auto it = connections.begin(); it != connections.end(); it++) {
+    auto stats = (*it)->latency().get(OperationType::READ, size);
+    if (stats.samples >= LatencyStatistics::min_samples) {
+      averages.push_back(stats.ewma);
+      if (hedge_percentile) {
+        percentiles.push_back((*it)->latency().percentile(OperationType::READ, size, hedge_percentile));
+      }
+    }
+  }
+
+  /* Drives without sufficient statistics are ignored. Hedged reads start once most drives have been read from
+   * often enough for the delay to be meaningful. */
+  hedge_delay = std::chrono::microseconds::zero();
+  if (percentiles.size() > connections.size() / 2) {
+    std::nth_element(percentiles.begin(), percentiles.begin() + percentiles.size() / 2, percentiles.end());
+    hedge_delay = percentiles[percentiles.size() / 2];
+  }
+
+  auto median = std::chrono::microseconds::zero();
+  if (averages.size() > connections.size() / 2) {
+    std::nth_element(averages.begin(), averages.begin() + averages.size() / 2, averages.end());
+    median = averages[averages.size() / 2];
+  }
+  for (auto it = connections.begin(); it != connections.end(); it++) {
+    auto stats = (*it)->latency().get(OperationType::READ, size);
+    auto slow = median > std::chrono::microseconds::zero() && stats.samples >= LatencyStatistics::min_samples &&
+                stats.ewma > median * slow_factor;
+    if (slow != (*it)->isSlow()) {
+      kio_notice("Drive ", (*it)->getName(), slow ? " is" : " is no longer", " considered slow, average read latency ",
+                 stats.ewma.count(), "us, cluster median ", median.count(), "us");
+      (*it)->setSlow(slow);
+    }
+  }
+}
+
+std::chrono::microseconds KineticCluster::hedgeDelay()
+{
+  std::lock_guard<std::mutex> lock(mutex);
 
-  auto status = getop.execute(operation_timeout);
+  auto now = std::chrono::system_clock::now();
+  if (now - latencies_updated > std::chrono::seconds(1)) {
+    updateLatencies();
+    latencies_updated = now;
+  }
+  return hedge_delay;
+}
+
+kinetic::KineticStatus KineticCluster::do_get(StripeOperation_GET& getop,
+                                              const std::shared_ptr<const std::string>& key,
+                                              std::shared_ptr<const std::string>& version,
+                                              std::shared_ptr<const ChunkedValue>& value, bool skip_value)
+{
+  auto status = skip_value ? getop.execute(operation_timeout) : getop.execute(operation_timeout, hedgeDelay());
 
   if (status.statusCode() == StatusCode::CLIENT_IO_ERROR && getop.mostFrequentVersion().frequency) {
     /* If other clients are writing concurrently, we could have read in a mix of chunks. We do not want to return IO
@@ -291,8 +701,8 @@ kinetic::KineticStatus KineticCluster::do_get(const std::shared_ptr<const std::s
      * Let's see if there are changes to the stripe version before the configured timeout time. */
     auto start_time = std::chrono::system_clock::now();
     do {
-      usleep(200 * 1000);
-      StripeOperation_GET getop_concurrency_check(key, skip_value, connections, redundancy);
+      std::this_thread::sleep_for(concurrency_check_interval);
+      StripeOperation_GET getop_concurrency_check(key, skip_value, chunkCapacity, connections, redundancy);
       getop_concurrency_check.execute(operation_timeout);
       if (getop.mostFrequentVersion() != getop_concurrency_check.mostFrequentVersion()) {
         kio_warning("Concurrent write detected. Re-starting get operation for key ", *key, ".");
@@ -302,9 +712,19 @@ kinetic::KineticStatus KineticCluster::do_get(const std::shared_ptr<const std::s
     kio_warning("No concurrent write: Both pre and post timeout most frequent version is ",
                 *getop.mostFrequentVersion().version);
   }
+  return finishGet(getop, status, key, version, value, skip_value);
+}
 
+kinetic::KineticStatus KineticCluster::finishGet(StripeOperation_GET& getop,
+                                                 const kinetic::KineticStatus& status,
+                                                 const std::shared_ptr<const std::string>& key,
+                                                 std::shared_ptr<const std::string>& version,
+                                                 std::shared_ptr<const ChunkedValue>& value, bool skip_value)
+{
   if (status.ok()) {
-    value = getop.getValue();
+    if (!skip_value) {
+      value = getop.getValue(chunkCapacity);
+    }
     version = getop.getVersion();
     kio_debug("status ok for key ", *key, " version is ", *version);
   }
@@ -314,10 +734,45 @@ kinetic::KineticStatus KineticCluster::do_get(const std::shared_ptr<const std::s
   return status;
 }
 
+std::vector<kinetic::KineticStatus> KineticCluster::multiGet(
+    const std::vector<std::shared_ptr<const std::string>>& keys,
+    std::vector<std::shared_ptr<const std::string>>& versions,
+    std::vector<std::shared_ptr<const ChunkedValue>>& values)
+{
+  versions.assign(keys.size(), std::shared_ptr<const string>());
+  values.assign(keys.size(), std::shared_ptr<const ChunkedValue>());
+
+  /* Put the data chunk requests of all stripes in flight before waiting on any of them. Evaluating a stripe will
+   * then only wait for its own requests, which have been running concurrently with all the others. */
+  std::vector<std::unique_ptr<StripeOperation_GET>> getops;
+  for (auto it = keys.cbegin(); it != keys.cend(); it++) {
+    if (!*it) {
+      getops.push_back(std::unique_ptr<StripeOperation_GET>());
+      continue;
+    }
+    getops.push_back(std::unique_ptr<StripeOperation_GET>(
+        new StripeOperation_GET(*it, false, chunkCapacity, connections, redundancy)
+    ));
+    getops.back()->submit();
+  }
+
+  std::vector<KineticStatus> status;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (!getops[i]) {
+      status.push_back(KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input, key has to be supplied."));
+      continue;
+    }
+    status.push_back(do_get(*getops[i], keys[i], versions[i], values[i], false));
+    kio_debug("Get request of key ", *keys[i], " as part of a ", keys.size(), " key multi-get completed with status: ",
+              status.back());
+  }
+  return status;
+}
+
 kinetic::KineticStatus KineticCluster::get(const std::shared_ptr<const std::string>& key,
                                            std::shared_ptr<const std::string>& version)
 {
-  std::shared_ptr<const string> value;
+  std::shared_ptr<const ChunkedValue> value;
   auto status = do_get(key, version, value, true);
   kio_debug("Get VERSION request of key ", *key, " completed with status: ", status);
   return status;
@@ -326,13 +781,155 @@ kinetic::KineticStatus KineticCluster::get(const std::shared_ptr<const std::stri
 kinetic::KineticStatus KineticCluster::get(const std::shared_ptr<const std::string>& key,
                                            std::shared_ptr<const std::string>& version,
                                            std::shared_ptr<const std::string>& value)
+{
+  std::shared_ptr<const ChunkedValue> chunked_value;
+  auto status = do_get(key, version, chunked_value, false);
+  if (status.ok()) {
+    value = chunked_value->toString();
+    kio_debug("Get DATA request of key ", *key, " completed with status: ", status);
+  }
+  return status;
+}
+
+kinetic::KineticStatus KineticCluster::get(const std::shared_ptr<const std::string>& key,
+                                           std::shared_ptr<const std::string>& version,
+                                           std::shared_ptr<const ChunkedValue>& value)
 {
   auto status = do_get(key, version, value, false);
   if (status.ok())
-    kio_debug("Get DATA request of key ", *key, " completed with status: ", status);
+    kio_debug("Get chunked DATA request of key ", *key, " completed with status: ", status);
   return status;
 }
 
+void KineticCluster::getAsync(const std::shared_ptr<const std::string>& key, bool skip_value,
+                              AsyncCallback callback)
+{
+  if (!key) {
+    callback(AsyncResult(KineticStatus(StatusCode::CLIENT_INTERNAL_ERROR, "invalid input, key has to be supplied.")));
+    return;
+  }
+
+  auto request = std::make_shared<GetRequest>(key, skip_value, chunkCapacity, connections, redundancy);
+  auto hedge = skip_value ? std::chrono::microseconds::zero() : hedgeDelay();
+  auto now = std::chrono::system_clock::now();
+  request->timeout_time = now + operation_timeout;
+  request->op.deferFlush(std::bind(&CompletionQueue::schedule, &completions, std::placeholders::_1,
+                                   std::placeholders::_2));
+  request->op.submit();
+
+  /* With hedged reads, the request is completed once the hedge delay passed so that parity chunks can be requested
+   * for outstanding data chunks. */
+  auto deadline = hedge > std::chrono::microseconds::zero() && hedge < operation_timeout ?
+                  now + hedge : std::chrono::system_clock::time_point::max();
+  completions.add(std::shared_ptr<KineticClusterOperation>(request, &request->op), request->timeout_time, deadline,
+                  std::bind(&KineticCluster::completeGet, this, request, hedge, callback));
+}
+
+void KineticCluster::completeGet(std::shared_ptr<GetRequest> request, std::chrono::microseconds hedge_delay,
+                                 AsyncCallback callback)
+{
+  auto next = std::bind(&KineticCluster::completeGet, this, request, std::chrono::microseconds::zero(), callback);
+
+  /* The hedge delay passed, the request is queued again to wait for the outstanding chunks. */
+  if (hedge_delay > std::chrono::microseconds::zero()) {
+    if (request->op.hedge()) {
+      kio_debug("Requested parity chunks for key ", *request->key, " after ", hedge_delay.count(), " microseconds.");
+    }
+    completions.add(std::shared_ptr<KineticClusterOperation>(request, &request->op), request->timeout_time,
+                    std::chrono::system_clock::time_point::max(), next);
+    return;
+  }
+
+  KineticStatus status(StatusCode::CLIENT_INTERNAL_ERROR, "");
+  if (!stageGet(request, status, next)) {
+    return;
+  }
+  if (status.statusCode() == StatusCode::CLIENT_IO_ERROR && request->op.mostFrequentVersion().frequency) {
+    auto now = std::chrono::system_clock::now();
+    completions.schedule(now + concurrency_check_interval,
+                         std::bind(&KineticCluster::checkGet, this, request, status, now, callback));
+    return;
+  }
+  resolveGet(request, status, callback);
+}
+
+bool KineticCluster::stageGet(std::shared_ptr<GetRequest> request, kinetic::KineticStatus& status,
+                              std::function<void()> next)
+{
+  if (request->op.complete(request->timeout_time, status)) {
+    return true;
+  }
+
+  /* Another stage of the read has been submitted, either the chunk reads or the handoff key lookup. */
+  request->timeout_time = std::chrono::system_clock::now() + operation_timeout;
+  auto lookup = request->op.handoffLookup();
+  completions.add(lookup ? std::static_pointer_cast<KineticClusterOperation>(lookup) :
+                  std::shared_ptr<KineticClusterOperation>(request, &request->op),
+                  request->timeout_time, std::chrono::system_clock::time_point::max(), next);
+  return false;
+}
+
+void KineticCluster::checkGet(std::shared_ptr<GetRequest> request, kinetic::KineticStatus status,
+                              std::chrono::system_clock::time_point start_time, AsyncCallback callback)
+{
+  auto check = std::make_shared<GetRequest>(request->key, request->skip_value, chunkCapacity, connections, redundancy);
+  check->timeout_time = std::chrono::system_clock::now() + operation_timeout;
+  check->op.deferFlush(std::bind(&CompletionQueue::schedule, &completions, std::placeholders::_1,
+                                 std::placeholders::_2));
+  check->op.submit();
+  completions.add(std::shared_ptr<KineticClusterOperation>(check, &check->op), check->timeout_time,
+                  std::chrono::system_clock::time_point::max(),
+                  std::bind(&KineticCluster::completeCheckGet, this, request, check, status, start_time, callback));
+}
+
+void KineticCluster::completeCheckGet(std::shared_ptr<GetRequest> request, std::shared_ptr<GetRequest> check,
+                                      kinetic::KineticStatus status, std::chrono::system_clock::time_point start_time,
+                                      AsyncCallback callback)
+{
+  KineticStatus check_status(StatusCode::CLIENT_INTERNAL_ERROR, "");
+  if (!stageGet(check, check_status,
+                std::bind(&KineticCluster::completeCheckGet, this, request, check, status, start_time, callback))) {
+    return;
+  }
+  if (request->op.mostFrequentVersion() != check->op.mostFrequentVersion()) {
+    kio_warning("Concurrent write detected. Re-starting get operation for key ", *request->key, ".");
+    getAsync(request->key, request->skip_value, callback);
+    return;
+  }
+
+  auto now = std::chrono::system_clock::now();
+  if (now < start_time + operation_timeout) {
+    completions.schedule(now + concurrency_check_interval,
+                         std::bind(&KineticCluster::checkGet, this, request, status, start_time, callback));
+    return;
+  }
+  kio_warning("No concurrent write: Both pre and post timeout most frequent version is ",
+              *request->op.mostFrequentVersion().version);
+  resolveGet(request, status, callback);
+}
+
+void KineticCluster::resolveGet(std::shared_ptr<GetRequest> request, kinetic::KineticStatus status,
+                                AsyncCallback callback)
+{
+  if (request->op.needsIndicator()) {
+    completions.offload(std::bind(&KineticCluster::finishGetAsync, this, request, status, callback));
+    return;
+  }
+  finishGetAsync(request, status, callback);
+}
+
+void KineticCluster::finishGetAsync(std::shared_ptr<GetRequest> request, kinetic::KineticStatus status,
+                                    AsyncCallback callback)
+{
+  std::shared_ptr<const std::string> version;
+  std::shared_ptr<const ChunkedValue> value;
+  AsyncResult result(finishGet(request->op, status, request->key, version, value, request->skip_value));
+  result.version = version;
+  result.value = value;
+  kio_debug("Asynchronous get request of key ", *request->key, " completed with status: ", result.status);
+  callback(result);
+}
+
 
 void KineticCluster::updateSnapshot(std::shared_ptr<DestructionMutex> dm)
 {
@@ -16,12 +16,23 @@
 #include "KineticClusterOperation.hh"
 #include <Logging.hh>
 #include <set>
+#include <algorithm>
+#include <thread>
 
 using namespace kio;
 using namespace kinetic;
 
+namespace {
+void flushConnections(const std::vector<KineticAutoConnection*>& connections)
+{
+  for (auto it = connections.cbegin(); it != connections.cend(); it++) {
+    (*it)->flush();
+  }
+}
+}
+
 KineticClusterOperation::KineticClusterOperation(std::vector<std::unique_ptr<KineticAutoConnection>>& connections) :
-    sync(std::make_shared<CallbackSynchronization>()), connections(connections)
+    sync(std::make_shared<CallbackSynchronization>()), connections(connections), flush_scheduler()
 { }
 
 KineticClusterOperation::~KineticClusterOperation()
@@ -34,7 +45,10 @@ void KineticClusterOperation::expandOperationVector(std::size_t size, std::size_
         KineticAsyncOperation{
             0,
             std::shared_ptr<kio::KineticCallback>(),
-            connections[(i + offset) % connections.size()].get()
+            connections[(i + offset) % connections.size()].get(),
+            std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>(),
+            0,
+            std::chrono::system_clock::time_point()
         }
     );
   }
@@ -43,46 +57,156 @@ void KineticClusterOperation::expandOperationVector(std::size_t size, std::size_
 std::map<kinetic::StatusCode, size_t, CompareStatusCode> KineticClusterOperation::executeOperationVector(
     const std::chrono::seconds& timeout)
 {
-  fd_set a; int fd;
-  std::vector<std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>> cons(operations.size());
-  std::vector<kinetic::HandlerKey> hkeys(operations.size());
+  submitOperationVector();
+  return waitOperationVector(std::chrono::system_clock::now() + timeout);
+}
+
+void KineticClusterOperation::submitOperationVector()
+{
+  std::vector<KineticAutoConnection*> connections;
+  std::vector<size_t> submitted;
+  auto window = std::chrono::microseconds::zero();
+  auto small = true;
 
-  /* Call functions on connections. */
+  /* Call functions on connections. Commands are queued on their connection and sent together with commands of
+   * concurrent operations to the same drive. */
   for (size_t i = 0; i < operations.size(); i++) {
-    
-    /* Skip operations that are already finished. This is most frequently the case in a 2phase get. */
-    if(operations[i].callback->finished()) {
+    auto& op = operations[i];
+
+    /* Skip operations that are already finished or in flight. This is most frequently the case in a 2phase get. */
+    if (op.con || op.callback->finished()) {
       continue;
     }
-    
+
     try {
-      cons[i] = operations[i].connection->get();
+      op.con = op.connection->get();
     }
     catch (const std::system_error& e) {
-      operations[i].callback->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Connection not available."));
+      op.callback->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Connection not available."));
       continue;
     }
 
-    hkeys[i] = operations[i].function(cons[i]);
-    if (!cons[i]->Run(&a, &a, &fd)) {
-      operations[i].callback->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Run returned false."));
-      operations[i].connection->setError(cons[i]);
-      kio_notice("Failed executing async operation for connection ", operations[i].connection->getName());
+    op.hkey = op.function(op.con);
+    op.connection->enqueue(op.con, op.callback);
+    submitted.push_back(i);
+    if (std::find(connections.begin(), connections.end(), op.connection) == connections.end()) {
+      connections.push_back(op.connection);
+      window = std::max(window, op.connection->batchWindow());
+    }
+    if (op.callback->expectedBytes() >= LatencyStatistics::large_value_size) {
+      small = false;
     }
   }
 
-  /* Wait until sufficient requests returned or we pass operation timeout. */
-  std::chrono::system_clock::time_point timeout_time = std::chrono::system_clock::now() + timeout;
-  sync->wait_until(timeout_time);
+  /* Small commands wait for concurrent commands once per submission rather than once per drive. Large values are
+   * sent right away, as their transfer time dominates the per command overhead. If the flush is deferred, the
+   * recorded latency of the commands includes the batch window. */
+  auto batch = small && window > std::chrono::microseconds::zero();
+  if (batch && !flush_scheduler) {
+    std::this_thread::sleep_for(window);
+  }
+  auto now = std::chrono::system_clock::now();
+  for (auto it = submitted.cbegin(); it != submitted.cend(); it++) {
+    operations[*it].submitted = now;
+  }
+  if (batch && flush_scheduler) {
+    flush_scheduler(now + window, std::bind(flushConnections, connections));
+    return;
+  }
+  flushConnections(connections);
+}
 
-  /* Timeout any unfinished request. We do not assume connection to be in error state because of a timeout */
-  for (size_t i = 0; i < operations.size(); i++) {
-    if (!operations[i].callback->finished()) {
-      kio_warning("Network timeout (", timeout, ") for connection ", operations[i].connection->getName());
-      cons[i]->RemoveHandler(hkeys[i]);
-      operations[i].callback->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Network timeout"));
+bool KineticClusterOperation::decided()
+{
+  return false;
+}
+
+bool KineticClusterOperation::quorumReached(size_t quorum_size)
+{
+  std::map<kinetic::StatusCode, size_t> results;
+  for (auto o = operations.cbegin(); o != operations.cend(); o++) {
+    if (o->callback->finished() && ++results[o->callback->getResult().statusCode()] >= quorum_size) {
+      return true;
     }
   }
+  return false;
+}
+
+void KineticClusterOperation::timeoutOperation(KineticAsyncOperation& op)
+{
+  /* We do not assume connection to be in error state because of a timeout. The time waited is recorded as latency,
+   * so that the adaptive timeout of a drive increases if it is repeatedly hit. */
+  kio_warning("Network timeout for connection ", op.connection->getName());
+  op.con->RemoveHandler(op.hkey);
+  op.callback->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Network timeout"));
+  op.connection->latency().record(op.callback->type(), op.callback->bytes(),
+                                  std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::system_clock::now() - op.submitted
+                                  ));
+  op.con.reset();
+}
+
+std::chrono::system_clock::time_point KineticClusterOperation::timeoutOperations(
+    const std::chrono::system_clock::time_point& timeout_time)
+{
+  auto now = std::chrono::system_clock::now();
+  auto next = timeout_time;
+  for (auto o = operations.begin(); o != operations.end(); o++) {
+    if (!o->con || o->callback->finished()) {
+      continue;
+    }
+    auto max_timeout = std::chrono::duration_cast<std::chrono::microseconds>(timeout_time - o->submitted);
+    auto deadline = o->submitted + o->connection->latency().timeout(o->callback->type(), max_timeout);
+    if (deadline <= now) {
+      timeoutOperation(*o);
+    }
+    else if (deadline < next) {
+      next = deadline;
+    }
+  }
+  return next;
+}
+
+std::map<kinetic::StatusCode, size_t, CompareStatusCode> KineticClusterOperation::waitOperationVector(
+    const std::chrono::system_clock::time_point& timeout_time)
+{
+  /* Wait until all requests returned, the result is decided or we pass operation timeout. The completion predicate
+   * is checked again whenever further requests returned or timed out. */
+  auto is_decided = false;
+  size_t received = 0;
+  while (!(is_decided = decided())) {
+    auto wakeup_time = timeoutOperations(timeout_time);
+    auto now_received = sync->wait_until(wakeup_time, received);
+    if (now_received == received && wakeup_time == timeout_time) {
+      break;
+    }
+    received = now_received;
+  }
+
+  /* Record latencies of completed requests. Requests still in flight time out, or are only cancelled so that they
+   * may be submitted again if the result has been decided. */
+  for (auto o = operations.begin(); o != operations.end(); o++) {
+    if (!o->con) {
+      continue;
+    }
+    if (o->callback->finished()) {
+      auto code = o->callback->getResult().statusCode();
+      if (code == StatusCode::OK || code == StatusCode::REMOTE_NOT_FOUND ||
+          code == StatusCode::REMOTE_VERSION_MISMATCH) {
+        o->connection->latency().record(o->callback->type(), o->callback->bytes(),
+                                        std::chrono::duration_cast<std::chrono::microseconds>(
+                                            o->callback->completionTime() - o->submitted
+                                        ));
+      }
+    }
+    else if (is_decided) {
+      o->con->RemoveHandler(o->hkey);
+    }
+    else {
+      timeoutOperation(*o);
+    }
+    o->con.reset();
+  }
 
   std::map<kinetic::StatusCode, size_t, CompareStatusCode> rmap;
   for (auto it = operations.cbegin(); it != operations.cend(); it++) {
@@ -91,8 +215,36 @@ std::map<kinetic::StatusCode, size_t, CompareStatusCode> KineticClusterOperation
   return rmap;
 }
 
+bool KineticClusterOperation::poll(const std::chrono::system_clock::time_point& timeout_time,
+                                   std::chrono::system_clock::time_point& wakeup)
+{
+  if (decided()) {
+    return true;
+  }
+  wakeup = timeoutOperations(timeout_time);
+  if (std::chrono::system_clock::now() >= timeout_time) {
+    return true;
+  }
+  for (auto o = operations.cbegin(); o != operations.cend(); o++) {
+    if (!o->callback->finished()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void KineticClusterOperation::setListener(std::function<void()> listener)
+{
+  sync->setListener(std::move(listener));
+}
+
+void KineticClusterOperation::deferFlush(FlushScheduler scheduler)
+{
+  flush_scheduler = std::move(scheduler);
+}
+
 ClusterFlushOp::ClusterFlushOp(std::vector<std::unique_ptr<KineticAutoConnection>>& connections)
-    : KineticClusterOperation(connections)
+    : KineticClusterOperation(connections), quorum(0)
 {
   expandOperationVector(connections.size(), 0);
   for (auto o = operations.begin(); o != operations.end(); o++) {
@@ -103,8 +255,20 @@ ClusterFlushOp::ClusterFlushOp(std::vector<std::unique_ptr<KineticAutoConnection
 
 }
 
+bool ClusterFlushOp::decided()
+{
+  return quorum && quorumReached(quorum);
+}
+
+void ClusterFlushOp::submit(size_t quorum_size)
+{
+  quorum = quorum_size;
+  submitOperationVector();
+}
+
 KineticStatus ClusterFlushOp::execute(const std::chrono::seconds& timeout, size_t quorum_size)
 {
+  quorum = quorum_size;
   auto rmap = executeOperationVector(timeout);
 
   for (auto it = rmap.cbegin(); it != rmap.cend(); it++) {
@@ -175,6 +339,8 @@ ClusterRangeOp::ClusterRangeOp(const std::shared_ptr<const std::string>& start_k
 
 kinetic::KineticStatus ClusterRangeOp::execute(const std::chrono::seconds& timeout, size_t quorum_size)
 {
+  /* Keys are merged from the replies of all drives, single keys such as indicator keys may only exist on one drive.
+   * The result is therefore not decided by a quorum of replies. */
   auto rmap = executeOperationVector(timeout);
 
   for (auto it = rmap.cbegin(); it != rmap.cend(); it++) {
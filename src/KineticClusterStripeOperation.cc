@@ -50,7 +50,10 @@ void KineticClusterStripeOperation::expandOperationVector(std::size_t size, std:
         KineticAsyncOperation{
             0,
             std::shared_ptr<kio::KineticCallback>(),
-            connections[index].get()
+            connections[index].get(),
+            std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>(),
+            0,
+            std::chrono::system_clock::time_point()
         }
     );
     size--;
@@ -94,7 +97,7 @@ kinetic::KineticStatus KineticClusterStripeOperation::createSingleKey(
     expandOperationVector(1, operations.size());
     count++;
 
-    auto cb = std::make_shared<PutCallback>(sync);
+    auto cb = std::make_shared<PutCallback>(sync, keyvalue->size());
     operations.back().callback = cb;
     operations.back().function = std::bind<HandlerKey(ThreadsafeNonblockingKineticConnection::*)(
         const shared_ptr<const string>,
@@ -156,7 +159,7 @@ void StripeOperation_PUT::fillOperation(size_t index, const shared_ptr<const str
 {
 
   auto record = makeRecord(values[index], version_new);
-  auto cb = std::make_shared<PutCallback>(sync);
+  auto cb = std::make_shared<PutCallback>(sync, values[index]->size());
 
   operations[index].callback = cb;
   operations[index].function = std::bind<HandlerKey(ThreadsafeNonblockingKineticConnection::*)(
@@ -219,6 +222,18 @@ kinetic::KineticStatus StripeOperation_PUT::execute(const std::chrono::seconds&
   return KineticStatus(StatusCode::CLIENT_IO_ERROR, "Key" + *key + "not accessible.");
 }
 
+bool StripeOperation_PUT::needsResolution() const
+{
+  /* Any stripe not written completely requires resolving a partial write or an indicator key and handoff keys. */
+  size_t ok = 0;
+  for (auto it = operations.cbegin(); it != operations.cend(); it++) {
+    if (it->callback->getResult().statusCode() == StatusCode::OK) {
+      ok++;
+    }
+  }
+  return ok && ok < operations.size();
+}
+
 void StripeOperation_PUT::putHandoffKeys()
 {
   for (size_t opnum = 0; opnum < values.size(); opnum++) {
@@ -270,7 +285,7 @@ void WriteStripeOperation::resolvePartialWrite(const std::chrono::seconds& timeo
   auto position = 0;
 
   do {
-    StripeOperation_GET getVersions(key, true, connections, redundancy, true);
+    StripeOperation_GET getVersions(key, true, 0, connections, redundancy, true);
     auto rmap = getVersions.executeOperationVector(timeout);
     auto most_frequent = getVersions.mostFrequentVersion();
 
@@ -316,7 +331,7 @@ void WriteStripeOperation::resolvePartialWrite(const std::chrono::seconds& timeo
   } while (std::chrono::system_clock::now() < start_time + timeout * (position + 1));
 
   kio_warning("Client crash detected. Overwriting with version ", *version);
-  StripeOperation_GET getVersions(key, true, connections, redundancy, true);
+  StripeOperation_GET getVersions(key, true, 0, connections, redundancy, true);
   getVersions.executeOperationVector(timeout);
   if (!attemptStripeRepair(timeout, getVersions)) {
     kio_warning("Failed repairing stripe.");
@@ -392,11 +407,27 @@ kinetic::KineticStatus StripeOperation_DEL::execute(const std::chrono::seconds&
   return KineticStatus(StatusCode::CLIENT_IO_ERROR, "Key " + *key + " not accessible.");
 }
 
+bool StripeOperation_DEL::needsResolution() const
+{
+  /* Removes that did not find the key count as successful, any other mix of results requires resolving a partial
+   * remove or an indicator key. */
+  std::set<StatusCode> codes;
+  for (auto it = operations.cbegin(); it != operations.cend(); it++) {
+    codes.insert(it->callback->getResult().statusCode());
+  }
+  if (codes.count(StatusCode::OK)) {
+    codes.erase(StatusCode::REMOTE_NOT_FOUND);
+  }
+  return codes.size() > 1;
+}
 
 StripeOperation_GET::StripeOperation_GET(const std::shared_ptr<const std::string>& key, bool skip_value,
+                                         std::size_t chunk_size,
                                          std::vector<std::unique_ptr<KineticAutoConnection>>& connections,
                                          std::shared_ptr<RedundancyProvider>& redundancy, bool skip_partial_get)
-    : KineticClusterStripeOperation(connections, key, redundancy), skip_value(skip_value)
+    : KineticClusterStripeOperation(connections, key, redundancy), skip_value(skip_value),
+      chunk_size(skip_value ? 0 : chunk_size), full_stripe(skip_partial_get), early_completion(false), avoided(),
+      stage(Stage::DATA), handoff_range(), start_time(), version(), data_chunks(), value_size(0)
 {
   if (skip_partial_get) {
     expandOperationVector(redundancy->size(), 0);
@@ -421,7 +452,7 @@ void StripeOperation_GET::fillOperation(KineticAsyncOperation& op, std::shared_p
         cb);
   }
   else {
-    auto cb = std::make_shared<GetCallback>(sync);
+    auto cb = std::make_shared<GetCallback>(sync, chunk_size);
     op.callback = cb;
     op.function = std::bind<HandlerKey(ThreadsafeNonblockingKineticConnection::*)(
         const std::shared_ptr<const std::string>,
@@ -445,23 +476,36 @@ void StripeOperation_GET::fillOperationVector()
 
 
 bool StripeOperation_GET::insertHandoffChunks()
+{
+  auto range = makeHandoffLookup();
+  if (!range) {
+    return false;
+  }
+  range->executeOperationVector(std::chrono::seconds(5));
+  return insertHandoffChunks(*range);
+}
+
+std::shared_ptr<ClusterRangeOp> StripeOperation_GET::makeHandoffLookup()
 {
   /* If we don't even have a target version, there's no need to look for chunks */
   if (!version.version) {
-    return false;
+    return std::shared_ptr<ClusterRangeOp>();
   }
 
-  auto inserted = false;
   auto start_key = std::make_shared<const string>(
       utility::Convert::toString("handoff=", *key, "version=", *version.version)
   );
   auto end_key = std::make_shared<const string>(
       utility::Convert::toString("handoff=", *key, "version=", *version.version, "~")
   );
+  auto range = std::make_shared<ClusterRangeOp>(start_key, end_key, 100, connections);
+  range->deferFlush(flush_scheduler);
+  return range;
+}
 
-  ClusterRangeOp range(start_key, end_key, 100, connections);
-  range.executeOperationVector(std::chrono::seconds(5));
-
+bool StripeOperation_GET::insertHandoffChunks(ClusterRangeOp& range)
+{
+  auto inserted = false;
   for (size_t i = 0; i < range.operations.size(); i++) {
     auto& opkeys = std::static_pointer_cast<RangeCallback>(range.operations[i].callback)->getKeys();
     kio_debug("found ", opkeys ? opkeys->size() : 0, " handoff keys on connection #", i);
@@ -483,10 +527,9 @@ bool StripeOperation_GET::insertHandoffChunks()
 
 void StripeOperation_GET::reconstructValue()
 {
-  value = make_shared<string>();
-
-  auto size = utility::uuidDecodeSize(version.version);
-  if (!size) {
+  data_chunks.clear();
+  value_size = utility::uuidDecodeSize(version.version);
+  if (!value_size) {
     kio_debug("Key ", *key, " is empty according to version: ", version.version);
     return;
   }
@@ -522,6 +565,9 @@ void StripeOperation_GET::reconstructValue()
         kio_notice("Chunk ", i, " of key ", *key, " has incorrect version. "
             "Expected = ", *version.version, "    Observed = ", *record->version());
       }
+      else if (!operations[i].callback->finished()) {
+        kio_debug("Chunk ", i, " of key ", *key, " has not been read.");
+      }
       else {
         kio_notice("Chunk ", i, " of key ", *key, " is invalid.");
       }
@@ -532,6 +578,11 @@ void StripeOperation_GET::reconstructValue()
 
   if (need_recovery) {
 
+    /* Parity chunks that have not been requested are missing as well. */
+    while (stripe.size() < redundancy->size()) {
+      stripe.push_back(make_shared<const string>());
+    }
+
     if (zeroed_indices.size()) {
       size_t chunkSize = 0;
       for (auto it = stripe.cbegin(); it != stripe.cend(); it++) {
@@ -548,68 +599,53 @@ void StripeOperation_GET::reconstructValue()
     redundancy->compute(stripe);
   }
 
-  /* Step 2) merge data chunks into single value */
-  value->reserve(size);
-  for (auto it = stripe.cbegin(); it != stripe.cend(); it++) {
-    if (value->size() + (*it)->size() <= size) {
-      *value += **it;
-    }
-    else {
-      value->append(**it, 0, size - value->size());
-      break;
-    }
-  }
-}
-
-bool getVersionEqual(const std::shared_ptr<KineticCallback>& lhs, const std::shared_ptr<KineticCallback>& rhs)
-{
-  if (!lhs->getResult().ok() || !rhs->getResult().ok()) {
-    return false;
-  }
-
-  return
-      std::static_pointer_cast<GetVersionCallback>(lhs)->getVersion()
-      ==
-      std::static_pointer_cast<GetVersionCallback>(rhs)->getVersion();
-}
-
-bool getRecordVersionEqual(const std::shared_ptr<KineticCallback>& lhs, const std::shared_ptr<KineticCallback>& rhs)
-{
-  if (!lhs->getResult().ok() || !rhs->getResult().ok()) {
-    return false;
-  }
-
-  return
-      *std::static_pointer_cast<GetCallback>(lhs)->getRecord()->version()
-      ==
-      *std::static_pointer_cast<GetCallback>(rhs)->getRecord()->version();
+  /* Step 2) remember data chunks, the value is assembled from them on request */
+  data_chunks.assign(stripe.cbegin(), stripe.cbegin() + redundancy->numData());
 }
 
 StripeOperation_GET::VersionCount StripeOperation_GET::mostFrequentVersion() const
 {
-  VersionCount v{std::shared_ptr<const std::string>(), 0};
-
-  v.frequency = 0;
+  /* Single pass tally of all versions. A stripe rarely holds more than a few distinct versions, so the tally is a
+   * small flat vector searched linearly. Each callback is locked only once to obtain its result. */
+  struct Tally {
+    const std::string* version;
+    size_t frequency;
+    const KineticAsyncOperation* operation;
+  };
+  std::vector<Tally> tally;
+  tally.reserve(4);
 
-  auto element = operations.cbegin();
   for (auto o = operations.cbegin(); o != operations.cend(); o++) {
-    size_t frequency = 0;
-    for (auto l = operations.cbegin(); l != operations.cend(); l++) {
-      if (skip_value ? getVersionEqual(o->callback, l->callback) : getRecordVersionEqual(o->callback, l->callback)) {
-        frequency++;
-      }
+    if (!o->callback || !o->callback->getResult().ok()) {
+      continue;
     }
+    const std::string* v = skip_value ?
+                           &std::static_pointer_cast<GetVersionCallback>(o->callback)->getVersion() :
+                           std::static_pointer_cast<GetCallback>(o->callback)->getRecord()->version().get();
 
-    if (frequency > v.frequency) {
-      v.frequency = frequency;
-      element = o;
+    auto t = tally.begin();
+    while (t != tally.end() && *t->version != *v) {
+      t++;
     }
-    if (frequency > operations.size() / 2) {
-      break;
+    if (t == tally.end()) {
+      tally.push_back(Tally{v, 1, &*o});
+    }
+    else {
+      t->frequency++;
     }
   }
 
-  if (v.frequency) {
+  /* On a tie, the version encountered first in the operation vector wins. */
+  VersionCount v{std::shared_ptr<const std::string>(), 0};
+  const KineticAsyncOperation* element = NULL;
+  for (auto t = tally.cbegin(); t != tally.cend(); t++) {
+    if (t->frequency > v.frequency) {
+      v.frequency = t->frequency;
+      element = t->operation;
+    }
+  }
+
+  if (element) {
     if (skip_value) {
       v.version = std::make_shared<const std::string>(
           std::static_pointer_cast<GetVersionCallback>(element->callback)->getVersion());
@@ -622,9 +658,43 @@ StripeOperation_GET::VersionCount StripeOperation_GET::mostFrequentVersion() con
 }
 
 
+void StripeOperation_GET::avoidSlowDrives()
+{
+  if (full_stripe || operations.size() != redundancy->numData()) {
+    return;
+  }
+  std::vector<std::size_t> slow;
+  for (size_t i = 0; i < operations.size(); i++) {
+    if (operations[i].connection->isSlow() && !operations[i].con && !operations[i].callback->finished()) {
+      slow.push_back(i);
+    }
+  }
+  if (slow.empty() || slow.size() > redundancy->numParity()) {
+    return;
+  }
+
+  expandOperationVector(slow.size(), operations.size());
+  fillOperationVector();
+  for (auto it = slow.cbegin(); it != slow.cend(); it++) {
+    kio_debug("Reading parity chunk instead of data chunk from slow drive ", operations[*it].connection->getName(),
+              " for key ", *key);
+    operations[*it].callback->OnResult(KineticStatus(StatusCode::CLIENT_IO_ERROR, "Skipped slow drive."));
+    avoided.push_back(*it);
+  }
+}
+
+bool StripeOperation_GET::decided()
+{
+  return early_completion && sync->versionFrequency() >= redundancy->numData();
+}
+
 kinetic::KineticStatus StripeOperation_GET::do_execute(const std::chrono::seconds& timeout)
 {
-  auto rmap = executeOperationVector(timeout);
+  return evaluate(executeOperationVector(timeout));
+}
+
+kinetic::KineticStatus StripeOperation_GET::evaluate(std::map<kinetic::StatusCode, size_t, CompareStatusCode> rmap)
+{
   version = mostFrequentVersion();
 
   /* Indicator should be written if chunk versions of this stripe are not aligned */
@@ -649,6 +719,123 @@ kinetic::KineticStatus StripeOperation_GET::do_execute(const std::chrono::second
 
 
 kinetic::KineticStatus StripeOperation_GET::execute(const std::chrono::seconds& timeout)
+{
+  return execute(timeout, std::chrono::microseconds::zero());
+}
+
+kinetic::KineticStatus StripeOperation_GET::execute(const std::chrono::seconds& timeout,
+                                                    const std::chrono::microseconds& hedge_delay)
+{
+  /* Reading the full stripe is requested to obtain the versions of all chunks. Operations appended after execution
+   * (e.g. to place an indicator key) are no get operations, the completion predicate may only be active during
+   * execution. */
+  early_completion = !full_stripe;
+  avoidSlowDrives();
+  KineticStatus status = hedge_delay == std::chrono::microseconds::zero() || hedge_delay >= timeout ||
+                         operations.size() >= redundancy->size() ?
+                         execute_staged(timeout) :
+                         execute_hedged(timeout, hedge_delay);
+  early_completion = false;
+  return status;
+}
+
+void StripeOperation_GET::submit()
+{
+  early_completion = !full_stripe;
+  avoidSlowDrives();
+  start_time = std::chrono::system_clock::now();
+  submitOperationVector();
+}
+
+bool StripeOperation_GET::hedge()
+{
+  if (operations.size() >= redundancy->size() || decided()) {
+    return false;
+  }
+  for (auto o = operations.cbegin(); o != operations.cend(); o++) {
+    if (!o->callback->finished()) {
+      expandOperationVector(redundancy->size() - operations.size(), operations.size());
+      fillOperationVector();
+      submitOperationVector();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool StripeOperation_GET::complete(const std::chrono::system_clock::time_point& timeout_time,
+                                   kinetic::KineticStatus& status)
+{
+  if (stage == Stage::HANDOFF_LOOKUP) {
+    handoff_range->waitOperationVector(timeout_time);
+    auto inserted = insertHandoffChunks(*handoff_range);
+    handoff_range.reset();
+    if (inserted) {
+      stage = Stage::HANDOFF;
+      submitOperationVector();
+      return false;
+    }
+  }
+  else {
+    /* The operations have been completed by poll(), waiting returns right away. */
+    try {
+      status = evaluate(waitOperationVector(timeout_time));
+      early_completion = false;
+      return true;
+    } catch (std::exception& e) {
+      kio_debug("Failed getting stripe for key ", *key, " in read stage ", static_cast<int>(stage), ": ", e.what());
+    }
+    if (nextStage()) {
+      if (handoff_range) {
+        handoff_range->submitOperationVector();
+      }
+      else {
+        submitOperationVector();
+      }
+      return false;
+    }
+  }
+  early_completion = false;
+  status = KineticStatus(StatusCode::CLIENT_IO_ERROR, "Key " + *key + " not accessible.");
+  return true;
+}
+
+std::shared_ptr<ClusterRangeOp> StripeOperation_GET::handoffLookup() const
+{
+  return handoff_range;
+}
+
+bool StripeOperation_GET::nextStage()
+{
+  if (stage == Stage::DATA && operations.size() == redundancy->numData() && redundancy->numLocalParity()) {
+    expandOperationVector(redundancy->numLocalParity(), operations.size());
+    fillOperationVector();
+    stage = Stage::LOCAL_PARITY;
+    return true;
+  }
+  if (stage == Stage::DATA || stage == Stage::LOCAL_PARITY) {
+    if (operations.size() < redundancy->size()) {
+      expandOperationVector(redundancy->size() - operations.size(), operations.size());
+      fillOperationVector();
+    }
+    for (auto it = avoided.cbegin(); it != avoided.cend(); it++) {
+      operations[*it].callback->reset();
+    }
+    avoided.clear();
+    stage = Stage::PARITY;
+    return true;
+  }
+  if (stage == Stage::PARITY) {
+    handoff_range = makeHandoffLookup();
+    if (handoff_range) {
+      stage = Stage::HANDOFF_LOOKUP;
+      return true;
+    }
+  }
+  return false;
+}
+
+kinetic::KineticStatus StripeOperation_GET::execute_staged(const std::chrono::seconds& timeout)
 {
   /* Attempt to read without parities */
   try {
@@ -657,11 +844,27 @@ kinetic::KineticStatus StripeOperation_GET::execute(const std::chrono::seconds&
     kio_debug("Failed getting stripe for key ", *key, " without parities: ", e.what());
   }
 
-  /* Add parity chunks to get request (already obtained chunks will not be re-fetched). */
-  if (operations.size() == redundancy->numData()) {
-    expandOperationVector(redundancy->numParity(), operations.size());
+  /* With a locally repairable code, a single missing data chunk can be reconstructed from the local parities. */
+  if (operations.size() == redundancy->numData() && redundancy->numLocalParity()) {
+    expandOperationVector(redundancy->numLocalParity(), operations.size());
     fillOperationVector();
+    try {
+      return do_execute(timeout);
+    } catch (std::exception& e) {
+      kio_debug("Failed getting stripe for key ", *key, " with local parities: ", e.what());
+    }
+  }
+
+  /* Add parity chunks to get request (already obtained chunks will not be re-fetched). Chunks skipped because of
+   * slow drives are read as well, a slow drive is better than a missing one. */
+  if (operations.size() < redundancy->size()) {
+    expandOperationVector(redundancy->size() - operations.size(), operations.size());
+    fillOperationVector();
+  }
+  for (auto it = avoided.cbegin(); it != avoided.cend(); it++) {
+    operations[*it].callback->reset();
   }
+  avoided.clear();
   try {
     return do_execute(timeout);
   } catch (std::exception& e) {
@@ -679,13 +882,62 @@ kinetic::KineticStatus StripeOperation_GET::execute(const std::chrono::seconds&
   return KineticStatus(StatusCode::CLIENT_IO_ERROR, "Key " + *key + " not accessible.");
 }
 
+kinetic::KineticStatus StripeOperation_GET::execute_hedged(const std::chrono::seconds& timeout,
+                                                           const std::chrono::microseconds& hedge_delay)
+{
+  /* Reads may already have been started by submit(). */
+  if (start_time == std::chrono::system_clock::time_point()) {
+    start_time = std::chrono::system_clock::now();
+  }
+  submitOperationVector();
+  sync->wait_until(start_time + hedge_delay);
+
+  /* A slow drive should not stall the read, request parity chunks if any data chunk is still outstanding. */
+  if (hedge()) {
+    kio_debug("Requested parity chunks for key ", *key, " after ", hedge_delay.count(), " microseconds.");
+  }
+
+  /* Evaluate as soon as nData chunks have been read, requests still in flight are cancelled. */
+  try {
+    return evaluate(waitOperationVector(start_time + timeout));
+  } catch (std::exception& e) {
+    kio_debug("Failed getting stripe for key ", *key, " with hedged read: ", e.what());
+  }
+
+  /* Cancelled requests will be submitted again. */
+  return execute_staged(timeout);
+}
+
 std::shared_ptr<const std::string> StripeOperation_GET::getVersion() const
 {
   return version.version;
 }
 
-std::shared_ptr<const std::string> StripeOperation_GET::getValue() const
+std::shared_ptr<const ChunkedValue> StripeOperation_GET::getValue(std::size_t chunk_capacity) const
 {
+  /* Only the data chunks containing value data are of interest. */
+  std::vector<std::shared_ptr<const std::string>> chunks;
+  bool shareable = true;
+  size_t offset = 0;
+  for (auto it = data_chunks.cbegin(); it != data_chunks.cend() && offset < value_size; it++) {
+    if ((*it)->size() > chunk_capacity || (offset + (*it)->size() < value_size && (*it)->size() != chunk_capacity)) {
+      shareable = false;
+    }
+    chunks.push_back(*it);
+    offset += (*it)->size();
+  }
+
+  if (shareable) {
+    return std::make_shared<const ChunkedValue>(chunk_capacity, std::move(chunks), value_size);
+  }
+
+  /* The stripe has been written with a different chunk capacity, fall back to copying. */
+  auto value = std::make_shared<ChunkedValue>(chunk_capacity);
+  offset = 0;
+  for (auto it = chunks.cbegin(); it != chunks.cend(); it++) {
+    value->write((*it)->data(), offset, std::min((*it)->size(), value_size - offset));
+    offset += (*it)->size();
+  }
   return value;
 }
 
@@ -16,11 +16,14 @@
 #include "KineticIoSingleton.hh"
 #include "Logging.hh"
 #include <fstream>
+#include <algorithm>
 #include <iostream>
 
 using namespace kio;
 
-KineticIoSingleton::KineticIoSingleton() : dataCache(0), threadPool(0, 0)
+KineticIoSingleton::KineticIoSingleton() :
+    bufferPool(std::make_shared<BufferPool>(0, std::set<size_t>())), clusterMap(bufferPool), dataCache(0),
+    threadPool(0, 0), writeBack(0, 0, 0, 0)
 {
   configuration.readahead_window_size = 0;
   try {
@@ -52,6 +55,16 @@ BackgroundOperationHandler& KineticIoSingleton::threadpool()
   return threadPool;
 }
 
+WriteBackHandler& KineticIoSingleton::writeback()
+{
+  return writeBack;
+}
+
+BufferPool& KineticIoSingleton::bufferpool()
+{
+  return *bufferPool;
+}
+
 /* Utility functions for this class only. */
 namespace {
 /* Read file located at path into string buffer and return it. */
@@ -89,6 +102,15 @@ int loadJsonIntEntry(struct json_object* obj, const char* key)
   return json_object_get_int(tmp);
 }
 
+int loadOptionalJsonIntEntry(struct json_object* obj, const char* key, int default_value)
+{
+  struct json_object* tmp = NULL;
+  if (!json_object_object_get_ex(obj, key, &tmp)) {
+    return default_value;
+  }
+  return json_object_get_int(tmp);
+}
+
 void put_json(json_object* json_root)
 {
   json_object_put(json_root);
@@ -174,10 +196,21 @@ void KineticIoSingleton::loadConfiguration()
   };
   parseConfiguration(o1);
 
+  /* Buffers of the chunk size of any configured cluster are pooled. */
+  std::set<size_t> chunk_sizes;
+  for (auto it = clusterInfo.cbegin(); it != clusterInfo.cend(); it++) {
+    chunk_sizes.insert(it->second.blockSize);
+  }
+
   std::lock_guard<std::mutex> lock(mutex);
+  bufferPool->changeConfiguration(configuration.bufferpool_capacity, chunk_sizes);
+  clusterMap.changeCompletionConfiguration(configuration.completion_threads, configuration.completion_queue_depth);
   clusterMap.reset(std::move(clusterInfo), std::move(driveInfo));
-  dataCache.changeConfiguration(configuration.stripecache_capacity);
+  clusterMap.changeListenerConfiguration(configuration.listener_threads, configuration.listener_pinning);
+  dataCache.changeConfiguration(configuration.stripecache_capacity, configuration.cache_policy);
   threadPool.changeConfiguration(configuration.background_io_threads, configuration.background_io_queue_capacity);
+  writeBack.changeConfiguration(configuration.writeback_limit, configuration.writeback_high_watermark,
+                                configuration.writeback_low_watermark, configuration.background_io_threads);
 }
 
 std::unordered_map<std::string, std::pair<kinetic::ConnectionOptions, kinetic::ConnectionOptions>> KineticIoSingleton::parseDrives(
@@ -252,11 +285,49 @@ std::unordered_map<std::string, ClusterInformation> KineticIoSingleton::parseClu
     cinfo.numData = (size_t) loadJsonIntEntry(cluster, "numData");
     cinfo.numParity = (size_t) loadJsonIntEntry(cluster, "numParity");
 
+    /* Optional entries, default to a Cauchy Reed-Solomon code. */
+    cinfo.codec = RedundancyProvider::Codec::CAUCHY_RS;
+    struct json_object* tmp = NULL;
+    if (json_object_object_get_ex(cluster, "codec", &tmp)) {
+      std::string codec = json_object_get_string(tmp);
+      if (codec == "vandermonde") {
+        cinfo.codec = RedundancyProvider::Codec::VANDERMONDE_RS;
+      }
+      else if (codec == "xor") {
+        cinfo.codec = RedundancyProvider::Codec::XOR;
+      }
+      else if (codec == "lrc") {
+        cinfo.codec = RedundancyProvider::Codec::LRC;
+      }
+      else if (codec != "cauchy") {
+        kio_error("Invalid codec ", codec, " for cluster ", id, ", supported codecs are cauchy, vandermonde, "
+                  "xor and lrc.");
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+      }
+    }
+    cinfo.numLocalParity = (size_t) loadOptionalJsonIntEntry(cluster, "numLocalParity", 0);
+
     cinfo.blockSize = (size_t) loadJsonIntEntry(cluster, "chunkSizeKB");
     cinfo.blockSize *= 1024;
 
     cinfo.min_reconnect_interval = std::chrono::seconds(loadJsonIntEntry(cluster, "minReconnectInterval"));
     cinfo.operation_timeout = std::chrono::seconds(loadJsonIntEntry(cluster, "timeout"));
+    cinfo.readHedgePercentile = (size_t) loadOptionalJsonIntEntry(cluster, "readHedgePercentile", 95);
+    cinfo.batch_window = std::chrono::microseconds(loadOptionalJsonIntEntry(cluster, "batchWindowUs", 0));
+
+    cinfo.connections_per_drive = (size_t) std::max(loadOptionalJsonIntEntry(cluster, "connectionsPerDrive", 1), 1);
+    cinfo.connection_selection = KineticAutoConnection::Selection::ROUND_ROBIN;
+    if (json_object_object_get_ex(cluster, "connectionSelection", &tmp)) {
+      std::string selection = json_object_get_string(tmp);
+      if (selection == "leastoutstanding") {
+        cinfo.connection_selection = KineticAutoConnection::Selection::LEAST_OUTSTANDING;
+      }
+      else if (selection != "roundrobin") {
+        kio_error("Invalid connection selection ", selection, " for cluster ", id, ", supported are roundrobin and "
+                  "leastoutstanding.");
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+      }
+    }
 
     struct json_object* list = NULL;
     if (!json_object_object_get_ex(cluster, "drives", &list)) {
@@ -281,9 +352,53 @@ void KineticIoSingleton::parseConfiguration(struct json_object* config)
   configuration.stripecache_capacity = (size_t) loadJsonIntEntry(config, "cacheCapacityMB");
   configuration.stripecache_capacity *= 1024 * 1024;
 
+  /* Optional entry, default to LRU cache replacement. */
+  configuration.cache_policy = DataCache::Policy::LRU;
+  struct json_object* tmp = NULL;
+  if (json_object_object_get_ex(config, "cacheReplacementPolicy", &tmp)) {
+    std::string policy = json_object_get_string(tmp);
+    if (policy == "2Q") {
+      configuration.cache_policy = DataCache::Policy::TWO_Q;
+    }
+    else if (policy != "LRU") {
+      kio_error("Invalid cache replacement policy ", policy, ", supported policies are LRU and 2Q.");
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+    }
+  }
+
   configuration.readahead_window_size = (size_t) loadJsonIntEntry(config, "maxReadaheadWindow");
   configuration.background_io_threads = loadJsonIntEntry(config, "maxBackgroundIoThreads");
   configuration.background_io_queue_capacity = loadJsonIntEntry(config, "maxBackgroundIoQueue");
+
+  /* Optional entries, by default half the cache may be dirty. Watermarks are percentages of the dirty limit. */
+  configuration.writeback_limit = (size_t) loadOptionalJsonIntEntry(
+      config, "writebackLimitMB", configuration.stripecache_capacity / (2 * 1024 * 1024)
+  );
+  configuration.writeback_limit *= 1024 * 1024;
+  int high = loadOptionalJsonIntEntry(config, "writebackHighWatermark", 50);
+  int low = loadOptionalJsonIntEntry(config, "writebackLowWatermark", 25);
+  if (low < 0 || high < low || high > 100) {
+    kio_error("Invalid writeback watermarks ", low, " / ", high, ", required is 0 <= low <= high <= 100.");
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+  }
+  configuration.writeback_high_watermark = configuration.writeback_limit / 100 * high;
+  configuration.writeback_low_watermark = configuration.writeback_limit / 100 * low;
+
+  /* Optional entries, by default a single unpinned thread processes drive responses. */
+  configuration.listener_threads = (size_t) std::max(loadOptionalJsonIntEntry(config, "listenerThreads", 1), 1);
+  configuration.listener_pinning = loadOptionalJsonIntEntry(config, "listenerCpuPinning", 0) != 0;
+
+  /* Optional entry, by default up to 256 MB of buffers are kept for re-use. */
+  configuration.bufferpool_capacity = (size_t) std::max(
+      loadOptionalJsonIntEntry(config, "bufferPoolCapacityMB", 256), 0
+  );
+  configuration.bufferpool_capacity *= 1024 * 1024;
+
+  /* Optional entries, by default 4 threads per cluster complete asynchronous operations. */
+  configuration.completion_threads = (size_t) std::max(loadOptionalJsonIntEntry(config, "completionThreads", 4), 1);
+  configuration.completion_queue_depth = (size_t) std::max(
+      loadOptionalJsonIntEntry(config, "completionQueueDepth", 1024), 1
+  );
 }
 
 size_t KineticIoSingleton::readaheadWindowSize()
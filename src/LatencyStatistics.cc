@@ -0,0 +1,160 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "LatencyStatistics.hh"
+#include <algorithm>
+#include <cmath>
+
+using namespace kio;
+using std::chrono::microseconds;
+
+const size_t LatencyStatistics::large_value_size = 64 * 1024;
+const uint64_t LatencyStatistics::min_samples = 64;
+
+namespace {
+/* Buckets are logarithmically sized with 8 buckets per power of two, limiting the error of computed percentiles to
+ * 12.5%. The last bucket starts at ~17 minutes. */
+const size_t bucket_count = 232;
+
+/* Bucket counts are halved once they sum up to this value, so that old latencies lose influence over time. */
+const uint64_t decay_total = 2048;
+
+/* Weight of a new latency in the moving average. */
+const double ewma_weight = 1.0 / 16;
+
+/* Adaptive timeouts are a multiple of the 99th percentile latency, but at least the minimum timeout. */
+const int timeout_factor = 8;
+const microseconds min_timeout = std::chrono::seconds(1);
+
+size_t bucketIndex(uint64_t latency)
+{
+  if (latency < 8) {
+    return latency;
+  }
+  size_t exponent = 0;
+  while (latency >> (exponent + 1)) {
+    exponent++;
+  }
+  size_t index = (exponent - 2) * 8 + ((latency >> (exponent - 3)) & 7);
+  return std::min(index, bucket_count - 1);
+}
+
+uint64_t bucketUpperBound(size_t index)
+{
+  index++;
+  if (index < 8) {
+    return index;
+  }
+  return (8 + index % 8) << (index / 8 - 1);
+}
+}
+
+LatencyStatistics::LatencyStatistics() : histograms(), mutex()
+{ }
+
+void LatencyStatistics::record(OperationType type, size_t bytes, microseconds latency)
+{
+  auto size = bytes >= large_value_size ? SizeClass::LARGE : SizeClass::SMALL;
+  auto value = static_cast<uint64_t>(std::max(latency, microseconds::zero()).count());
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& h = histograms[std::make_pair(type, size)];
+  if (h.buckets.empty()) {
+    h.buckets.resize(bucket_count, 0);
+    h.ewma = value;
+  }
+  h.samples++;
+  h.ewma += (value - h.ewma) * ewma_weight;
+  h.buckets[bucketIndex(value)]++;
+
+  if (++h.total >= decay_total) {
+    h.total = 0;
+    for (auto it = h.buckets.begin(); it != h.buckets.end(); it++) {
+      *it >>= 1;
+      h.total += *it;
+    }
+  }
+}
+
+microseconds LatencyStatistics::percentile(const Histogram& h, double percentile)
+{
+  if (!h.total) {
+    return microseconds::zero();
+  }
+  auto rank = std::max(static_cast<uint64_t>(std::ceil(h.total * percentile / 100)), static_cast<uint64_t>(1));
+  uint64_t count = 0;
+  for (size_t i = 0; i < h.buckets.size(); i++) {
+    count += h.buckets[i];
+    if (count >= rank) {
+      return microseconds(bucketUpperBound(i));
+    }
+  }
+  return microseconds(bucketUpperBound(h.buckets.size() - 1));
+}
+
+LatencyStats LatencyStatistics::stats(const Histogram& h)
+{
+  return LatencyStats{
+      h.samples,
+      microseconds(static_cast<int64_t>(h.ewma)),
+      percentile(h, 50),
+      percentile(h, 99)
+  };
+}
+
+LatencyStats LatencyStatistics::get(OperationType type, SizeClass size)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = histograms.find(std::make_pair(type, size));
+  if (it == histograms.end()) {
+    return LatencyStats{0, microseconds::zero(), microseconds::zero(), microseconds::zero()};
+  }
+  return stats(it->second);
+}
+
+std::map<std::pair<OperationType, SizeClass>, LatencyStats> LatencyStatistics::get()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::map<std::pair<OperationType, SizeClass>, LatencyStats> result;
+  for (auto it = histograms.cbegin(); it != histograms.cend(); it++) {
+    result[it->first] = stats(it->second);
+  }
+  return result;
+}
+
+microseconds LatencyStatistics::percentile(OperationType type, SizeClass size, double p)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = histograms.find(std::make_pair(type, size));
+  if (it == histograms.end()) {
+    return microseconds::zero();
+  }
+  return percentile(it->second, p);
+}
+
+microseconds LatencyStatistics::timeout(OperationType type, microseconds max_timeout)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto p99 = microseconds::zero();
+  for (auto it = histograms.cbegin(); it != histograms.cend(); it++) {
+    if (it->first.first == type && it->second.samples >= min_samples) {
+      p99 = std::max(p99, percentile(it->second, 99));
+    }
+  }
+  if (p99 == microseconds::zero()) {
+    return max_timeout;
+  }
+  return std::min(std::max(p99 * timeout_factor, min_timeout), max_timeout);
+}
@@ -16,6 +16,8 @@
 #include "RedundancyProvider.hh"
 #include "Utility.hh"
 #include <isa-l.h>
+#include <algorithm>
+#include <cstring>
 
 using std::string;
 using std::make_shared;
@@ -23,94 +25,146 @@ using std::shared_ptr;
 using namespace kio;
 
 
-/* This function is (almost) completely ripped from the erasure_code_test.cc file
-   distributed with the isa-l library. */
-static int gf_gen_decode_matrix(
-    unsigned char* encode_matrix, // in: encode matrix
-    unsigned char* decode_matrix, // in: buffer, out: generated decode matrix
-    unsigned int* decode_index,  // out: order of healthy blocks used for decoding [data#1, data#3, ..., parity#1... ]
-    unsigned char* src_err_list,  // in: array of #nerrs size [index error #1, index error #2, ... ]
-    unsigned char* src_in_err,    // in: array of #data size > [1,0,0,0,1,0...] -> 0 == no error, 1 == error
-    unsigned int nerrs,                    // #total errors
-    unsigned int nsrcerrs,                 // #data errors
-    unsigned int k,                        // #data
-    unsigned int m                         // #data+parity
-)
+/* XOR the input blocks into the output block. Plain byte loops are vectorized by the compiler and, unlike the
+ * isa-l xor functions, do not require aligned buffers. */
+static void xor_blocks(unsigned char* const* inputs, size_t count, unsigned char* output, size_t length)
 {
-  unsigned i, j, p;
-  unsigned int r;
-  unsigned char* invert_matrix, * backup, * b, s;
-  int incr = 0;
-
-  std::vector<unsigned char> memory((size_t) (m * k * 3));
-  b = &memory[0];
-  backup = &memory[m * k];
-  invert_matrix = &memory[2 * m * k];
-
-  // Construct matrix b by removing error rows
-  for (i = 0, r = 0; i < k; i++, r++) {
-    while (src_in_err[r]) {
-      r++;
-    }
-    for (j = 0; j < k; j++) {
-      b[k * i + j] = encode_matrix[k * r + j];
-      backup[k * i + j] = encode_matrix[k * r + j];
+  memcpy(output, inputs[0], length);
+  for (size_t i = 1; i < count; i++) {
+    const unsigned char* input = inputs[i];
+    for (size_t b = 0; b < length; b++) {
+      output[b] ^= input[b];
     }
-    decode_index[i] = r;
   }
-  incr = 0;
-  while (gf_invert_matrix(b, invert_matrix, k) < 0) {
-    if (nerrs == (m - k)) {
-      return -1;
-    }
-    incr++;
-    memcpy(b, backup, (size_t) (m * k));
-    for (i = nsrcerrs; i < nerrs - nsrcerrs; i++) {
-      if (src_err_list[i] == (decode_index[k - 1] + incr)) {
-        // skip the erased parity line
-        incr++;
-        continue;
-      }
-    }
-    if (decode_index[k - 1] + incr >= m) {
-      return -1;
-    }
-    decode_index[k - 1] += incr;
-    for (j = 0; j < k; j++) {
-      b[k * (k - 1) + j] = encode_matrix[k * decode_index[k - 1] + j];
-    }
+}
 
-  };
+/* Select nData linearly independent rows of the encode matrix, skipping rows of missing blocks and preferring
+ * lower stripe indices (data blocks first). Rows are reduced to row echelon form as they are selected, so that
+ * codes where not every choice of nData rows is independent can be decoded whenever possible. */
+static bool select_rows(
+    const std::vector<unsigned char>& encode_matrix, // in: m x k encode matrix
+    uint64_t pattern,                                // in: error pattern, rows of missing blocks are skipped
+    size_t k,                                        // #data
+    size_t m,                                        // #data+parity
+    std::vector<unsigned int>& rows                  // out: indices of the selected rows
+)
+{
+  std::vector<std::vector<unsigned char>> echelon;
+  std::vector<size_t> pivots;
 
-  for (i = 0; i < nsrcerrs; i++) {
-    for (j = 0; j < k; j++) {
-      decode_matrix[k * i + j] = invert_matrix[k * src_err_list[i] + j];
+  for (size_t r = 0; r < m && rows.size() < k; r++) {
+    if (pattern & (1ULL << r)) {
+      continue;
     }
-  }
-  /* src_err_list from encode_matrix * invert of b for parity decoding */
-  for (p = nsrcerrs; p < nerrs; p++) {
-    for (i = 0; i < k; i++) {
-      s = 0;
-      for (j = 0; j < k; j++) {
-        s ^= gf_mul(invert_matrix[j * k + i],
-                    encode_matrix[k * src_err_list[p] + j]);
+    std::vector<unsigned char> row(encode_matrix.begin() + k * r, encode_matrix.begin() + k * (r + 1));
+    for (size_t b = 0; b < echelon.size(); b++) {
+      unsigned char f = row[pivots[b]];
+      if (f) {
+        for (size_t j = 0; j < k; j++) {
+          row[j] ^= gf_mul(f, echelon[b][j]);
+        }
       }
+    }
 
-      decode_matrix[k * p + i] = s;
+    size_t pivot = 0;
+    while (pivot < k && !row[pivot]) {
+      pivot++;
     }
+    if (pivot == k) {
+      continue;
+    }
+    unsigned char inv = gf_inv(row[pivot]);
+    for (size_t j = 0; j < k; j++) {
+      row[j] = gf_mul(row[j], inv);
+    }
+    echelon.push_back(std::move(row));
+    pivots.push_back(pivot);
+    rows.push_back(static_cast<unsigned int>(r));
   }
-  return 0;
+  return rows.size() == k;
 }
 
-RedundancyProvider::RedundancyProvider(std::size_t data, std::size_t parity) :
-    nData(data), nParity(parity), encode_matrix((nData + nParity) * nData)
+RedundancyProvider::RedundancyProvider(std::size_t data, std::size_t parity, Codec codec, std::size_t local,
+                                       std::shared_ptr<BufferPool> pool) :
+    nData(data), nParity(parity), nLocal(local), code(codec), bufferpool(std::move(pool)),
+    encode_matrix((nData + nParity) * nData), encode_pattern(0), index(), index_size(64), index_used(0), tables(), mutex()
 {
+  using utility::Convert;
+
+  if (nData + nParity > 64) {
+    throw std::invalid_argument(Convert::toString(
+        "ErasureCoding: Illegal stripe size. Maximum is 64, requested ", nData + nParity
+    ));
+  }
+  if (code == Codec::LRC ? (!nLocal || nLocal > nParity || nLocal > nData) : nLocal != 0) {
+    throw std::invalid_argument(Convert::toString(
+        "ErasureCoding: Illegal number of local parities ", nLocal, " for ", nData, "-", nParity, " stripes."
+    ));
+  }
+  if (code == Codec::XOR && nParity > 1) {
+    throw std::invalid_argument(Convert::toString(
+        "ErasureCoding: XOR code supports a single parity, requested ", nParity
+    ));
+  }
+
   // k = data
   // m = data + parity
-  gf_gen_cauchy1_matrix(encode_matrix.data(), static_cast<int>(nData + nParity), static_cast<int>(nData));
+  const int k = static_cast<int>(nData);
+  const int m = static_cast<int>(nData + nParity);
+  switch (code) {
+    case Codec::CAUCHY_RS:
+      gf_gen_cauchy1_matrix(encode_matrix.data(), m, k);
+      break;
+    case Codec::VANDERMONDE_RS:
+    case Codec::XOR:
+      /* The first parity row of the Vandermonde matrix is all 1s, which makes it the XOR parity. */
+      gf_gen_rs_matrix(encode_matrix.data(), m, k);
+      break;
+    case Codec::LRC: {
+      /* Local parities are the XOR of their group. Global parities are the Cauchy parities of a stripe with
+       * nParity - nLocal parity blocks. */
+      std::vector<unsigned char> global((nData + nParity - nLocal) * nData);
+      gf_gen_cauchy1_matrix(global.data(), m - static_cast<int>(nLocal), k);
+      std::copy(global.begin(), global.begin() + nData * nData, encode_matrix.begin());
+      for (size_t p = 0; p < nLocal; p++) {
+        for (size_t j = 0; j < nData; j++) {
+          encode_matrix[nData * (nData + p) + j] = localGroup(j) == p ? 1 : 0;
+        }
+      }
+      std::copy(global.begin() + nData * nData, global.end(), encode_matrix.begin() + nData * (nData + nLocal));
+      break;
+    }
+  }
+
+  for (size_t i = nData; i < nData + nParity; i++) {
+    encode_pattern |= 1ULL << i;
+  }
+
+  /* Leave enough room in the index for all patterns of up to two failures, so that the index stays sparse. */
+  const size_t n = nData + nParity;
+  while (index_size < 4 * (1 + n + n * (n - 1) / 2)) {
+    index_size *= 2;
+  }
+  index.reset(new std::atomic<const CodingTable*>[index_size]);
+  for (size_t i = 0; i < index_size; i++) {
+    index[i].store(NULL, std::memory_order_relaxed);
+  }
+
+  /* Replication and stripes without parity do not use coding tables. */
+  if (!nParity || nData == 1) {
+    return;
+  }
+
+  /* Precompute the tables for encoding (all parities missing) and for every single block failure, so that
+   * healthy puts and gets with a single failed drive never have to construct a table. */
+  std::lock_guard<std::mutex> lock(mutex);
+  addCodingTable(encode_pattern);
+  for (size_t i = 0; i < n; i++) {
+    addCodingTable(1ULL << i);
+  }
 }
 
-std::string RedundancyProvider::getErrorPattern(
+uint64_t RedundancyProvider::getErrorPattern(
     const std::vector<std::shared_ptr<const std::string> >& stripe
 ) const
 {
@@ -122,17 +176,16 @@ std::string RedundancyProvider::getErrorPattern(
     ));
   }
 
-  std::string pattern(nData + nParity, '0');
+  uint64_t pattern = 0;
   std::size_t nErrs = 0;
   std::size_t blockSize = 0;
 
   for (size_t i = 0; i < stripe.size(); i++) {
     if (!stripe[i] || stripe[i]->empty()) {
-      pattern[i] = 1;
+      pattern |= 1ULL << i;
       nErrs++;
     }
     else {
-      pattern[i] = 0;
       if (!blockSize) {
         blockSize = stripe[i]->size();
       }
@@ -153,67 +206,166 @@ std::string RedundancyProvider::getErrorPattern(
   return pattern;
 }
 
-RedundancyProvider::CodingTable& RedundancyProvider::getCodingTable(
-    const std::string& pattern
-)
+size_t RedundancyProvider::slot(uint64_t pattern) const
+{
+  pattern *= 0x9e3779b97f4a7c15ULL;
+  pattern ^= pattern >> 32;
+  return static_cast<size_t>(pattern) & (index_size - 1);
+}
+
+const RedundancyProvider::CodingTable* RedundancyProvider::findCodingTable(uint64_t pattern) const
+{
+  /* Slots are never cleared and the index is never more than half full, so probing terminates at an empty slot. */
+  for (size_t i = slot(pattern);; i = (i + 1) & (index_size - 1)) {
+    auto table = index[i].load(std::memory_order_acquire);
+    if (!table || table->pattern == pattern) {
+      return table;
+    }
+  }
+}
+
+const RedundancyProvider::CodingTable& RedundancyProvider::getCodingTable(uint64_t pattern)
 {
+  auto table = findCodingTable(pattern);
+  if (table) {
+    return *table;
+  }
+
   std::lock_guard<std::mutex> lock(mutex);
+  auto it = tables.find(pattern);
+  if (it != tables.end()) {
+    return *it->second;
+  }
+  return addCodingTable(pattern);
+}
+
+const RedundancyProvider::CodingTable& RedundancyProvider::addCodingTable(uint64_t pattern)
+{
+  auto table = makeCodingTable(pattern);
+  const CodingTable* result = table.get();
+  tables.insert(std::make_pair(pattern, std::move(table)));
+
+  /* Publish the fully constructed table to lock-free readers. Patterns that do not fit into the index any more
+   * (multiple failures on a large stripe) are served from the table map. */
+  if (2 * (index_used + 1) <= index_size) {
+    size_t i = slot(pattern);
+    while (index[i].load(std::memory_order_relaxed)) {
+      i = (i + 1) & (index_size - 1);
+    }
+    index[i].store(result, std::memory_order_release);
+    index_used++;
+  }
+  return *result;
+}
 
-  /* If decode matrix is not already cached we have to construct it. */
-  if (!cache.count(pattern)) {
+std::size_t RedundancyProvider::localGroup(std::size_t index) const
+{
+  if (index < nData) {
+    return index * nLocal / nData;
+  }
+  if (index < nData + nLocal) {
+    return index - nData;
+  }
+  return nLocal;
+}
 
-    /* Expand pattern */
-    int nerrs = 0, nsrcerrs = 0;
-    unsigned char err_indx_list[nParity];
-    for (std::uint8_t i = 0; i < pattern.size(); i++) {
-      if (pattern[i]) {
-        err_indx_list[nerrs++] = i;
-        if (i < nData) { nsrcerrs++; }
-      }
+std::unique_ptr<RedundancyProvider::CodingTable> RedundancyProvider::makeLocalCodingTable(std::size_t missing) const
+{
+  auto group = localGroup(missing);
+  if (group == nLocal) {
+    return std::unique_ptr<CodingTable>();
+  }
+
+  std::unique_ptr<CodingTable> dd(new CodingTable());
+  dd->pattern = 1ULL << missing;
+  dd->nErrors = 1;
+  dd->xorOnly = true;
+  for (size_t i = 0; i < nData + nLocal; i++) {
+    if (i != missing && localGroup(i) == group) {
+      dd->blockIndices.push_back(static_cast<unsigned int>(i));
     }
+  }
+  std::vector<unsigned char> decode_matrix(dd->blockIndices.size(), 1);
+  dd->table.resize(dd->blockIndices.size() * 32);
+  ec_init_tables(static_cast<int>(dd->blockIndices.size()), 1, decode_matrix.data(), dd->table.data());
+  return dd;
+}
 
-    /* Allocate Decode Object. */
-    CodingTable dd;
-    dd.nErrors = nerrs;
-    dd.blockIndices.resize(nData);
-    dd.table.resize(nData * nParity * 32);
-
-    /* Compute decode matrix. */
-    std::vector<unsigned char> decode_matrix((nData + nParity) * nData);
-
-    if (gf_gen_decode_matrix(
-        encode_matrix.data(),
-        decode_matrix.data(),
-        dd.blockIndices.data(),
-        err_indx_list,
-        (unsigned char*) pattern.c_str(),
-        nerrs,
-        nsrcerrs,
-        static_cast<int>(nData),
-        static_cast<int>(nParity + nData))
-        ) {
-      throw std::runtime_error("ErasureCoding: Failed computing decode matrix");
+std::unique_ptr<RedundancyProvider::CodingTable> RedundancyProvider::makeCodingTable(uint64_t pattern) const
+{
+  /* A single missing block of a local group is repaired from its group, reading far fewer blocks. */
+  if (code == Codec::LRC && !(pattern & (pattern - 1))) {
+    size_t missing = 0;
+    while (!(pattern & (1ULL << missing))) {
+      missing++;
     }
+    auto local = makeLocalCodingTable(missing);
+    if (local) {
+      return local;
+    }
+  }
+
+  /* Allocate Decode Object. */
+  std::unique_ptr<CodingTable> dd(new CodingTable());
+  dd->pattern = pattern;
+  dd->nErrors = 0;
+  dd->xorOnly = false;
+
+  if (!select_rows(encode_matrix, pattern, nData, nData + nParity, dd->blockIndices)) {
+    throw std::invalid_argument(utility::Convert::toString(
+        "ErasureCoding: Error pattern ", pattern, " cannot be recovered with the configured code."
+    ));
+  }
 
-    /* Compute Tables. */
-    ec_init_tables(static_cast<int>(nData), nerrs, decode_matrix.data(), dd.table.data());
-    cache.insert(std::make_pair(pattern, dd));
+  /* Invert the matrix formed by the encode matrix rows of the input blocks. */
+  std::vector<unsigned char> b(nData * nData);
+  std::vector<unsigned char> invert_matrix(nData * nData);
+  for (size_t i = 0; i < nData; i++) {
+    std::copy(encode_matrix.begin() + nData * dd->blockIndices[i],
+              encode_matrix.begin() + nData * (dd->blockIndices[i] + 1),
+              b.begin() + nData * i);
+  }
+  if (gf_invert_matrix(b.data(), invert_matrix.data(), static_cast<int>(nData)) < 0) {
+    throw std::runtime_error("ErasureCoding: Failed computing decode matrix");
+  }
+
+  /* Every missing block is its encode matrix row applied to the data blocks, which in turn are the inverted
+   * matrix applied to the input blocks. */
+  std::vector<unsigned char> decode_matrix;
+  for (size_t e = 0; e < nData + nParity; e++) {
+    if (!(pattern & (1ULL << e))) {
+      continue;
+    }
+    for (size_t i = 0; i < nData; i++) {
+      unsigned char s = 0;
+      for (size_t j = 0; j < nData; j++) {
+        s ^= gf_mul(encode_matrix[nData * e + j], invert_matrix[nData * j + i]);
+      }
+      decode_matrix.push_back(s);
+    }
+    dd->nErrors++;
   }
-  return cache.at(pattern);
+  dd->xorOnly = dd->nErrors == 1 &&
+                std::count(decode_matrix.begin(), decode_matrix.end(), 1) == static_cast<long>(nData);
+
+  /* Compute Tables. */
+  dd->table.resize(nData * dd->nErrors * 32);
+  ec_init_tables(static_cast<int>(nData), dd->nErrors, decode_matrix.data(), dd->table.data());
+  return dd;
 }
 
-void replication(std::vector<std::shared_ptr<const std::string> >& stripe, std::string& pattern)
+void replication(std::vector<std::shared_ptr<const std::string> >& stripe, uint64_t pattern)
 {
   size_t valid;
   /* get valid index */
-  for (valid = 0; valid < pattern.size(); valid++) {
-    if (!pattern[valid]) {
+  for (valid = 0; valid < stripe.size(); valid++) {
+    if (!(pattern & (1ULL << valid))) {
       break;
     }
   }
 
-  for (size_t i = 0; i < pattern.size(); i++) {
-    if (pattern[i]) {
+  for (size_t i = 0; i < stripe.size(); i++) {
+    if (pattern & (1ULL << i)) {
       stripe[i] = stripe[valid];
     }
   }
@@ -222,10 +374,10 @@ void replication(std::vector<std::shared_ptr<const std::string> >& stripe, std::
 void RedundancyProvider::compute(std::vector<std::shared_ptr<const std::string> >& stripe)
 {
   /* throws if stripe is not recoverable */
-  std::string pattern = getErrorPattern(stripe);
+  uint64_t pattern = getErrorPattern(stripe);
 
-  /* nothing to do if there are no parity blocks. */
-  if (!nParity) {
+  /* nothing to do if there are no parity blocks or no missing blocks. */
+  if (!nParity || !pattern) {
     return;
   }
 
@@ -234,40 +386,182 @@ void RedundancyProvider::compute(std::vector<std::shared_ptr<const std::string>
     return replication(stripe, pattern);
   }
 
+  /* Decode / encode directly into the strings that will be placed in the stripe. */
+  size_t blockSize = 0;
+  for (size_t i = 0; i < stripe.size() && !blockSize; i++) {
+    if (!(pattern & (1ULL << i))) {
+      blockSize = stripe[i]->size();
+    }
+  }
+  std::vector<std::shared_ptr<string>> outputs;
+  unsigned char* blocks[nData + nParity];
+  for (size_t i = 0; i < nData + nParity; i++) {
+    if (pattern & (1ULL << i)) {
+      outputs.push_back(allocate(blockSize));
+      blocks[i] = reinterpret_cast<unsigned char*>(&(*outputs.back())[0]);
+    }
+    else {
+      blocks[i] = (unsigned char*) stripe[i]->c_str();
+    }
+  }
+
+  computeBlocks(pattern, blocks, blockSize);
+
+  int e = 0;
+  for (size_t i = 0; i < nData + nParity; i++) {
+    if (pattern & (1ULL << i)) {
+      stripe[i] = outputs[e];
+      e++;
+    }
+  }
+}
+
+uint64_t RedundancyProvider::getErrorPattern(const std::vector<bool>& missing) const
+{
+  using utility::Convert;
+
+  if (missing.size() != nData + nParity) {
+    throw std::invalid_argument(Convert::toString(
+        "ErasureCoding: Illegal stripe size. Expected ", nData + nParity, ", observed ", missing.size()
+    ));
+  }
+
+  uint64_t pattern = 0;
+  std::size_t nErrs = 0;
+  for (size_t i = 0; i < missing.size(); i++) {
+    if (missing[i]) {
+      pattern |= 1ULL << i;
+      nErrs++;
+    }
+  }
+  if (nErrs > nParity) {
+    throw std::invalid_argument(Convert::toString(
+        "ErasureCoding: More errors than parity blocks. ", nErrs, " errors, ", nParity, " parities."
+    ));
+  }
+  return pattern;
+}
+
+void RedundancyProvider::checkBuffers(const std::vector<unsigned char*>& blocks) const
+{
+  using utility::Convert;
+
+  if (blocks.size() != nData + nParity) {
+    throw std::invalid_argument(Convert::toString(
+        "ErasureCoding: Illegal stripe size. Expected ", nData + nParity, ", observed ", blocks.size()
+    ));
+  }
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if (!blocks[i]) {
+      throw std::invalid_argument(Convert::toString("ErasureCoding: No buffer supplied for block ", i));
+    }
+  }
+}
+
+void RedundancyProvider::compute(const std::vector<unsigned char*>& blocks, const std::vector<bool>& missing,
+                                 std::size_t block_size)
+{
+  checkBuffers(blocks);
+  uint64_t pattern = getErrorPattern(missing);
+
+  if (!nParity || !pattern) {
+    return;
+  }
+  computeBlocks(pattern, blocks.data(), block_size);
+}
+
+void RedundancyProvider::update(std::size_t index, const unsigned char* old_block, const unsigned char* new_block,
+                                const std::vector<unsigned char*>& parities, std::size_t block_size)
+{
+  using utility::Convert;
+
+  if (index >= nData || parities.size() != nParity || !old_block || !new_block) {
+    throw std::invalid_argument(Convert::toString(
+        "ErasureCoding: Illegal update of data block ", index, " with ", parities.size(), " parity blocks."
+    ));
+  }
+  for (size_t i = 0; i < parities.size(); i++) {
+    if (!parities[i]) {
+      throw std::invalid_argument(Convert::toString("ErasureCoding: No buffer supplied for parity block ", i));
+    }
+  }
+  if (!nParity || old_block == new_block) {
+    return;
+  }
+
+  /* in case of a single data block, parities are replicas */
+  if (nData == 1) {
+    for (size_t i = 0; i < nParity; i++) {
+      memcpy(parities[i], new_block, block_size);
+    }
+    return;
+  }
+
+  /* Erasure coding is linear, so each parity changes by the encoded difference of the data block. The rows of
+   * the encoding table are ordered by parity index, its columns by data index. */
+  auto delta = allocate(block_size);
+  unsigned char* versions[] = {const_cast<unsigned char*>(old_block), const_cast<unsigned char*>(new_block)};
+  xor_blocks(versions, 2, reinterpret_cast<unsigned char*>(&(*delta)[0]), block_size);
+
+  auto& dd = getCodingTable(encode_pattern);
+  ec_encode_data_update(
+      static_cast<int>(block_size),   // Length of each block of data (vector) of source or destination data.
+      static_cast<int>(nData),        // The number of vector sources in the generator matrix for coding.
+      static_cast<int>(nParity),      // The number of output vectors to concurrently update.
+      static_cast<int>(index),        // The vector index corresponding to the single input source.
+      const_cast<unsigned char*>(dd.table.data()), // Pointer to array of input tables
+      reinterpret_cast<unsigned char*>(&(*delta)[0]), // Pointer to single input source used to update output parity
+      const_cast<unsigned char**>(parities.data())    // Array of pointers to coded output buffers
+  );
+}
+
+void RedundancyProvider::computeBlocks(uint64_t pattern, unsigned char* const* blocks, std::size_t block_size)
+{
+  /* in case of a single data block use replication */
+  if (nData == 1) {
+    size_t valid = 0;
+    while (pattern & (1ULL << valid)) {
+      valid++;
+    }
+    for (size_t i = 0; i < nData + nParity; i++) {
+      if (pattern & (1ULL << i)) {
+        memcpy(blocks[i], blocks[valid], block_size);
+      }
+    }
+    return;
+  }
+
   /* normal operation: erasure coding */
   auto& dd = getCodingTable(pattern);
 
-  unsigned char* inbuf[nData];
-  for (size_t i = 0; i < nData; i++) {
-    inbuf[i] = (unsigned char*) stripe[dd.blockIndices[i]]->c_str();
+  const size_t nInputs = dd.blockIndices.size();
+  unsigned char* inbuf[nInputs];
+  for (size_t i = 0; i < nInputs; i++) {
+    inbuf[i] = blocks[dd.blockIndices[i]];
   }
 
-  auto blockSize = stripe[dd.blockIndices[0]]->size();
-  std::vector<unsigned char> memory(dd.nErrors * blockSize);
-
+  /* Outputs are ordered by stripe index, as are the rows of the coding table. */
   unsigned char* outbuf[dd.nErrors];
-  for (int i = 0; i < dd.nErrors; i++) {
-    outbuf[i] = &memory[i * blockSize];
+  int e = 0;
+  for (size_t i = 0; i < nData + nParity; i++) {
+    if (pattern & (1ULL << i)) {
+      outbuf[e++] = blocks[i];
+    }
+  }
+
+  if (dd.xorOnly) {
+    xor_blocks(inbuf, nInputs, outbuf[0], block_size);
+    return;
   }
 
   ec_encode_data(
-      static_cast<int>(blockSize), // Length of each block of data (vector) of source or destination data.
-      static_cast<int>(nData),     // The number of vector sources in the generator matrix for coding.
+      static_cast<int>(block_size), // Length of each block of data (vector) of source or destination data.
+      static_cast<int>(nInputs),   // The number of vector sources in the generator matrix for coding.
       dd.nErrors,     // The number of output vectors to concurrently encode/decode.
-      dd.table.data(), // Pointer to array of input tables
+      const_cast<unsigned char*>(dd.table.data()), // Pointer to array of input tables
       inbuf,          // Array of pointers to source input buffers
       outbuf          // Array of pointers to coded output buffers
   );
-
-  int e = 0;
-  for (size_t i = 0; i < nData + nParity; i++) {
-    if (pattern[i]) {
-      stripe[i] = make_shared<const string>(
-          reinterpret_cast<char*>(outbuf[e]), blockSize
-      );
-      e++;
-    }
-  }
 }
 
 const std::size_t& RedundancyProvider::numData() const
@@ -280,7 +574,25 @@ const std::size_t& RedundancyProvider::numParity() const
   return nParity;
 }
 
+const std::size_t& RedundancyProvider::numLocalParity() const
+{
+  return nLocal;
+}
+
+RedundancyProvider::Codec RedundancyProvider::codec() const
+{
+  return code;
+}
+
 std::size_t RedundancyProvider::size() const
 {
   return nData + nParity;
-}
\ No newline at end of file
+}
+
+std::shared_ptr<std::string> RedundancyProvider::allocate(std::size_t size)
+{
+  if (bufferpool) {
+    return bufferpool->get(size);
+  }
+  return std::make_shared<std::string>(size, '\0');
+}
@@ -16,24 +16,28 @@
 #include "SocketListener.hh"
 #include "KineticAutoConnection.hh"
 #include "Logging.hh"
+#include "Utility.hh"
 #include <unistd.h>
+#include <algorithm>
 
 #ifdef __APPLE__
 #include <sys/event.h>
 //#include <kqueue/sys/event.h>
 #else
 #include <sys/epoll.h>
+#include <pthread.h>
+#include <sched.h>
 #endif
 
 using namespace kio;
 using kinetic::KineticStatus;
 using kinetic::StatusCode;
 
-void listener_thread(int main_fd, bool* shutdown)
+void listener_thread(int main_fd, std::atomic<bool>* shutdown)
 {
-  fd_set a;
+  utility::FdSet a;
   int fd = 0;
-  int max_events = 10;
+  const int max_events = 64;
 #ifdef __APPLE__
   struct kevent events[max_events];
 #else
@@ -54,13 +58,15 @@ void listener_thread(int main_fd, bool* shutdown)
     for (int i = 0; i < ret; i++) {
 
 #ifdef __APPLE__
-      auto con = (KineticAutoConnection*) events[i].udata;
+      auto con = (PooledConnection*) events[i].udata;
 #else
-      auto con = (KineticAutoConnection*) events[i].data.ptr;
+      auto con = (PooledConnection*) events[i].data.ptr;
 #endif
       if (con) {
         try {
-          if (!con->get()->Run(&a, &a, &fd)) {
+          auto kcon = con->get();
+          if (!kcon->Run(a.get(), a.get(), &fd)) {
+            con->setError(kcon);
             throw std::runtime_error("Connection::Run(...) returned false");
           }
         } catch (const std::exception& e) {
@@ -75,23 +81,17 @@ void listener_thread(int main_fd, bool* shutdown)
   kio_debug("listener thread exiting.");
 }
 
-SocketListener::SocketListener() :
-    shutdown(false)
+SocketListener::SocketListener(size_t threads, bool pinning) :
+    active(0), pinned(pinning), shutdown(false)
 {
-  /* Create the epoll / kqueue  descriptor. Only one is needed, and is used to monitor all sockets.*/
-#ifdef __APPLE__
-  listener_fd = kqueue();
-#else
-  listener_fd = epoll_create1(0);
-#endif
-
-  if (listener_fd < 0) {
-    kio_error("Failed setting up fd listener");
-    throw std::system_error(errno, std::generic_category());
+  std::lock_guard<std::mutex> lock(mutex);
+  active = std::max(threads, static_cast<size_t>(1));
+  while (listeners.size() < active) {
+    addListener();
+  }
+  if (pinned) {
+    setAffinity();
   }
-  kio_debug("set up listener_fd at ", listener_fd);
-
-  listener = std::thread(listener_thread, listener_fd, &shutdown);
 }
 
 SocketListener::~SocketListener()
@@ -99,31 +99,108 @@ SocketListener::~SocketListener()
   int pipefd[2];
   pipe(pipefd);
 
+  /* A single pipe wakes up all listener threads. */
+  for (auto it = listener_fds.cbegin(); it != listener_fds.cend(); it++) {
 #ifdef __APPLE__
-  struct kevent e;
-  EV_SET(&e, pipefd[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
-  kevent(listener_fd, &e, 1, NULL, 0, NULL);
+    struct kevent e;
+    EV_SET(&e, pipefd[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+    kevent(*it, &e, 1, NULL, 0, NULL);
 #else
-  struct epoll_event e;
-  e.events = EPOLLIN | EPOLLOUT;
-  e.data.ptr = NULL;
-  epoll_ctl(listener_fd, EPOLL_CTL_ADD, pipefd[0], &e);
+    struct epoll_event e;
+    e.events = EPOLLIN | EPOLLOUT;
+    e.data.ptr = NULL;
+    epoll_ctl(*it, EPOLL_CTL_ADD, pipefd[0], &e);
 #endif
+  }
 
   shutdown = true;
   write(pipefd[1], "0", 1);
 
-  listener.join();
+  for (auto it = listeners.begin(); it != listeners.end(); it++) {
+    it->join();
+  }
   close(pipefd[0]);
   close(pipefd[1]);
-  close(listener_fd);
-  listener_fd=0;
+  for (auto it = listener_fds.cbegin(); it != listener_fds.cend(); it++) {
+    close(*it);
+  }
 }
 
+void SocketListener::addListener()
+{
+  /* Create the epoll / kqueue descriptor, used to monitor all sockets of this listener thread. */
+#ifdef __APPLE__
+  int listener_fd = kqueue();
+#else
+  int listener_fd = epoll_create1(0);
+#endif
 
+  if (listener_fd < 0) {
+    kio_error("Failed setting up fd listener");
+    throw std::system_error(errno, std::generic_category());
+  }
+  kio_debug("set up listener_fd at ", listener_fd);
 
-void SocketListener::subscribe(int fd, kio::KineticAutoConnection* connection)
+  listener_fds.push_back(listener_fd);
+  listeners.push_back(std::thread(listener_thread, listener_fd, &shutdown));
+}
+
+void SocketListener::setAffinity()
 {
+#ifndef __APPLE__
+  /* Unpinned listener threads use the affinity of the calling thread, as they would if they had been spawned by it. */
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(cpu_set_t), &allowed);
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  for (size_t i = 0; i < listeners.size(); i++) {
+    cpu_set_t set = allowed;
+    if (pinned && !cpus.empty()) {
+      CPU_ZERO(&set);
+      CPU_SET(cpus[i % cpus.size()], &set);
+    }
+    auto rtn = pthread_setaffinity_np(listeners[i].native_handle(), sizeof(cpu_set_t), &set);
+    if (rtn) {
+      kio_warning("Failed setting cpu affinity of listener thread ", i, ". errno=", rtn);
+    }
+  }
+#endif
+}
+
+void SocketListener::changeConfiguration(size_t threads, bool pinning)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  active = std::max(threads, static_cast<size_t>(1));
+  while (listeners.size() < active) {
+    addListener();
+  }
+  if (pinning || pinned) {
+    pinned = pinning;
+    setAffinity();
+  }
+}
+
+void SocketListener::subscribe(int fd, kio::PooledConnection* connection)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  /* File descriptors are assigned to the active listener thread with the fewest subscriptions. Hashing the fd is not
+   * sufficient, as descriptors are allocated sequentially and often in a regular pattern. */
+  std::vector<size_t> load(active, 0);
+  for (auto it = subscriptions.cbegin(); it != subscriptions.cend(); it++) {
+    auto index = std::find(listener_fds.begin(), listener_fds.end(), it->second) - listener_fds.begin();
+    if (static_cast<size_t>(index) < active) {
+      load[index]++;
+    }
+  }
+  auto listener_fd = listener_fds[std::min_element(load.begin(), load.end()) - load.begin()];
+
   int rtn;
 #ifdef __APPLE__
   struct kevent e[2];
@@ -146,11 +223,51 @@ void SocketListener::subscribe(int fd, kio::KineticAutoConnection* connection)
     kio_error("failed adding fd ", fd, " to listener. ernno=", errno, " ", connection->getName());
     throw std::system_error(errno, std::generic_category());
   }
+  subscriptions[fd] = listener_fd;
   kio_debug("Added fd ", fd, " for connection ", connection->getName(), " to listening queue.");
 }
 
+bool SocketListener::notify(int fd, kio::PooledConnection* connection)
+{
+  int listener_fd;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!subscriptions.count(fd)) {
+      return false;
+    }
+    listener_fd = subscriptions.at(fd);
+  }
+
+  /* Modifying an edge triggered registration re-evaluates readiness, so the listener thread is woken up if the
+   * socket is writable right away and otherwise as soon as it becomes writable. */
+  int rtn;
+#ifdef __APPLE__
+  struct kevent e;
+  EV_SET(&e, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE | EV_CLEAR, 0, 0, connection);
+  rtn = kevent(listener_fd, &e, 1, 0, 0, 0);
+#else
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+  ev.data.ptr = connection;
+  rtn = epoll_ctl(listener_fd, EPOLL_CTL_MOD, fd, &ev);
+#endif
+  if (rtn < 0) {
+    kio_debug("failed to re-arm fd ", fd, " for connection ", connection->getName(), ". errno=", errno);
+    return false;
+  }
+  return true;
+}
+
 void SocketListener::unsubscribe(int fd)
 {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!subscriptions.count(fd)) {
+    kio_debug("fd ", fd, " is not subscribed to any listener.");
+    return;
+  }
+  auto listener_fd = subscriptions.at(fd);
+  subscriptions.erase(fd);
+
   int rtn;
 #ifdef __APPLE__
   struct kevent e[2];
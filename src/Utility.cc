@@ -15,7 +15,9 @@
 
 #include "Utility.hh"
 #include <iomanip>
+#include <algorithm>
 #include <uuid/uuid.h>
+#include <sys/resource.h>
 
 using namespace kio;
 
@@ -148,3 +150,20 @@ std::shared_ptr<const std::string> utility::indicatorToKey(const std::string& in
 {
   return std::make_shared<const std::string>(indicator_key.substr(strlen("indicator:"), std::string::npos));
 }
+
+utility::FdSet::FdSet()
+{
+  /* An unlimited fd limit is capped, fds beyond a million are not realistic. */
+  size_t limit = FD_SETSIZE;
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+    limit = rl.rlim_cur == RLIM_INFINITY ? 1024 * 1024 : std::max(limit, static_cast<size_t>(rl.rlim_cur));
+  }
+  const size_t bits_per_long = 8 * sizeof(long);
+  bits.resize(std::max((limit + bits_per_long - 1) / bits_per_long, sizeof(fd_set) / sizeof(long)), 0);
+}
+
+fd_set* utility::FdSet::get()
+{
+  return reinterpret_cast<fd_set*>(bits.data());
+}
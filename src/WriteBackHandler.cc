@@ -0,0 +1,257 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "WriteBackHandler.hh"
+#include "FileIo.hh"
+#include "Logging.hh"
+
+using namespace kio;
+using std::chrono::system_clock;
+
+const std::chrono::seconds WriteBackHandler::expiration_time(5);
+
+WriteBackHandler::WriteBackHandler(size_t dirty_limit, size_t high_watermark, size_t low_watermark,
+                                   size_t worker_threads) :
+    limit(dirty_limit), high(std::min(high_watermark, dirty_limit)), low(std::min(low_watermark, high)),
+    dirty_bytes(0), flushing_bytes(0), draining(false), waiting(0), complete(), partial(), lookup(), flushing(),
+    drained(), workers(), shutdown(false)
+{
+  restart_workers(worker_threads);
+}
+
+WriteBackHandler::~WriteBackHandler()
+{
+  restart_workers(0);
+}
+
+void WriteBackHandler::changeConfiguration(size_t dirty_limit, size_t high_watermark, size_t low_watermark,
+                                           size_t worker_threads)
+{
+  size_t num_workers;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit = dirty_limit;
+    high = std::min(high_watermark, limit);
+    low = std::min(low_watermark, high);
+    num_workers = workers.size();
+  }
+  work.notify_all();
+  progress.notify_all();
+
+  if (num_workers != worker_threads) {
+    restart_workers(worker_threads);
+  }
+}
+
+void WriteBackHandler::restart_workers(size_t worker_threads)
+{
+  std::vector<std::thread> stopping;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shutdown = true;
+    stopping.swap(workers);
+  }
+  work.notify_all();
+  for (auto it = stopping.begin(); it != stopping.end(); it++) {
+    it->join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  shutdown = false;
+  for (size_t i = 0; i < worker_threads; i++) {
+    workers.push_back(std::thread(&WriteBackHandler::worker_thread, this));
+  }
+}
+
+size_t WriteBackHandler::dirtyBytes()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return dirty_bytes;
+}
+
+bool WriteBackHandler::take(Entry& entry, bool force)
+{
+  /* Partial blocks are flushed from reaching the high watermark until reaching the low watermark. Writers blocked
+   * by the dirty limit would otherwise have to wait for partial blocks to expire if the high watermark is close to
+   * the limit, so partial blocks are flushed as well while any writer is waiting. */
+  size_t pending = dirty_bytes - flushing_bytes;
+  if (pending >= high || waiting) {
+    draining = true;
+  }
+  else if (pending < low) {
+    draining = false;
+  }
+
+  entry_iterator it;
+  if (!complete.empty()) {
+    it = complete.begin();
+  }
+  else if (!partial.empty() &&
+           (force || draining || partial.front().dirty_since + expiration_time < system_clock::now())) {
+    it = partial.begin();
+  }
+  else {
+    return false;
+  }
+
+  entry = *it;
+  lookup.erase(it->block.get());
+  if (it->complete) {
+    complete.erase(it);
+  }
+  else {
+    partial.erase(it);
+  }
+  flushing[entry.owner]++;
+  flushing_bytes += entry.block->capacity();
+  return true;
+}
+
+void WriteBackHandler::flush(std::unique_lock<std::mutex>& lock, const Entry& entry)
+{
+  lock.unlock();
+  try {
+    entry.owner->doFlush(entry.block);
+  }
+  catch (const std::exception& e) {
+    kio_warning("Exception in background flush of data block ", entry.block->getIdentity(), ": ", e.what());
+  }
+  lock.lock();
+
+  flushing_bytes -= entry.block->capacity();
+  dirty_bytes -= entry.block->capacity();
+  std::vector<std::function<void()>> callbacks;
+  if (--flushing[entry.owner] == 0) {
+    flushing.erase(entry.owner);
+    auto it = drained.find(entry.owner);
+    if (it != drained.end()) {
+      callbacks.swap(it->second);
+      drained.erase(it);
+    }
+  }
+  progress.notify_all();
+
+  if (!callbacks.empty()) {
+    lock.unlock();
+    for (auto it = callbacks.begin(); it != callbacks.end(); it++) {
+      (*it)();
+    }
+    lock.lock();
+  }
+}
+
+void WriteBackHandler::worker_thread()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!shutdown) {
+    Entry entry = Entry();
+    if (take(entry, false)) {
+      flush(lock, entry);
+      continue;
+    }
+
+    /* Sleep until the oldest partial block expires or more blocks are registered. */
+    auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(expiration_time);
+    if (!partial.empty()) {
+      timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+          partial.front().dirty_since + expiration_time - system_clock::now()
+      ) + std::chrono::milliseconds(1);
+    }
+    work.wait_for(lock, timeout);
+  }
+}
+
+void WriteBackHandler::add(kio::FileIo* owner, const std::shared_ptr<kio::DataBlock>& block, bool complete_block)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  auto existing = lookup.find(block.get());
+  if (existing != lookup.end()) {
+    if (complete_block && !existing->second->complete) {
+      existing->second->complete = true;
+      complete.splice(complete.end(), partial, existing->second);
+      work.notify_one();
+    }
+  }
+  else {
+    /* Back-pressure: wait for flushes to complete if the new block would exceed the dirty limit. */
+    while (dirty_bytes && dirty_bytes + block->capacity() > limit) {
+      Entry entry = Entry();
+      if (workers.empty() && take(entry, true)) {
+        flush(lock, entry);
+      }
+      else {
+        waiting++;
+        work.notify_all();
+        progress.wait(lock);
+        waiting--;
+      }
+    }
+
+    auto& queue = complete_block ? complete : partial;
+    queue.push_back(Entry{block, owner, system_clock::now(), complete_block});
+    lookup[block.get()] = --queue.end();
+    dirty_bytes += block->capacity();
+    if (complete_block || dirty_bytes - flushing_bytes >= high) {
+      work.notify_one();
+    }
+  }
+
+  /* Without worker threads, due flushes are executed by the writing threads. */
+  Entry entry = Entry();
+  while (workers.empty() && take(entry, false)) {
+    flush(lock, entry);
+  }
+}
+
+void WriteBackHandler::discard(kio::FileIo* owner)
+{
+  std::list<Entry>* queues[] = {&complete, &partial};
+  for (auto q = std::begin(queues); q != std::end(queues); q++) {
+    for (auto it = (*q)->begin(); it != (*q)->end();) {
+      if (it->owner == owner) {
+        lookup.erase(it->block.get());
+        dirty_bytes -= it->block->capacity();
+        it = (*q)->erase(it);
+      }
+      else {
+        it++;
+      }
+    }
+  }
+  progress.notify_all();
+}
+
+void WriteBackHandler::drop(kio::FileIo* owner)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  discard(owner);
+  while (flushing.count(owner)) {
+    progress.wait(lock);
+  }
+}
+
+void WriteBackHandler::dropAsync(kio::FileIo* owner, std::function<void()> callback)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    discard(owner);
+    if (flushing.count(owner)) {
+      drained[owner].push_back(std::move(callback));
+      return;
+    }
+  }
+  callback();
+}
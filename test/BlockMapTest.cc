@@ -0,0 +1,68 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "BlockMap.hh"
+#include "catch.hpp"
+
+using namespace kio;
+
+SCENARIO("BlockMap Test", "[BlockMap]"){
+
+  GIVEN ("An empty block map"){
+    BlockMap<int> map(8);
+    REQUIRE((map.size() == 0));
+    REQUIRE((map.find(1, 1) == NULL));
+
+    WHEN("Inserting more blocks than the initial capacity"){
+      for (int i = 0; i < 100; i++) {
+        map.insert(i % 3, i, i);
+      }
+
+      THEN("all of them can be found"){
+        REQUIRE((map.size() == 100));
+        for (int i = 0; i < 100; i++) {
+          REQUIRE(map.find(i % 3, i));
+          REQUIRE((*map.find(i % 3, i) == i));
+        }
+        REQUIRE((map.find(0, 1) == NULL));
+      }
+
+      THEN("inserting an existing block replaces its value"){
+        map.insert(0, 0, 42);
+        REQUIRE((map.size() == 100));
+        REQUIRE((*map.find(0, 0) == 42));
+      }
+
+      AND_WHEN("every other block is erased"){
+        for (int i = 0; i < 100; i += 2) {
+          REQUIRE(map.erase(i % 3, i));
+        }
+
+        THEN("only the remaining blocks can be found"){
+          REQUIRE((map.size() == 50));
+          for (int i = 0; i < 100; i++) {
+            if (i % 2) {
+              REQUIRE((*map.find(i % 3, i) == i));
+            }
+            else {
+              REQUIRE((map.find(i % 3, i) == NULL));
+            }
+          }
+          REQUIRE_FALSE(map.erase(0, 0));
+        }
+      }
+    }
+  }
+}
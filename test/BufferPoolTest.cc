@@ -0,0 +1,89 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "BufferPool.hh"
+#include "catch.hpp"
+
+using namespace kio;
+using std::string;
+
+SCENARIO("BufferPool Test", "[BufferPool]"){
+
+  GIVEN ("A buffer pool with a capacity of 100 bytes pooling 64 byte buffers"){
+    std::set<std::size_t> sizes;
+    sizes.insert(64);
+    auto pool = std::make_shared<BufferPool>(100, sizes);
+
+    WHEN("A buffer is obtained"){
+      auto buffer = pool->get(64);
+
+      THEN("it has the requested size and is reported in use"){
+        REQUIRE((buffer->size() == 64));
+        REQUIRE((pool->inUse() == 1));
+        REQUIRE((pool->cached() == 0));
+      }
+
+      AND_WHEN("it is released"){
+        auto address = buffer.get();
+        buffer.reset();
+
+        THEN("it is kept for re-use"){
+          REQUIRE((pool->inUse() == 0));
+          REQUIRE((pool->cached() == 64));
+        }
+
+        THEN("the next request of the same size re-uses it"){
+          auto again = pool->get(64);
+          REQUIRE((again.get() == address));
+          REQUIRE((pool->cached() == 0));
+        }
+
+        THEN("reducing pool capacity releases it"){
+          pool->changeConfiguration(10, sizes);
+          REQUIRE((pool->cached() == 0));
+        }
+
+        THEN("no longer pooling its size releases it"){
+          pool->changeConfiguration(100, std::set<std::size_t>());
+          REQUIRE((pool->cached() == 0));
+        }
+      }
+    }
+
+    WHEN("More buffers than fit into the pool capacity are released"){
+      auto first = pool->get(64);
+      auto second = pool->get(64);
+      REQUIRE((pool->inUse() == 2));
+      first.reset();
+      second.reset();
+
+      THEN("only buffers fitting into the capacity are kept"){
+        REQUIRE((pool->inUse() == 0));
+        REQUIRE((pool->cached() == 64));
+      }
+    }
+
+    WHEN("A buffer of a size that is not pooled is released"){
+      auto buffer = pool->get(32);
+      REQUIRE((pool->inUse() == 1));
+      buffer.reset();
+
+      THEN("it is not kept"){
+        REQUIRE((pool->inUse() == 0));
+        REQUIRE((pool->cached() == 0));
+      }
+    }
+  }
+}
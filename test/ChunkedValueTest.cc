@@ -0,0 +1,145 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "ChunkedValue.hh"
+#include "catch.hpp"
+#include <cstring>
+#include <stdexcept>
+
+using namespace kio;
+using std::string;
+
+SCENARIO("ChunkedValue Test", "[ChunkedValue]"){
+
+  GIVEN ("An empty value with a chunk capacity of 10 bytes"){
+    ChunkedValue value(10);
+    REQUIRE((value.size() == 0));
+    REQUIRE(value.chunks().empty());
+
+    WHEN("Writing across chunk boundaries"){
+      string data("abcdefghijklmnopqrstuvwxyz");
+      value.write(data.data(), 5, data.size());
+
+      THEN("the value is split into chunks of chunk capacity"){
+        REQUIRE((value.size() == 31));
+        REQUIRE((value.chunks().size() == 4));
+        for (auto it = value.chunks().cbegin(); it != value.chunks().cend(); it++) {
+          REQUIRE(((*it)->size() == 10));
+        }
+      }
+
+      THEN("written data can be read again, with the region before the write offset reading as 0s"){
+        char buf[31];
+        value.read(buf, 0, 31);
+        REQUIRE((memcmp(buf, string(5, '\0').data(), 5) == 0));
+        REQUIRE((memcmp(buf + 5, data.data(), data.size()) == 0));
+        REQUIRE((*value.toString() == string(5, '\0') + data));
+      }
+
+      THEN("reading past the value size returns 0s"){
+        char buf[10];
+        memset(buf, 'x', 10);
+        value.read(buf, 28, 10);
+        REQUIRE((memcmp(buf, "xyz", 3) == 0));
+        REQUIRE((memcmp(buf + 3, string(7, '\0').data(), 7) == 0));
+      }
+
+      AND_WHEN("the value is truncated and grown again"){
+        value.resize(7);
+        REQUIRE((value.chunks().size() == 1));
+        value.resize(20);
+
+        THEN("the truncated region reads as 0s"){
+          REQUIRE((*value.toString() == string(5, '\0') + "ab" + string(13, '\0')));
+        }
+      }
+
+      AND_WHEN("the value is truncated within a chunk"){
+        value.resize(7);
+
+        THEN("the chunk no longer contains data past the value size"){
+          REQUIRE((*value.chunks()[0] == string(5, '\0') + "ab" + string(3, '\0')));
+        }
+      }
+    }
+
+    WHEN("A chunk is shared with another owner"){
+      value.write("0123456789", 0, 10);
+      auto shared = value.chunks().front();
+      value.write("x", 0, 1);
+
+      THEN("it is not modified by writing to the value"){
+        REQUIRE((*shared == "0123456789"));
+        REQUIRE((*value.toString() == "x123456789"));
+      }
+    }
+
+    WHEN("A chunk has been handed out and released again"){
+      value.write("0123456789", 0, 10);
+      auto handed_out = value.chunks().front().get();
+      value.write("x", 0, 1);
+
+      THEN("it is still copied before being modified"){
+        REQUIRE((value.chunks().front().get() != handed_out));
+        REQUIRE((*value.toString() == "x123456789"));
+      }
+    }
+  }
+
+  GIVEN ("A value constructed from existing chunks"){
+    std::vector<std::shared_ptr<const string>> chunks;
+    chunks.push_back(std::make_shared<const string>("0123456789"));
+    chunks.push_back(std::make_shared<const string>("abc"));
+    ChunkedValue value(10, chunks, 13);
+
+    THEN("chunks are shared, not copied"){
+      REQUIRE((value.chunks()[0].get() == chunks[0].get()));
+      REQUIRE((value.chunks()[1].get() == chunks[1].get()));
+      REQUIRE((*value.toString() == "0123456789abc"));
+    }
+
+    THEN("writing to it copies the chunk before modifying it"){
+      value.write("X", 11, 1);
+      REQUIRE((*chunks[1] == "abc"));
+      REQUIRE((*value.toString() == "0123456789aXc"));
+      REQUIRE((value.chunks()[0].get() == chunks[0].get()));
+    }
+
+    THEN("a copy shares all chunks until it is written to"){
+      ChunkedValue copy(value);
+      REQUIRE((copy.chunks()[0].get() == chunks[0].get()));
+      copy.write("X", 0, 1);
+      REQUIRE((copy.chunks()[0].get() != chunks[0].get()));
+      REQUIRE((copy.chunks()[1].get() == chunks[1].get()));
+      REQUIRE((*value.toString() == "0123456789abc"));
+    }
+
+    THEN("a copy shares the encoding the value has been written with"){
+      auto encoding = std::make_shared<ChunkedValue::Encoding>();
+      encoding->data = chunks;
+      value.setEncoding(encoding);
+      ChunkedValue copy(value);
+      REQUIRE((copy.encoding() == value.encoding()));
+      copy.setEncoding(std::shared_ptr<const ChunkedValue::Encoding>());
+      REQUIRE((!copy.encoding()));
+      REQUIRE((value.encoding().get() == encoding.get()));
+    }
+
+    THEN("chunks exceeding chunk capacity are rejected"){
+      chunks.push_back(std::make_shared<const string>(11, 'x'));
+      REQUIRE_THROWS_AS((ChunkedValue(10, chunks, 31)), std::invalid_argument);
+    }
+  }
+}
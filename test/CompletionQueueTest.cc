@@ -0,0 +1,130 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include <unistd.h>
+#include "CompletionQueue.hh"
+#include "catch.hpp"
+
+using namespace kio;
+using namespace kinetic;
+using std::chrono::system_clock;
+
+namespace {
+/* An operation vector that is never submitted, results are supplied by the test. */
+class TestOperation : public KineticClusterOperation {
+public:
+  void complete(size_t index)
+  {
+    operations[index].callback->OnResult(KineticStatus(StatusCode::OK, ""));
+  }
+
+  TestOperation(std::vector<std::unique_ptr<KineticAutoConnection>>& connections, size_t size) :
+      KineticClusterOperation(connections)
+  {
+    for (size_t i = 0; i < size; i++) {
+      operations.push_back(
+          KineticAsyncOperation{
+              0,
+              std::make_shared<BasicCallback>(sync),
+              NULL,
+              std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection>(),
+              0,
+              system_clock::time_point()
+          }
+      );
+    }
+  }
+};
+
+void setFlag(std::shared_ptr<std::atomic<bool>> flag)
+{
+  *flag = true;
+}
+
+bool waitFlag(const std::shared_ptr<std::atomic<bool>>& flag, int milliseconds)
+{
+  for (int i = 0; i < milliseconds / 10 && !*flag; i++) {
+    usleep(10 * 1000);
+  }
+  return *flag;
+}
+}
+
+SCENARIO("CompletionQueue Test", "[Completion]")
+{
+  std::vector<std::unique_ptr<KineticAutoConnection>> connections;
+
+  GIVEN ("A completion queue and an operation with two outstanding results") {
+    auto op = std::make_shared<TestOperation>(connections, 2);
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    std::unique_ptr<CompletionQueue> queue(new CompletionQueue(2, 10));
+
+    THEN("the completion function is executed once all results are available") {
+      queue->add(op, system_clock::now() + std::chrono::seconds(10), system_clock::time_point::max(),
+                 std::bind(setFlag, done));
+      op->complete(0);
+      REQUIRE_FALSE(waitFlag(done, 100));
+      op->complete(1);
+      REQUIRE(waitFlag(done, 1000));
+    }
+
+    THEN("the completion function is executed at the deadline even if results are outstanding") {
+      queue->add(op, system_clock::now() + std::chrono::seconds(10), system_clock::now() + std::chrono::milliseconds(100),
+                 std::bind(setFlag, done));
+      REQUIRE(waitFlag(done, 1000));
+    }
+
+    THEN("the completion function is executed once the operation timed out") {
+      queue->add(op, system_clock::now() + std::chrono::milliseconds(100), system_clock::time_point::max(),
+                 std::bind(setFlag, done));
+      REQUIRE(waitFlag(done, 1000));
+    }
+
+    THEN("a scheduled function is executed once its time has passed") {
+      auto start = system_clock::now();
+      queue->schedule(start + std::chrono::milliseconds(100), std::bind(setFlag, done));
+      REQUIRE(waitFlag(done, 1000));
+      REQUIRE((system_clock::now() >= start + std::chrono::milliseconds(100)));
+    }
+
+    THEN("destructing the queue executes pending completion functions") {
+      queue->add(op, system_clock::now() + std::chrono::seconds(10), system_clock::time_point::max(),
+                 std::bind(setFlag, done));
+      queue.reset();
+      REQUIRE(*done);
+    }
+  }
+
+  GIVEN ("A completion queue with a single worker and a queue depth of 1") {
+    std::unique_ptr<CompletionQueue> queue(new CompletionQueue(1, 1));
+    auto release = std::make_shared<std::atomic<bool>>(false);
+    std::vector<std::shared_ptr<std::atomic<bool>>> done;
+    for (int i = 0; i < 4; i++) {
+      done.push_back(std::make_shared<std::atomic<bool>>(false));
+    }
+
+    THEN("completion functions exceeding the queue depth are held back until the worker is available") {
+      queue->schedule(system_clock::now(), std::bind(waitFlag, release, 10000));
+      for (size_t i = 0; i < done.size(); i++) {
+        queue->schedule(system_clock::now(), std::bind(setFlag, done[i]));
+      }
+      REQUIRE_FALSE(waitFlag(done.back(), 100));
+      *release = true;
+      for (size_t i = 0; i < done.size(); i++) {
+        REQUIRE(waitFlag(done[i], 1000));
+      }
+    }
+  }
+}
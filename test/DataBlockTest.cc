@@ -98,6 +98,38 @@ SCENARIO("DataBlock integration test.", "[Data]")
             REQUIRE_FALSE(data.dirty());
           }
 
+          AND_WHEN("Another block overwrites the complete value without reading it.") {
+            DataBlock x(cluster, std::make_shared<std::string>("key"));
+            std::string value(cluster->limits().max_value_size, 'x');
+            REQUIRE_NOTHROW(x.write(value.data(), 0, 10));
+            REQUIRE(x.flushRequiresRemoteValue());
+            REQUIRE_NOTHROW(x.write(value.data(), 10, value.size() - 10));
+            REQUIRE_FALSE(x.flushRequiresRemoteValue());
+            REQUIRE_NOTHROW(x.flush());
+
+            THEN("The on-drive value is replaced.") {
+              DataBlock y(cluster, std::make_shared<std::string>("key"));
+              char out[10];
+              REQUIRE_NOTHROW(y.read(out, 0, 10));
+              REQUIRE((memcmp(value.data(), out, 10) == 0));
+              REQUIRE((y.size() == value.size()));
+            }
+          }
+
+          AND_WHEN("Another block truncates the value without reading it.") {
+            DataBlock x(cluster, std::make_shared<std::string>("key"));
+            REQUIRE_NOTHROW(x.truncate(2));
+            REQUIRE(x.flushRequiresRemoteValue());
+            REQUIRE_NOTHROW(x.write(in, 0, 2));
+            REQUIRE_FALSE(x.flushRequiresRemoteValue());
+            REQUIRE_NOTHROW(x.flush());
+
+            THEN("The on-drive value has the truncated size.") {
+              DataBlock y(cluster, std::make_shared<std::string>("key"));
+              REQUIRE((y.size() == 2));
+            }
+          }
+
           AND_WHEN("The on-drive value is manipulated by someone else.") {
             DataBlock x(cluster, std::make_shared<std::string>("key"));
             REQUIRE_NOTHROW(x.write("99", 0, 2));
@@ -119,6 +119,8 @@ public:
     _limits.max_key_size = 4096;
     _limits.max_value_size = 128;
     _limits.max_version_size = 4096;
+    _limits.chunk_size = 128;
+    _limits.parity_size = 0;
     _version = utility::uuidGenerateEncodeSize(128);
     _value = std::make_shared<const string>('x', 128);
   }
@@ -151,6 +153,79 @@ SCENARIO("Cache Performance Test.", "[Cache]")
 {
   GIVEN("A Cache Object and a mocked FileIo object") {
 
+    THEN("cache capacity is enforced over all shards") {
+      DataCache ccc(100 * 128, 16);
+      std::shared_ptr<ClusterInterface> cluster(new MockCluster());
+      MockFileIo fio("kinetic://Cluster1/thepath", cluster);
+
+      for (int i = 0; i < 300; i++) {
+        ccc.getDataKey((FileIo*) &fio, i, DataBlock::Mode::STANDARD);
+      }
+      REQUIRE((ccc.utilization() < 1.02));
+      REQUIRE((ccc.utilization() > 0.9));
+
+      AND_THEN("the same block is served from the cache") {
+        auto block = ccc.getDataKey((FileIo*) &fio, 299, DataBlock::Mode::STANDARD);
+        REQUIRE((block == ccc.getDataKey((FileIo*) &fio, 299, DataBlock::Mode::STANDARD)));
+      }
+
+      AND_WHEN("the capacity is reduced") {
+        ccc.changeConfiguration(20 * 128);
+
+        THEN("adding a single block shrinks idle shards as well") {
+          ccc.getDataKey((FileIo*) &fio, 1000, DataBlock::Mode::STANDARD);
+          REQUIRE((ccc.utilization() <= 1.0));
+        }
+      }
+    }
+
+    THEN("the 2Q replacement policy keeps frequently used blocks cached during a sequential scan") {
+      std::shared_ptr<ClusterInterface> cluster(new MockCluster());
+      MockFileIo fio("kinetic://Cluster1/thepath", cluster);
+
+      DataCache::Policy policies[] = {DataCache::Policy::LRU, DataCache::Policy::TWO_Q};
+      for (auto policy = std::begin(policies); policy != std::end(policies); policy++) {
+        DataCache ccc(100 * 128, 1, *policy);
+
+        /* Access the hot blocks twice, with enough other blocks in between to push them out of probation. */
+        for (int i = 0; i < 10; i++) {
+          ccc.getDataKey((FileIo*) &fio, i, DataBlock::Mode::STANDARD);
+        }
+        for (int i = 100; i < 220; i++) {
+          ccc.getDataKey((FileIo*) &fio, i, DataBlock::Mode::STANDARD);
+        }
+        for (int i = 0; i < 10; i++) {
+          ccc.getDataKey((FileIo*) &fio, i, DataBlock::Mode::STANDARD);
+        }
+
+        /* Scan */
+        for (int i = 1000; i < 1500; i++) {
+          ccc.getDataKey((FileIo*) &fio, i, DataBlock::Mode::STANDARD);
+        }
+
+        auto before = ccc.statistics();
+        REQUIRE((before.policy == *policy));
+        REQUIRE((before.misses == 640));
+        REQUIRE((before.evictions > 0));
+        if (*policy == DataCache::Policy::TWO_Q) {
+          REQUIRE((before.ghost_hits > 0));
+        }
+        else {
+          REQUIRE((before.ghost_hits == 0));
+        }
+        for (int i = 0; i < 10; i++) {
+          ccc.getDataKey((FileIo*) &fio, i, DataBlock::Mode::STANDARD);
+        }
+        auto after = ccc.statistics();
+        if (*policy == DataCache::Policy::TWO_Q) {
+          REQUIRE((after.hits - before.hits == 10));
+        }
+        else {
+          REQUIRE((after.hits - before.hits == 0));
+        }
+      }
+    }
+
     THEN("go ~") {
       for (int capacity = 1000; capacity < 100000; capacity *= 5) {
 
@@ -14,11 +14,14 @@
  ************************************************************************/
 
 #include "KineticIoFactory.hh"
+#include "KineticIoSingleton.hh"
 #include "SimulatorController.h"
 #include <unistd.h>
 #include <fcntl.h>
 #include <FileIo.hh>
 #include <Logging.hh>
+#include "ClusterMap.hh"
+#include "Utility.hh"
 #include "catch.hpp"
 
 using namespace kio;
@@ -190,6 +193,32 @@ SCENARIO("KineticIo Integration Test", "[Io]")
       }
     }
 
+    THEN("Vectored writing is possible for chunks spanning multiple blocks.") {
+      std::vector<IoWriteChunk> write_chunks;
+      write_chunks.push_back(IoWriteChunk{2 * 1024 * 1024 - buf_size / 2, write_buf, buf_size});
+      write_chunks.push_back(IoWriteChunk{77777777, write_buf, buf_size});
+      REQUIRE((fileio->WriteV(write_chunks) == 2 * buf_size));
+      std::vector<IoChunk> chunks;
+
+      AND_THEN("Written data can be read in again with a single vectored read.") {
+        char rbuf_a[buf_size];
+        char rbuf_b[buf_size];
+        chunks.clear();
+        chunks.push_back(IoChunk{77777777, rbuf_b, buf_size});
+        chunks.push_back(IoChunk{2 * 1024 * 1024 - buf_size / 2, rbuf_a, buf_size});
+        REQUIRE((fileio->ReadV(chunks) == 2 * buf_size));
+        REQUIRE((memcmp(write_buf, rbuf_a, buf_size) == 0));
+        REQUIRE((memcmp(write_buf, rbuf_b, buf_size) == 0));
+      }
+
+      AND_THEN("Vectored reads past the file size only read to filesize limits") {
+        chunks.clear();
+        chunks.push_back(IoChunk{77777777 + buf_size / 2, read_buf, buf_size});
+        chunks.push_back(IoChunk{88888888, read_buf, buf_size});
+        REQUIRE((fileio->ReadV(chunks) == buf_size / 2));
+      }
+    }
+
     THEN("Stat should succeed and report a file size of 0") {
       struct stat stbuf;
       REQUIRE_NOTHROW(fileio->Stat(&stbuf));
@@ -248,6 +277,12 @@ SCENARIO("KineticIo Integration Test", "[Io]")
         REQUIRE_NOTHROW(fileio->Sync());
       }
 
+      THEN("The partially written block stays dirty until the object is synced.") {
+        REQUIRE((kio::kio().writeback().dirtyBytes() >= capacity));
+        REQUIRE_NOTHROW(fileio->Sync());
+        REQUIRE((kio::kio().writeback().dirtyBytes() == 0));
+      }
+
       THEN("Stat will return the number of blocks and the filesize.") {
         struct stat stbuf;
         REQUIRE_NOTHROW(fileio->Stat(&stbuf));
@@ -284,6 +319,85 @@ SCENARIO("KineticIo Integration Test", "[Io]")
         }
       }
     }
+
+    AND_WHEN("Writing data across multiple blocks asynchronously.") {
+      const size_t capacity = 2 * 1024 * 1024;
+      std::vector<std::future<int64_t>> writes;
+      for (int block = 0; block < 8; block++) {
+        writes.push_back(fileio->WriteAsync(block * capacity + block, write_buf, buf_size));
+      }
+      for (auto it = writes.begin(); it != writes.end(); it++) {
+        REQUIRE((it->get() == buf_size));
+      }
+
+      THEN("IO object can be synced asynchronously.") {
+        auto sync = fileio->SyncAsync();
+        REQUIRE_NOTHROW(sync.get());
+        REQUIRE((kio::kio().writeback().dirtyBytes() == 0));
+
+        AND_THEN("Written data can be read in again with many requests outstanding.") {
+          auto reader = KineticIoFactory::makeFileIo(full_url);
+          REQUIRE_NOTHROW(reader->Open(0));
+          std::vector<std::vector<char>> buffers(8, std::vector<char>(buf_size));
+          std::vector<std::future<int64_t>> reads;
+          for (int block = 0; block < 8; block++) {
+            reads.push_back(reader->ReadAsync(block * capacity + block, buffers[block].data(), buf_size));
+          }
+          for (int block = 0; block < 8; block++) {
+            REQUIRE((reads[block].get() == buf_size));
+            REQUIRE((memcmp(write_buf, buffers[block].data(), buf_size) == 0));
+          }
+        }
+      }
+
+      THEN("Reading past the file size only reads to filesize limits") {
+        auto read = fileio->ReadAsync(7 * capacity + 7 + buf_size / 2, read_buf, buf_size);
+        REQUIRE((read.get() == buf_size / 2));
+      }
+
+      THEN("Asynchronous reads pick up data written by someone else once cached data expired.") {
+        REQUIRE_NOTHROW(fileio->SyncAsync().get());
+        REQUIRE((fileio->ReadAsync(0, read_buf, buf_size).get() == buf_size));
+        REQUIRE((memcmp(write_buf, read_buf, buf_size) == 0));
+
+        /* Change the block on the backend without going through the cache. */
+        auto cluster = kio::kio().cmap().getCluster(utility::urlToClusterId(full_url));
+        DataBlock other(cluster, utility::makeDataKey(cluster->id(), utility::urlToPath(full_url), 0));
+        REQUIRE_NOTHROW(other.write("99", 0, 2));
+        REQUIRE_NOTHROW(other.flush());
+
+        usleep(DataBlock::expiration_time.count() * 1000);
+        REQUIRE((fileio->ReadAsync(0, read_buf, buf_size).get() == buf_size));
+        REQUIRE((memcmp("99", read_buf, 2) == 0));
+        REQUIRE((memcmp(write_buf + 2, read_buf + 2, buf_size - 2) == 0));
+      }
+
+      THEN("Syncing asynchronously merges in data written by another io object in the meantime.") {
+        REQUIRE_NOTHROW(fileio->SyncAsync().get());
+        auto other = KineticIoFactory::makeFileIo(full_url);
+        REQUIRE_NOTHROW(other->Open(0));
+        REQUIRE((other->Write(buf_size, write_buf, buf_size) == buf_size));
+        REQUIRE_NOTHROW(other->Close());
+
+        REQUIRE((fileio->WriteAsync(0, write_buf, 1).get() == 1));
+        REQUIRE_NOTHROW(fileio->SyncAsync().get());
+
+        auto reader = KineticIoFactory::makeFileIo(full_url);
+        REQUIRE_NOTHROW(reader->Open(0));
+        std::vector<char> buffer(2 * buf_size);
+        REQUIRE((reader->ReadAsync(0, buffer.data(), 2 * buf_size).get() == 2 * buf_size));
+        REQUIRE((memcmp(write_buf, buffer.data(), buf_size) == 0));
+        REQUIRE((memcmp(write_buf, buffer.data() + buf_size, buf_size) == 0));
+      }
+    }
+
+    THEN("Asynchronous requests fail on a closed object") {
+      fileio->Close();
+      auto read = fileio->ReadAsync(0, read_buf, buf_size);
+      REQUIRE_THROWS_AS(read.get(), std::system_error);
+      auto write = fileio->WriteAsync(0, write_buf, buf_size);
+      REQUIRE_THROWS_AS(write.get(), std::system_error);
+    }
   }
 }
 
@@ -355,6 +469,7 @@ SCENARIO("FileIo Attribute Integration Test", "[Attr]")
     THEN("We can use the attr interface to request io stats") {
       auto stats = fileio->attrGet("sys.iostats");
       REQUIRE(stats.size());
+      REQUIRE((stats.find("cache-hits=") != std::string::npos));
     }
 
     THEN("We can use the attr interface to request health stats") {
@@ -76,6 +76,23 @@ SCENARIO("Connection Test", "[Con]")
       REQUIRE(cb->done());
       REQUIRE(cb->ok());
 
+      AND_THEN("Queued commands are sent together with a single flush.") {
+        auto sync = std::make_shared<CallbackSynchronization>();
+        std::vector<std::shared_ptr<BasicCallback>> cbs;
+        for (int i = 0; i < 10; i++) {
+          auto cb = std::make_shared<BasicCallback>(sync);
+          con->NoOp(cb);
+          autocon->enqueue(con, cb);
+          cbs.push_back(cb);
+        }
+        autocon->flush();
+        sync->wait_until(std::chrono::system_clock::now() + std::chrono::seconds(5));
+        for (auto it = cbs.begin(); it != cbs.end(); it++) {
+          REQUIRE((*it)->finished());
+          REQUIRE((*it)->getResult().ok());
+        }
+      }
+
       AND_WHEN("We set it into error state with wrong connection pointer"){
         std::shared_ptr<kinetic::ThreadsafeNonblockingKineticConnection> empty;
         autocon->setError(empty);
@@ -124,4 +141,56 @@ SCENARIO("Connection Test", "[Con]")
     }
 
   }
+
+  GIVEN ("An autoconnection with a pool of connections") {
+    auto info = std::make_pair(c.get(0), c.get(0));
+    auto autocon = std::make_shared<KineticAutoConnection>(listener, info, std::chrono::seconds(1),
+                                                           std::chrono::microseconds::zero(), 2);
+
+    THEN("Pool members are used round robin.") {
+      auto first = autocon->get();
+      auto second = autocon->get();
+      REQUIRE((first != second));
+      REQUIRE((autocon->get() == first));
+
+      AND_WHEN("A pool member is set into error state") {
+        autocon->setError(first);
+
+        THEN("the remaining pool member is used until it reconnected.") {
+          REQUIRE((autocon->get() == second));
+          REQUIRE((autocon->get() == second));
+
+          auto cb = std::make_shared<ConnectCallback>();
+          second->NoOp(cb);
+          second->Run(&x, &x, &y);
+          usleep(1000 * 100);
+          REQUIRE(cb->done());
+          REQUIRE(cb->ok());
+        }
+      }
+    }
+  }
+
+  GIVEN ("An autoconnection picking the pool member with the least outstanding commands") {
+    auto info = std::make_pair(c.get(0), c.get(0));
+    auto autocon = std::make_shared<KineticAutoConnection>(listener, info, std::chrono::seconds(1),
+                                                           std::chrono::microseconds::zero(), 2,
+                                                           KineticAutoConnection::Selection::LEAST_OUTSTANDING);
+
+    THEN("Commands are issued on the idle pool member.") {
+      auto sync = std::make_shared<CallbackSynchronization>();
+      auto busy = autocon->get();
+      auto cb = std::make_shared<BasicCallback>(sync);
+      autocon->enqueue(busy, cb);
+      REQUIRE((autocon->get() != busy));
+      REQUIRE((autocon->get() != busy));
+
+      AND_THEN("Completed commands are no longer outstanding.") {
+        cb->OnResult(KineticStatus(StatusCode::OK, ""));
+        auto one = autocon->get();
+        auto other = autocon->get();
+        REQUIRE((one != other));
+      }
+    }
+  }
 }
@@ -57,6 +57,14 @@ SCENARIO("Cluster integration test.", "[Cluster]")
       REQUIRE((cluster->limits().max_value_size == nData * 1024 * 1024));
     }
 
+    THEN("flush succeeds as long as a quorum of drives is available") {
+      REQUIRE(cluster->flush().ok());
+      c.block(0);
+      REQUIRE(cluster->flush().ok());
+      c.block(1);
+      REQUIRE_FALSE(cluster->flush().ok());
+    }
+
     WHEN("Putting a key-value pair on a cluster with 1 drive failure") {
       auto key = utility::makeDataKey(cluster->id(), "key", 0);
       auto value = make_shared<string>("this is a value");
@@ -141,6 +149,91 @@ SCENARIO("Cluster integration test.", "[Cluster]")
         REQUIRE((keys->size() == 5));
       }
 
+      THEN("they can be read in with a single multiGet, missing keys are reported as not found") {
+        std::vector<shared_ptr<const string>> keys;
+        for (int i = 0; i < 11; i++) {
+          keys.push_back(make_shared<string>(utility::Convert::toString("key", i)));
+        }
+        std::vector<shared_ptr<const string>> versions;
+        std::vector<shared_ptr<const ChunkedValue>> values;
+        auto status = cluster->multiGet(keys, versions, values);
+        REQUIRE((status.size() == 11));
+        for (int i = 0; i < 10; i++) {
+          REQUIRE(status[i].ok());
+          REQUIRE((*values[i]->toString() == "value"));
+          REQUIRE(versions[i]);
+        }
+        REQUIRE((status[10].statusCode() == StatusCode::REMOTE_NOT_FOUND));
+      }
+
+      THEN("they can be read in with hedged reads requesting parity chunks right away") {
+        std::vector<std::unique_ptr<KineticAutoConnection>> cons;
+        for (int i = 0; i < 3; i++) {
+          std::unique_ptr<KineticAutoConnection> autocon(
+              new KineticAutoConnection(listener, std::make_pair(c.get(i), c.get(i)), std::chrono::seconds(10))
+          );
+          cons.push_back(std::move(autocon));
+        }
+        auto rp = std::make_shared<RedundancyProvider>(nData, nParity);
+
+        for (int i = 0; i < 10; i++) {
+          auto key = make_shared<const string>(utility::Convert::toString("key", i));
+          StripeOperation_GET getop(key, false, blocksize, cons, rp);
+          auto status = getop.execute(std::chrono::seconds(10), std::chrono::microseconds(1));
+          REQUIRE(status.ok());
+          REQUIRE(getop.getVersion());
+          REQUIRE((*getop.getValue(blocksize)->toString() == "value"));
+          REQUIRE_FALSE(getop.needsIndicator());
+        }
+      }
+    }
+
+    WHEN("Many keys are put down asynchronously") {
+      auto value = make_shared<const ChunkedValue>(blocksize, string(1000, 'a'));
+      std::vector<std::future<AsyncResult>> puts;
+      for (int i = 0; i < 20; i++) {
+        puts.push_back(cluster->putAsync(make_shared<string>(utility::Convert::toString("async", i)), value));
+      }
+      std::vector<shared_ptr<const string>> versions;
+      for (auto it = puts.begin(); it != puts.end(); it++) {
+        auto result = it->get();
+        REQUIRE(result.status.ok());
+        REQUIRE(result.version);
+        versions.push_back(result.version);
+      }
+
+      THEN("they can be read in asynchronously") {
+        std::vector<std::future<AsyncResult>> gets;
+        for (int i = 0; i < 20; i++) {
+          gets.push_back(cluster->getAsync(make_shared<string>(utility::Convert::toString("async", i)), false));
+        }
+        for (size_t i = 0; i < gets.size(); i++) {
+          auto result = gets[i].get();
+          REQUIRE(result.status.ok());
+          REQUIRE((*result.version == *versions[i]));
+          REQUIRE((*result.value->toString() == string(1000, 'a')));
+        }
+      }
+
+      THEN("range and flush can be executed asynchronously") {
+        auto range = cluster->rangeAsync(make_shared<string>("async"), make_shared<string>("async~")).get();
+        REQUIRE(range.status.ok());
+        REQUIRE((range.keys->size() == 20));
+        REQUIRE(cluster->flushAsync().get().status.ok());
+      }
+
+      THEN("they can be removed asynchronously") {
+        std::vector<std::future<AsyncResult>> removes;
+        for (int i = 0; i < 20; i++) {
+          removes.push_back(cluster->removeAsync(make_shared<string>(utility::Convert::toString("async", i)),
+                                                 versions[i]));
+        }
+        for (auto it = removes.begin(); it != removes.end(); it++) {
+          REQUIRE(it->get().status.ok());
+        }
+        auto result = cluster->getAsync(make_shared<string>("async0"), true).get();
+        REQUIRE((result.status.statusCode() == StatusCode::REMOTE_NOT_FOUND));
+      }
     }
 
     WHEN("Putting a key-value pair on a healthy cluster") {
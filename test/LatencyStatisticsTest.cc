@@ -0,0 +1,87 @@
+/************************************************************************
+ * KineticIo - a file io interface library to kinetic devices.          *
+ *                                                                      *
+ * This Source Code Form is subject to the terms of the Mozilla         *
+ * Public License, v. 2.0. If a copy of the MPL was not                 *
+ * distributed with this file, You can obtain one at                    *
+ * https://mozilla.org/MP:/2.0/.                                        *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but is provided AS-IS, WITHOUT ANY WARRANTY; including without       *
+ * the implied warranty of MERCHANTABILITY, NON-INFRINGEMENT or         *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the Mozilla Public             *
+ * License for more details.                                            *
+ ************************************************************************/
+
+#include "LatencyStatistics.hh"
+#include "catch.hpp"
+
+using namespace kio;
+using std::chrono::microseconds;
+
+SCENARIO("LatencyStatistics Test", "[Latency]")
+{
+  GIVEN ("Empty latency statistics") {
+    LatencyStatistics stats;
+
+    THEN("no latencies are reported") {
+      REQUIRE((stats.get(OperationType::READ, SizeClass::SMALL).samples == 0));
+      REQUIRE((stats.percentile(OperationType::READ, SizeClass::SMALL, 50) == microseconds::zero()));
+      REQUIRE(stats.get().empty());
+    }
+
+    THEN("the maximum timeout is used") {
+      REQUIRE((stats.timeout(OperationType::READ, std::chrono::seconds(10)) == std::chrono::seconds(10)));
+    }
+
+    WHEN("latencies of different operation types and sizes are recorded") {
+      for (int i = 1; i <= 100; i++) {
+        stats.record(OperationType::READ, 1024, microseconds(i * 100));
+        stats.record(OperationType::WRITE, 1024 * 1024, microseconds(i * 1000));
+      }
+
+      THEN("they are kept apart") {
+        REQUIRE((stats.get().size() == 2));
+        REQUIRE((stats.get(OperationType::READ, SizeClass::SMALL).samples == 100));
+        REQUIRE((stats.get(OperationType::WRITE, SizeClass::LARGE).samples == 100));
+        REQUIRE((stats.get(OperationType::READ, SizeClass::LARGE).samples == 0));
+      }
+
+      THEN("percentiles are accurate to a bucket") {
+        auto p50 = stats.get(OperationType::READ, SizeClass::SMALL).p50;
+        REQUIRE((p50 >= microseconds(5000)));
+        REQUIRE((p50 <= microseconds(5000 + 5000 / 8)));
+        auto p99 = stats.get(OperationType::WRITE, SizeClass::LARGE).p99;
+        REQUIRE((p99 >= microseconds(99000)));
+        REQUIRE((p99 <= microseconds(99000 + 99000 / 8)));
+      }
+
+      THEN("the moving average follows recent latencies") {
+        auto ewma = stats.get(OperationType::READ, SizeClass::SMALL).ewma;
+        REQUIRE((ewma > microseconds(5000)));
+        REQUIRE((ewma < microseconds(10000)));
+      }
+
+      THEN("adaptive timeouts are a multiple of the 99th percentile latency within limits") {
+        auto write = stats.timeout(OperationType::WRITE, std::chrono::seconds(10));
+        REQUIRE((write > microseconds(99000 * 8)));
+        REQUIRE((write < std::chrono::seconds(10)));
+        REQUIRE((stats.timeout(OperationType::READ, std::chrono::seconds(10)) == std::chrono::seconds(1)));
+        REQUIRE((stats.timeout(OperationType::WRITE, std::chrono::seconds(1)) == std::chrono::seconds(1)));
+        REQUIRE((stats.timeout(OperationType::OTHER, std::chrono::seconds(10)) == std::chrono::seconds(10)));
+      }
+
+      AND_WHEN("latencies change") {
+        for (int i = 0; i < 10000; i++) {
+          stats.record(OperationType::READ, 1024, microseconds(100000));
+        }
+
+        THEN("old latencies lose their influence") {
+          auto s = stats.get(OperationType::READ, SizeClass::SMALL);
+          REQUIRE((s.p50 >= microseconds(100000)));
+          REQUIRE((s.ewma > microseconds(99000)));
+        }
+      }
+    }
+  }
+}
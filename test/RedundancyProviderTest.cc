@@ -78,6 +78,69 @@ SCENARIO("Redundancy Provider Test.", "[Redundancy]"){
     int nParity = 4;
     RedundancyProvider rp(nData, nParity);
 
+    THEN("Every single missing block can be reconstructed."){
+      auto stripe = makeStripe(nData, nParity, value);
+      REQUIRE_NOTHROW(rp.compute(stripe));
+      auto encoded = stripe;
+
+      for(int i=0; i<nData+nParity; i++){
+        stripe[i] = make_shared<const string>();
+        REQUIRE_NOTHROW(rp.compute(stripe));
+        REQUIRE((*stripe[i] == *encoded[i]));
+      }
+    }
+
+    THEN("Parities can be computed into caller supplied buffers."){
+      auto stripe = makeStripe(nData, nParity, value);
+      auto chunk_size = stripe[0]->size();
+      std::vector<std::string> buffers;
+      for(int i=0; i<nData+nParity; i++){
+        buffers.push_back(i < nData ? *stripe[i] : std::string(chunk_size, '\0'));
+      }
+      std::vector<unsigned char*> blocks;
+      std::vector<bool> missing;
+      for(int i=0; i<nData+nParity; i++){
+        blocks.push_back(reinterpret_cast<unsigned char*>(&buffers[i][0]));
+        missing.push_back(i >= nData);
+      }
+      REQUIRE_NOTHROW(rp.compute(blocks, missing, chunk_size));
+      REQUIRE_NOTHROW(rp.compute(stripe));
+      for(int i=nData; i<nData+nParity; i++){
+        REQUIRE((buffers[i] == *stripe[i]));
+      }
+    }
+
+    THEN("Parities can be updated for a single changed data block."){
+      auto stripe = makeStripe(nData, nParity, value);
+      REQUIRE_NOTHROW(rp.compute(stripe));
+      auto chunk_size = stripe[0]->size();
+
+      std::vector<std::string> parities;
+      std::vector<unsigned char*> parity_blocks;
+      for(int i=nData; i<nData+nParity; i++){
+        parities.push_back(*stripe[i]);
+      }
+      for(int i=0; i<nParity; i++){
+        parity_blocks.push_back(reinterpret_cast<unsigned char*>(&parities[i][0]));
+      }
+
+      std::string changed(*stripe[3]);
+      changed.replace(0, 5, "kio  ");
+      REQUIRE_NOTHROW(rp.update(3, (const unsigned char*) stripe[3]->data(), (const unsigned char*) changed.data(),
+                                parity_blocks, chunk_size));
+
+      stripe[3] = make_shared<const string>(changed);
+      for(int i=nData; i<nData+nParity; i++){
+        stripe[i] = make_shared<const string>();
+      }
+      REQUIRE_NOTHROW(rp.compute(stripe));
+      for(int i=0; i<nParity; i++){
+        REQUIRE((parities[i] == *stripe[nData+i]));
+      }
+      REQUIRE_THROWS_AS(rp.update(nData, (const unsigned char*) changed.data(), (const unsigned char*) changed.data(),
+                                  parity_blocks, chunk_size), std::invalid_argument);
+    }
+
     THEN("We can run performance numbers."){
 
       for(int size = nData*1024*64; size <= nData*1024*1024; size*=2){
@@ -103,6 +166,114 @@ SCENARIO("Redundancy Provider Test.", "[Redundancy]"){
     }
   }
     
+  GIVEN ("An XOR code"){
+    int nData = 8;
+    RedundancyProvider rp(nData, 1, RedundancyProvider::Codec::XOR);
+    auto stripe = makeStripe(nData, 1, value);
+    REQUIRE_NOTHROW(rp.compute(stripe));
+
+    THEN("The parity is the XOR of all data blocks."){
+      std::string parity(stripe[0]->size(), '\0');
+      for(int i=0; i<nData; i++){
+        for(size_t b=0; b<parity.size(); b++){
+          parity[b] ^= (*stripe[i])[b];
+        }
+      }
+      REQUIRE((parity == *stripe[nData]));
+    }
+
+    THEN("Every single missing block can be reconstructed."){
+      auto encoded = stripe;
+      for(int i=0; i<nData+1; i++){
+        stripe[i] = make_shared<const string>();
+        REQUIRE_NOTHROW(rp.compute(stripe));
+        REQUIRE((*stripe[i] == *encoded[i]));
+      }
+    }
+
+    THEN("More than a single parity block is rejected."){
+      REQUIRE_THROWS_AS(RedundancyProvider(nData, 2, RedundancyProvider::Codec::XOR), std::invalid_argument);
+    }
+  }
+
+  GIVEN ("A 16-4 locally repairable code with 2 local parities"){
+    int nData = 16;
+    int nParity = 4;
+    RedundancyProvider rp(nData, nParity, RedundancyProvider::Codec::LRC, 2);
+    auto stripe = makeStripe(nData, nParity, value);
+    REQUIRE_NOTHROW(rp.compute(stripe));
+    auto encoded = stripe;
+
+    THEN("Local parities only depend on their group."){
+      auto changed = stripe;
+      changed[0] = make_shared<const string>(stripe[0]->size(), 'x');
+      for(int i=nData; i<nData+nParity; i++){
+        changed[i] = make_shared<const string>();
+      }
+      REQUIRE_NOTHROW(rp.compute(changed));
+      REQUIRE((*changed[nData] != *encoded[nData]));
+      REQUIRE((*changed[nData+1] == *encoded[nData+1]));
+    }
+
+    THEN("A single missing block is reconstructed without reading the blocks of other groups."){
+      auto partial = stripe;
+      partial[3] = make_shared<const string>();
+      /* Garbage in the other group and the global parities would corrupt any reconstruction reading them. */
+      for(int i=8; i<nData; i++){
+        partial[i] = make_shared<const string>(stripe[i]->size(), 'x');
+      }
+      partial[nData+2] = partial[nData+3] = make_shared<const string>(stripe[0]->size(), 'x');
+      REQUIRE_NOTHROW(rp.compute(partial));
+      REQUIRE((*partial[3] == *encoded[3]));
+    }
+
+    THEN("Any three missing blocks can be reconstructed."){
+      for(int a=0; a<nData+nParity; a++){
+        for(int b=a+1; b<nData+nParity; b++){
+          for(int c=b+1; c<nData+nParity; c++){
+            auto damaged = encoded;
+            damaged[a] = damaged[b] = damaged[c] = make_shared<const string>();
+            REQUIRE_NOTHROW(rp.compute(damaged));
+            REQUIRE((*damaged[a] == *encoded[a]));
+            REQUIRE((*damaged[b] == *encoded[b]));
+            REQUIRE((*damaged[c] == *encoded[c]));
+          }
+        }
+      }
+    }
+
+    THEN("Invalid numbers of local parities are rejected."){
+      REQUIRE_THROWS_AS(RedundancyProvider(nData, nParity, RedundancyProvider::Codec::LRC, 0), std::invalid_argument);
+      REQUIRE_THROWS_AS(RedundancyProvider(nData, nParity, RedundancyProvider::Codec::LRC, 5), std::invalid_argument);
+      REQUIRE_THROWS_AS(RedundancyProvider(nData, nParity, RedundancyProvider::Codec::CAUCHY_RS, 2), std::invalid_argument);
+    }
+  }
+
+  GIVEN ("A 4-2 Vandermonde Reed-Solomon code"){
+    RedundancyProvider rp(4, 2, RedundancyProvider::Codec::VANDERMONDE_RS);
+    auto stripe = makeStripe(4, 2, value);
+    REQUIRE_NOTHROW(rp.compute(stripe));
+
+    THEN("Any two missing blocks can be reconstructed."){
+      auto encoded = stripe;
+      for(int a=0; a<6; a++){
+        for(int b=a+1; b<6; b++){
+          auto damaged = encoded;
+          damaged[a] = damaged[b] = make_shared<const string>();
+          REQUIRE_NOTHROW(rp.compute(damaged));
+          REQUIRE((*damaged[a] == *encoded[a]));
+          REQUIRE((*damaged[b] == *encoded[b]));
+        }
+      }
+    }
+  }
+
+  GIVEN ("A stripe configuration with more than 64 blocks"){
+    THEN("Construction throws."){
+      REQUIRE_THROWS_AS(RedundancyProvider(60, 8), std::invalid_argument);
+    }
+  }
+
   for(int nData=1; nData<=32; nData*=4){
     for(int nParity=0; nParity<=8; nParity+=2){
       
@@ -150,4 +321,48 @@ SCENARIO("Redundancy Provider Test.", "[Redundancy]"){
       }
     }
   }
-};
\ No newline at end of file
+};
+
+SCENARIO("Redundancy Provider Benchmark.", "[.benchmark]"){
+
+  GIVEN ("Common erasure coding configurations"){
+    THEN("We can run encoding performance numbers."){
+      int configurations[][2] = {{4,2}, {8,2}, {10,4}};
+      for(auto c = std::begin(configurations); c != std::end(configurations); c++){
+        int nData = (*c)[0];
+        int nParity = (*c)[1];
+        RedundancyProvider rp(nData, nParity);
+
+        std::vector<bool> missing;
+        for(int i=0; i<nData+nParity; i++){
+          missing.push_back(i >= nData);
+        }
+
+        for(size_t chunk_size = 64*1024; chunk_size <= 4*1024*1024; chunk_size*=4){
+          /* Keep roughly 32 MB of data in flight. */
+          size_t num_stripes = std::max<size_t>(1, (32*1024*1024) / (nData*chunk_size));
+          std::vector<std::vector<char> > memory(num_stripes, std::vector<char>((nData+nParity)*chunk_size, 'x'));
+          std::vector<std::vector<unsigned char*> > stripes(num_stripes);
+          for(size_t s=0; s<num_stripes; s++){
+            for(int i=0; i<nData+nParity; i++){
+              stripes[s].push_back(reinterpret_cast<unsigned char*>(&memory[s][i*chunk_size]));
+            }
+          }
+
+          int runs = 10;
+          auto t = std::chrono::system_clock::now();
+          for(int r=0; r<runs; r++){
+            for(size_t s=0; s<num_stripes; s++){
+              rp.compute(stripes[s], missing, chunk_size);
+            }
+          }
+          auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now()-t).count();
+          double bytes = static_cast<double>(runs) * num_stripes * nData * chunk_size;
+
+          kio_notice(nData, "+", nParity, " ", chunk_size / 1024, " KB chunk size -> ",
+                     bytes / (microseconds + 1) / 1000, " GB/sec per core");
+        }
+      }
+    }
+  }
+}
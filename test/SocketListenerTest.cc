@@ -83,4 +83,46 @@ SCENARIO("Listener Test.", "[Listen]"){
       }
     }
   }
+
+  GIVEN ("A Socket Listener with multiple pinned threads"){
+    kio::SocketListener listen(4, true);
+
+    THEN("Callbacks of connections spread across threads will be called."){
+      kio::KineticAutoConnection con(
+        listen,
+        std::pair<ConnectionOptions,ConnectionOptions>(c.get(0),c.get(0)),
+        std::chrono::seconds(10),
+        std::chrono::microseconds::zero(),
+        4
+      );
+
+      std::condition_variable cv;
+      std::mutex mtx;
+      bool ready[4] = {false, false, false, false};
+      for (int i = 0; i < 4; i++) {
+        auto cb = make_shared<AnotherSimpleCallback>(cv, mtx, ready[i]);
+        auto kcon = con.get();
+        kcon->NoOp(cb);
+        fd_set a; int fd;
+        kcon->Run(&a,&a,&fd);
+      }
+
+      std::chrono::system_clock::time_point timeout_time = std::chrono::system_clock::now() + std::chrono::seconds(10);
+      std::unique_lock<std::mutex> lck(mtx);
+      while (!(ready[0] && ready[1] && ready[2] && ready[3]) && std::chrono::system_clock::now() < timeout_time) {
+        cv.wait_until(lck, timeout_time);
+      }
+      REQUIRE((ready[0] && ready[1] && ready[2] && ready[3]));
+
+      AND_THEN("Listener threads can be added at runtime."){
+        listen.changeConfiguration(8, false);
+        kio::KineticAutoConnection other(
+          listen,
+          std::pair<ConnectionOptions,ConnectionOptions>(c.get(0),c.get(0)),
+          std::chrono::seconds(10)
+        );
+        REQUIRE_NOTHROW(other.get());
+      }
+    }
+  }
 };
\ No newline at end of file